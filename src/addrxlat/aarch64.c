@@ -181,6 +181,141 @@ pgt_aarch64(addrxlat_step_t *step)
 	return ADDRXLAT_OK;
 }
 
+/** Specialized Arm AArch64 page table walker.
+ * @param step        Step state, initialized as for @ref addrxlat_walk.
+ * @param page_shift  Translation granule shift (12 or 16).
+ * @param levels      Number of translation table levels.
+ * @param va_bits     Number of virtual address bits.
+ * @returns           Error status.
+ *
+ * This function is meant to be inlined with constant parameters,
+ * so all shifts and masks are known at compile time and the loop
+ * over translation table levels can be fully unrolled.
+ */
+static inline __attribute__((always_inline)) addrxlat_status
+walk_aarch64(addrxlat_step_t *step, const unsigned short page_shift,
+	     const unsigned short levels, const unsigned short va_bits)
+{
+	const unsigned short idx_bits = page_shift - 3;
+	const addrxlat_param_pgt_t *pgt = &step->meth->param.pgt;
+	addrxlat_addr_t addr = step->base.addr;
+	addrxlat_addr_t mask;
+	unsigned long caps;
+	unsigned short lvl;
+	addrxlat_pte_t pte;
+	addrxlat_status status;
+
+	if (pgt->root.as == ADDRXLAT_NOADDR)
+		return ADDRXLAT_ERR_NODATA;
+
+	caps = step->ctx->cb->read_caps(step->ctx->cb);
+	step->base = pgt->root;
+	mask = ADDR_MASK(page_shift);
+
+#pragma GCC unroll 8
+	for (lvl = levels; lvl > 0; --lvl) {
+		unsigned short shift = page_shift + (lvl - 1) * idx_bits;
+		unsigned short bits = (lvl == levels)
+			? va_bits - shift
+			: idx_bits;
+		step->base.addr += ((addr >> shift) & ADDR_MASK(bits))
+			* sizeof(uint64_t);
+		status = fast_read_pte64(step, caps, &step->base,
+					 ADDRXLAT_LITTLE_ENDIAN, &pte);
+		if (status != ADDRXLAT_OK)
+			return status;
+		step->raw.pte = pte;
+		pte &= ~pgt->pte_mask;
+		if (!PTE_VALID(pte))
+			return ADDRXLAT_ERR_NOTPRESENT;
+
+		step->base.addr = pte & PA_MASK & ~ADDR_MASK(page_shift);
+		step->base.as = step->meth->target_as;
+		if (PTE_TYPE(pte) == PTE_TYPE_BLOCK) {
+			mask = ADDR_MASK(shift);
+			if (lvl == 1 || mask > MAX_REGION_MASK)
+				return ADDRXLAT_ERR_INVALID;
+			break;
+		}
+	}
+
+	step->base.addr = (step->base.addr & ~mask) | (addr & mask);
+	step->remain = 0;
+	step->elemsz = 0;
+	return ADDRXLAT_OK;
+}
+
+/** Specialized walker for 4K granules and 39-bit VA.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_aarch64_4k_va39(addrxlat_step_t *step)
+{
+	return walk_aarch64(step, 12, 3, 39);
+}
+
+/** Specialized walker for 4K granules and 48-bit VA.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_aarch64_4k_va48(addrxlat_step_t *step)
+{
+	return walk_aarch64(step, 12, 4, 48);
+}
+
+/** Specialized walker for 64K granules and 42-bit VA.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_aarch64_64k_va42(addrxlat_step_t *step)
+{
+	return walk_aarch64(step, 16, 2, 42);
+}
+
+/** Specialized walker for 64K granules and 48-bit VA.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_aarch64_64k_va48(addrxlat_step_t *step)
+{
+	return walk_aarch64(step, 16, 3, 48);
+}
+
+/** Select a specialized Arm AArch64 page table walker.
+ * @param pf  Paging form.
+ * @returns   Specialized walker, or @c NULL if there is none.
+ */
+pgt_walk_fn *
+pgt_walker_aarch64(const addrxlat_paging_form_t *pf)
+{
+	unsigned short page_shift = pf->fieldsz[0];
+	unsigned short va_bits = page_shift;
+	unsigned short i;
+
+	if (page_shift != 12 && page_shift != 16)
+		return NULL;
+	for (i = 1; i < pf->nfields; ++i) {
+		if (pf->fieldsz[i] > page_shift - 3 ||
+		    (i < pf->nfields - 1 && pf->fieldsz[i] != page_shift - 3))
+			return NULL;
+		va_bits += pf->fieldsz[i];
+	}
+
+	if (page_shift == 12 && va_bits == 39)
+		return walk_aarch64_4k_va39;
+	if (page_shift == 12 && va_bits == 48)
+		return walk_aarch64_4k_va48;
+	if (page_shift == 16 && va_bits == 42)
+		return walk_aarch64_64k_va42;
+	if (page_shift == 16 && va_bits == 48)
+		return walk_aarch64_64k_va48;
+	return NULL;
+}
+
 /** Arm AArch64 with LPA page table step function.
  * @param step  Current step state.
  * @returns     Error status.
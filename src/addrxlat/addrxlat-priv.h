@@ -93,7 +93,7 @@
 struct inflight;
 
 /** Number of read cache slots. */
-#define READ_CACHE_SLOTS	4
+#define READ_CACHE_SLOTS	ADDRXLAT_READ_CACHE_SLOTS
 
 /** Cache slot (buffer plus cache metadata). */
 struct read_cache_slot {
@@ -111,6 +111,12 @@ struct read_cache {
 
 	/** Cache slots. */
 	struct read_cache_slot slot[READ_CACHE_SLOTS];
+
+	/** Number of cache hits. */
+	unsigned long hits;
+
+	/** Number of cache misses. */
+	unsigned long misses;
 };
 
 INTERNAL_DECL(void, bury_cache_buffer,
@@ -143,11 +149,18 @@ struct _addrxlat_ctx {
 	/** Read cache. */
 	struct read_cache cache;
 
+	/** Context whose callbacks are shared by a clone (or @c NULL). */
+	addrxlat_ctx_t *parent;
+
 	/** Error message buffer.
 	 * This must be the last member. */
 	kdump_errmsg_t err;
 };
 
+INTERNAL_DECL(addrxlat_ctx_t *, ctx_clone, (addrxlat_ctx_t *ctx));
+INTERNAL_DECL(void, ctx_clone_free,
+	      (addrxlat_ctx_t *ctx, addrxlat_ctx_t *clone));
+
 /* utils */
 
 INTERNAL_DECL(addrxlat_status, get_cache_buf,
@@ -218,6 +231,18 @@ map_clear(addrxlat_map_t *map)
 	map->n = 0;
 }
 
+/** Type of a specialized page table walker.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ *
+ * A specialized walker performs the complete translation in one call.
+ * It handles only the common case. Any other status than
+ * @c ADDRXLAT_OK means that the walker gave up, and the translation
+ * must be retried with the generic walker, which also provides a
+ * detailed error message if needed.
+ */
+typedef addrxlat_status pgt_walk_fn(addrxlat_step_t *step);
+
 /** Translation system.
  */
 struct _addrxlat_sys {
@@ -229,8 +254,19 @@ struct _addrxlat_sys {
 
 	/** Address translation methods. */
 	addrxlat_meth_t meth[ADDRXLAT_SYS_METH_NUM];
+
+	/** Specialized page table walkers for @c meth (or @c NULL). */
+	pgt_walk_fn *walk[ADDRXLAT_SYS_METH_NUM];
+
+	/** Lookup tables loaded from a snapshot (or @c NULL). */
+	addrxlat_lookup_elem_t *lookup_tbl;
+
+	/** Number of elements in @c lookup_tbl. */
+	size_t lookup_cnt;
 };
 
+INTERNAL_DECL(void, sys_cleanup, (addrxlat_sys_t *sys));
+
 /* vtop */
 
 /** Get the pteval shift for a PTE format.
@@ -305,6 +341,53 @@ read_pte64(addrxlat_step_t *step, addrxlat_pte_t *pte)
 	return status;
 }
 
+/** Read a 64-bit PTE on the fast path.
+ * @param step  Current step state.
+ * @param caps  Read capabilities of the translation context.
+ * @param addr  Full address of the PTE.
+ * @param bo    Expected byte order of page table data.
+ * @param pte   Set to the raw PTE value on success.
+ * @returns     Error status.
+ *
+ * This is a variant of @ref read_pte64 for specialized page table
+ * walkers. The byte order is normally a constant, so conversion is
+ * resolved at compile time unless the buffer uses a different byte
+ * order. No error message is set if the page table is read directly.
+ */
+static inline addrxlat_status
+fast_read_pte64(addrxlat_step_t *step, unsigned long caps,
+		const addrxlat_fulladdr_t *addr, addrxlat_byte_order_t bo,
+		addrxlat_pte_t *pte)
+{
+	addrxlat_buffer_t *buf;
+	const uint64_t *ptr;
+	uint64_t val;
+	addrxlat_status status;
+
+	if (!(caps & ADDRXLAT_CAPS(addr->as))) {
+		status = read64(step, addr, &val, "PTE");
+		*pte = val;
+		return status;
+	}
+
+	status = get_cache_buf(step->ctx, addr, &buf);
+	if (status != ADDRXLAT_OK)
+		return status;
+
+	ptr = buf->ptr + (addr->addr - buf->addr.addr);
+	if (buf->byte_order == bo)
+		*pte = (bo == ADDRXLAT_BIG_ENDIAN)
+			? be64toh(*ptr)
+			: le64toh(*ptr);
+	else if (buf->byte_order == ADDRXLAT_BIG_ENDIAN)
+		*pte = be64toh(*ptr);
+	else if (buf->byte_order == ADDRXLAT_LITTLE_ENDIAN)
+		*pte = le64toh(*ptr);
+	else
+		*pte = *ptr;
+	return ADDRXLAT_OK;
+}
+
 INTERNAL_DECL(addrxlat_status, pgt_huge_page, (addrxlat_step_t *state));
 
 INTERNAL_DECL(addrxlat_next_step_fn, pgt_aarch64, );
@@ -325,6 +408,14 @@ INTERNAL_DECL(addrxlat_next_step_fn, pgt_s390x, );
 
 INTERNAL_DECL(addrxlat_next_step_fn, pgt_ppc64_linux_rpn30, );
 
+INTERNAL_DECL(pgt_walk_fn *, pgt_walker, (const addrxlat_meth_t *meth));
+INTERNAL_DECL(pgt_walk_fn *, pgt_walker_aarch64,
+	      (const addrxlat_paging_form_t *pf));
+INTERNAL_DECL(pgt_walk_fn *, pgt_walker_s390x,
+	      (const addrxlat_paging_form_t *pf));
+INTERNAL_DECL(pgt_walk_fn *, pgt_walker_x86_64,
+	      (const addrxlat_paging_form_t *pf));
+
 /** Get the page size for a given paging form.
  * @param pf  Paging form.
  * @returns   Page size.
@@ -402,6 +493,20 @@ INTERNAL_DECL(addrxlat_status, highest_linear,
 	      (addrxlat_step_t *step, addrxlat_addr_t *addr,
 	       addrxlat_addr_t limit, addrxlat_addr_t off));
 
+/* Page table enumeration */
+
+/** Virtual address range to be enumerated. */
+struct enum_range {
+	addrxlat_addr_t first;		/**< First address. */
+	addrxlat_addr_t last;		/**< Last address. */
+	const addrxlat_meth_t *meth;	/**< Page table method. */
+};
+
+INTERNAL_DECL(addrxlat_status, enum_pgt,
+	      (addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+	       const struct enum_range *ranges, size_t nranges,
+	       unsigned nthreads, addrxlat_extent_fn *fn, void *data));
+
 /* Option parsing. */
 
 /** This structure holds parsed options. */
@@ -122,11 +122,14 @@ get_cache_buf(addrxlat_ctx_t *ctx, const addrxlat_fulladdr_t *addr,
 	do {
 		addrxlat_buffer_t *buf = &slot->buffer;
 		if (buf->size > addr->addr - buf->addr.addr &&
-		    buf->addr.as == addr->as)
+		    buf->addr.as == addr->as) {
+			++ctx->cache.hits;
 			goto out;
+		}
 	} while (++slot < &ctx->cache.slot[READ_CACHE_SLOTS]);
 
 	/* Not found - use the LRU slot */
+	++ctx->cache.misses;
 	slot = ctx->cache.mru->prev;
 
 	/* Free up the slot if necessary */
@@ -333,12 +336,66 @@ addrxlat_ctx_decref(addrxlat_ctx_t *ctx)
 			free(p);
 			p = (addrxlat_cb_t *)next;
 		}
+		if (ctx->parent)
+			addrxlat_ctx_decref(ctx->parent);
 		err_cleanup(&ctx->err);
 		free(ctx);
 	}
 	return refcnt;
 }
 
+/** Create a context for another thread.
+ * @param ctx  Original address translation context.
+ * @returns    New context, or @c NULL on allocation failure.
+ *
+ * If the active callbacks of @p ctx provide a @c get_thread_ctx
+ * callback, the new context is obtained from that callback.
+ *
+ * Otherwise, the new context has its own read cache and error buffer,
+ * so it can be used by another thread, but it calls the callbacks that
+ * are currently installed in @p ctx. The clone holds a reference to
+ * @p ctx, and the callbacks of @p ctx must not be removed while the
+ * clone exists.
+ *
+ * In either case, the clone must be released with @ref ctx_clone_free.
+ */
+addrxlat_ctx_t *
+ctx_clone(addrxlat_ctx_t *ctx)
+{
+	addrxlat_ctx_t *clone;
+
+	if (ctx->cb->get_thread_ctx) {
+		clone = ctx->cb->get_thread_ctx(ctx->cb);
+		if (clone)
+			clone->noerr = ctx->noerr;
+		return clone;
+	}
+
+	clone = addrxlat_ctx_new();
+	if (!clone)
+		return clone;
+
+	if (ctx->cb != &ctx->def_cb)
+		clone->def_cb = *ctx->cb;
+	clone->noerr = ctx->noerr;
+	clone->parent = ctx;
+	addrxlat_ctx_incref(ctx);
+	return clone;
+}
+
+/** Release a context created by @ref ctx_clone.
+ * @param ctx    Original address translation context.
+ * @param clone  Context returned by @ref ctx_clone for @p ctx.
+ */
+void
+ctx_clone_free(addrxlat_ctx_t *ctx, addrxlat_ctx_t *clone)
+{
+	if (ctx->cb->get_thread_ctx)
+		ctx->cb->put_thread_ctx(ctx->cb, clone);
+	else
+		addrxlat_ctx_decref(clone);
+}
+
 void addrxlat_ctx_clear_err(addrxlat_ctx_t *ctx)
 {
 	clear_error(ctx);
@@ -461,6 +518,8 @@ addrxlat_ctx_add_cb(addrxlat_ctx_t *ctx)
 	cb->sym_sizeof = next_sym_sizeof_cb;
 	cb->sym_offsetof = next_sym_offsetof_cb;
 	cb->num_value = next_num_value_cb;
+	cb->get_thread_ctx = NULL;
+	cb->put_thread_ctx = NULL;
 
 	ctx->cb = cb;
 
@@ -489,6 +548,21 @@ addrxlat_ctx_get_cb(const addrxlat_ctx_t *ctx)
 	return ctx->cb;
 }
 
+void
+addrxlat_ctx_get_cache_stats(const addrxlat_ctx_t *ctx,
+			     unsigned long *hits, unsigned long *misses)
+{
+	*hits = ctx->cache.hits;
+	*misses = ctx->cache.misses;
+}
+
+void
+addrxlat_ctx_reset_cache_stats(addrxlat_ctx_t *ctx)
+{
+	ctx->cache.hits = 0;
+	ctx->cache.misses = 0;
+}
+
 DEFINE_ALIAS(addrspace_name);
 
 const char *
@@ -0,0 +1,631 @@
+/** @internal @file src/addrxlat/enum.c
+ * @brief Page table enumeration.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "addrxlat-priv.h"
+#include "../threads.h"
+
+/** Initial number of extents allocated for a chunk. */
+#define CHUNK_EXTENTS_INIT	64
+
+/** Unit of work: address range covered by one top-level entry.
+ */
+struct enum_chunk {
+	/** Page table translation method. */
+	const addrxlat_meth_t *meth;
+
+	/** First virtual address. */
+	addrxlat_addr_t first;
+
+	/** Last virtual address. */
+	addrxlat_addr_t last;
+
+	/** Extents found in this chunk, sorted by virtual address. */
+	addrxlat_extent_t *ext;
+
+	/** Number of extents in @c ext. */
+	size_t n;
+
+	/** Number of allocated elements in @c ext. */
+	size_t alloc;
+
+	/** Error status. */
+	addrxlat_status status;
+
+	/** Error message (dynamically allocated), or @c NULL. */
+	char *err;
+
+	/** Set when the chunk has been processed. */
+	bool done;
+};
+
+/** Enumeration state shared by all workers.
+ */
+struct enum_ctl {
+	/** Caller's address translation context. */
+	addrxlat_ctx_t *ctx;
+
+	/** Translation system. */
+	addrxlat_sys_t *sys;
+
+	/** Callback function. */
+	addrxlat_extent_fn *fn;
+
+	/** Arbitrary data passed to @c fn. */
+	void *data;
+
+	/** Units of work, sorted by virtual address. */
+	struct enum_chunk *chunks;
+
+	/** Number of elements in @c chunks. */
+	size_t nchunks;
+
+	/** Number of allocated elements in @c chunks. */
+	size_t alloc;
+
+	/** Index of the next chunk to be processed. */
+	size_t next;
+
+	/** Index of the next chunk to be passed to @c fn. */
+	size_t delivered;
+
+	/** Set to stop processing after an error. */
+	bool abort;
+
+	/** Lock for @c next, @c abort and the @c done flag of chunks. */
+	mutex_t lock;
+
+	/** Pending extent, which may be merged with the next one. */
+	addrxlat_extent_t cur;
+
+	/** Set if @c cur is valid. */
+	bool have_cur;
+};
+
+/** Worker state.
+ */
+struct enum_worker {
+	/** Shared enumeration state. */
+	struct enum_ctl *ctl;
+
+	/** Address translation context of this worker. */
+	addrxlat_ctx_t *ctx;
+
+	/** Set for the calling thread, which delivers results. */
+	bool deliver;
+
+#if USE_PTHREAD
+	/** Worker thread. */
+	pthread_t tid;
+#endif
+};
+
+/** Add an extent to a chunk.
+ * @param chunk   Unit of work.
+ * @param vaddr   First virtual address.
+ * @param paddr   Target address of @p vaddr.
+ * @param endoff  Max address offset inside the extent.
+ * @returns       Error status.
+ *
+ * If the new extent immediately follows the last extent in the chunk,
+ * both in virtual and target address space, the last extent is
+ * extended instead of adding a new one.
+ */
+static addrxlat_status
+add_extent(struct enum_chunk *chunk, addrxlat_addr_t vaddr,
+	   const addrxlat_fulladdr_t *paddr, addrxlat_addr_t endoff)
+{
+	addrxlat_extent_t *ext;
+
+	if (chunk->n) {
+		ext = &chunk->ext[chunk->n - 1];
+		if (ext->paddr.as == paddr->as &&
+		    ext->vaddr + ext->endoff + 1 == vaddr &&
+		    ext->paddr.addr + ext->endoff + 1 == paddr->addr) {
+			ext->endoff += endoff + 1;
+			return ADDRXLAT_OK;
+		}
+	}
+
+	if (chunk->n == chunk->alloc) {
+		size_t newalloc = chunk->alloc
+			? 2 * chunk->alloc
+			: CHUNK_EXTENTS_INIT;
+		ext = realloc(chunk->ext, newalloc * sizeof(*ext));
+		if (!ext)
+			return ADDRXLAT_ERR_NOMEM;
+		chunk->ext = ext;
+		chunk->alloc = newalloc;
+	}
+
+	ext = &chunk->ext[chunk->n++];
+	ext->vaddr = vaddr;
+	ext->paddr = *paddr;
+	ext->endoff = endoff;
+	return ADDRXLAT_OK;
+}
+
+/** Enumerate present entries in a page table.
+ * @param chunk  Unit of work.
+ * @param tbl    Step state pointing to the page table.
+ * @param va     Virtual address of the first entry in the table.
+ * @returns      Error status.
+ *
+ * Only entries which overlap with the chunk's address range are
+ * processed. Lower-level tables are enumerated recursively, and
+ * leaf entries are added to the chunk's extents.
+ */
+static addrxlat_status
+enum_table(struct enum_chunk *chunk, const addrxlat_step_t *tbl,
+	   addrxlat_addr_t va)
+{
+	const addrxlat_paging_form_t *pf = &tbl->meth->param.pgt.pf;
+	unsigned short lvl = tbl->remain - 1;
+	addrxlat_addr_t span = pf_table_span(pf, lvl);
+	addrxlat_addr_t i, lo, hi;
+	addrxlat_step_t step;
+	addrxlat_status status;
+
+	lo = chunk->first > va ? (chunk->first - va) / span : 0;
+	hi = (chunk->last - va) / span;
+	if (hi >= pf_table_size(pf, lvl))
+		hi = pf_table_size(pf, lvl) - 1;
+
+	for (i = lo; i <= hi; ++i) {
+		addrxlat_addr_t eva = va + i * span;
+		addrxlat_addr_t off, end;
+
+		memcpy(&step, tbl, sizeof step);
+		memset(step.idx, 0, lvl * sizeof(step.idx[0]));
+		step.idx[lvl] = i;
+		status = internal_step(&step);
+		if (status == ADDRXLAT_ERR_NOTPRESENT) {
+			clear_error(step.ctx);
+			continue;
+		} else if (status != ADDRXLAT_OK)
+			return status;
+
+		if (step.remain > 1) {
+			status = enum_table(chunk, &step, eva);
+			if (status != ADDRXLAT_OK)
+				return status;
+			continue;
+		}
+
+		off = chunk->first > eva ? chunk->first - eva : 0;
+		end = chunk->last - eva < span - 1
+			? chunk->last - eva
+			: span - 1;
+		step.base.addr += off;
+		status = add_extent(chunk, eva + off, &step.base, end - off);
+		if (status != ADDRXLAT_OK)
+			return set_error(step.ctx, status,
+					 "Cannot allocate extent");
+	}
+
+	bury_cache_buffer(&tbl->ctx->cache, &tbl->base);
+	return ADDRXLAT_OK;
+}
+
+/** Enumerate one unit of work.
+ * @param ctx    Address translation context.
+ * @param sys    Translation system.
+ * @param chunk  Unit of work.
+ * @returns      Error status.
+ */
+static addrxlat_status
+enum_chunk(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+	   struct enum_chunk *chunk)
+{
+	const addrxlat_paging_form_t *pf = &chunk->meth->param.pgt.pf;
+	addrxlat_step_t step;
+	addrxlat_status status;
+
+	step.ctx = ctx;
+	step.sys = sys;
+	step.meth = chunk->meth;
+	status = internal_launch(&step, chunk->first);
+	if (status == ADDRXLAT_ERR_INVALID) {
+		/* Address not translatable by this page table. */
+		clear_error(ctx);
+		return ADDRXLAT_OK;
+	} else if (status != ADDRXLAT_OK)
+		return status;
+
+	return enum_table(chunk, &step,
+			  chunk->first & ~paging_max_index(pf));
+}
+
+/** Get the next unit of work.
+ * @param ctl  Shared enumeration state.
+ * @returns    Next chunk, or @c NULL if there is no more work.
+ */
+static struct enum_chunk *
+next_chunk(struct enum_ctl *ctl)
+{
+	struct enum_chunk *chunk = NULL;
+
+	mutex_lock(&ctl->lock);
+	if (!ctl->abort && ctl->next < ctl->nchunks)
+		chunk = &ctl->chunks[ctl->next++];
+	mutex_unlock(&ctl->lock);
+	return chunk;
+}
+
+/** Pass an extent to the callback function.
+ * @param ctl  Shared enumeration state.
+ * @param ext  Mapped extent.
+ * @returns    Error status.
+ *
+ * The extent is merged with the pending extent if possible.
+ * Otherwise, the pending extent is passed to the callback function,
+ * and @p ext becomes the new pending extent.
+ */
+static addrxlat_status
+deliver_extent(struct enum_ctl *ctl, const addrxlat_extent_t *ext)
+{
+	addrxlat_extent_t *cur = &ctl->cur;
+	addrxlat_status status;
+
+	if (ctl->have_cur &&
+	    cur->paddr.as == ext->paddr.as &&
+	    cur->vaddr + cur->endoff + 1 == ext->vaddr &&
+	    cur->paddr.addr + cur->endoff + 1 == ext->paddr.addr) {
+		cur->endoff += ext->endoff + 1;
+		return ADDRXLAT_OK;
+	}
+
+	if (ctl->have_cur) {
+		status = ctl->fn(ctl->data, cur);
+		if (status != ADDRXLAT_OK)
+			return status;
+	}
+	*cur = *ext;
+	ctl->have_cur = true;
+	return ADDRXLAT_OK;
+}
+
+/** Pass the results of all finished chunks to the callback function.
+ * @param ctl  Shared enumeration state.
+ * @returns    Error status.
+ *
+ * Chunks are delivered strictly in order, so this function stops at
+ * the first chunk which has not been processed yet. The extents of
+ * a delivered chunk are freed.
+ */
+static addrxlat_status
+deliver_chunks(struct enum_ctl *ctl)
+{
+	struct enum_chunk *chunk;
+	addrxlat_status status;
+	size_t i;
+
+	for (;;) {
+		mutex_lock(&ctl->lock);
+		chunk = (ctl->delivered < ctl->nchunks &&
+			 ctl->chunks[ctl->delivered].done)
+			? &ctl->chunks[ctl->delivered]
+			: NULL;
+		mutex_unlock(&ctl->lock);
+		if (!chunk)
+			return ADDRXLAT_OK;
+
+		if (chunk->status != ADDRXLAT_OK)
+			return chunk->err
+				? set_error(ctl->ctx, chunk->status,
+					    "%s", chunk->err)
+				: chunk->status;
+
+		for (i = 0; i < chunk->n; ++i) {
+			status = deliver_extent(ctl, &chunk->ext[i]);
+			if (status != ADDRXLAT_OK)
+				return status;
+		}
+		if (chunk->ext) {
+			free(chunk->ext);
+			chunk->ext = NULL;
+		}
+		++ctl->delivered;
+	}
+}
+
+/** Stop all workers.
+ * @param ctl  Shared enumeration state.
+ */
+static void
+abort_workers(struct enum_ctl *ctl)
+{
+	mutex_lock(&ctl->lock);
+	ctl->abort = true;
+	mutex_unlock(&ctl->lock);
+}
+
+/** Process units of work until there are none left.
+ * @param arg  Worker state.
+ * @returns    Error status of the delivery (cast to a pointer).
+ *
+ * Errors in a chunk are recorded in the chunk itself and reported
+ * when the chunk is delivered. If @c deliver is set in the worker
+ * state, results are delivered after each processed chunk.
+ */
+static void *
+enum_worker(void *arg)
+{
+	struct enum_worker *worker = arg;
+	struct enum_ctl *ctl = worker->ctl;
+	struct enum_chunk *chunk;
+	addrxlat_status status;
+
+	while ( (chunk = next_chunk(ctl)) ) {
+		status = enum_chunk(worker->ctx, ctl->sys, chunk);
+		if (status != ADDRXLAT_OK) {
+			const char *err = err_str(&worker->ctx->err);
+			chunk->err = err ? strdup(err) : NULL;
+			chunk->status = status;
+		}
+
+		mutex_lock(&ctl->lock);
+		chunk->done = true;
+		if (status != ADDRXLAT_OK)
+			ctl->abort = true;
+		mutex_unlock(&ctl->lock);
+
+		if (worker->deliver) {
+			status = deliver_chunks(ctl);
+			if (status != ADDRXLAT_OK) {
+				abort_workers(ctl);
+				return (void *)(intptr_t)status;
+			}
+		}
+	}
+
+	return (void *)(intptr_t)ADDRXLAT_OK;
+}
+
+/** Add units of work for a range within one address window.
+ * @param ctl    Shared enumeration state.
+ * @param meth   Page table translation method.
+ * @param first  First virtual address.
+ * @param last   Last virtual address.
+ * @returns      @c true on success, @c false on allocation failure.
+ *
+ * All addresses between @p first and @p last must be translated using
+ * the same top-level table, i.e. they must differ only in bits that
+ * are used as page table indices.
+ */
+static bool
+add_chunks(struct enum_ctl *ctl, const addrxlat_meth_t *meth,
+	   addrxlat_addr_t first, addrxlat_addr_t last)
+{
+	const addrxlat_paging_form_t *pf = &meth->param.pgt.pf;
+	addrxlat_addr_t mask = pf_table_mask(pf, pf->nfields - 1);
+	struct enum_chunk *chunk;
+	addrxlat_addr_t end;
+
+	do {
+		end = first | mask;
+		if (end > last)
+			end = last;
+
+		if (ctl->nchunks == ctl->alloc) {
+			size_t newalloc = ctl->alloc ? 2 * ctl->alloc : 64;
+			chunk = realloc(ctl->chunks,
+					newalloc * sizeof(*chunk));
+			if (!chunk)
+				return false;
+			ctl->chunks = chunk;
+			ctl->alloc = newalloc;
+		}
+
+		chunk = &ctl->chunks[ctl->nchunks++];
+		memset(chunk, 0, sizeof(*chunk));
+		chunk->meth = meth;
+		chunk->first = first;
+		chunk->last = end;
+		first = end + 1;
+	} while (end < last);
+
+	return true;
+}
+
+/** Split address ranges into units of work.
+ * @param ctl      Shared enumeration state.
+ * @param ranges   Address ranges.
+ * @param nranges  Number of elements in @p ranges.
+ * @returns        @c true on success, @c false on allocation failure.
+ *
+ * Every unit of work covers (part of) one top-level page table entry.
+ * Page table indices do not cover all bits of a virtual address on
+ * most architectures. The remaining bits must be either zero or a
+ * sign extension, so only the address windows which contain the first
+ * and the last address of a range are enumerated. Any windows in
+ * between cannot be translated.
+ */
+static bool
+split_ranges(struct enum_ctl *ctl,
+	     const struct enum_range *ranges, size_t nranges)
+{
+	const struct enum_range *r;
+
+	for (r = ranges; r < &ranges[nranges]; ++r) {
+		const addrxlat_paging_form_t *pf = &r->meth->param.pgt.pf;
+		addrxlat_addr_t maxidx;
+		addrxlat_addr_t last;
+
+		if (r->meth->kind != ADDRXLAT_PGT || pf->nfields < 2)
+			continue;
+
+		maxidx = paging_max_index(pf);
+		last = r->first | maxidx;
+		if (last > r->last)
+			last = r->last;
+		if (!add_chunks(ctl, r->meth, r->first, last))
+			return false;
+		if (last < r->last &&
+		    !add_chunks(ctl, r->meth, r->last & ~maxidx, r->last))
+			return false;
+	}
+
+	return true;
+}
+
+/** Enumerate all present page table mappings.
+ * @param ctx       Address translation context.
+ * @param sys       Translation system.
+ * @param ranges    Virtual address ranges to be enumerated.
+ * @param nranges   Number of elements in @p ranges.
+ * @param nthreads  Number of threads to use.
+ * @param fn        Callback function.
+ * @param data      Arbitrary data passed to @p fn.
+ * @returns         Error status.
+ *
+ * The address ranges are split into units of work by top-level page
+ * table entries, and the units are processed by @p nthreads threads
+ * in parallel. Additional threads use a clone of @p ctx (see
+ * @ref ctx_clone). The callback is called only from the calling
+ * thread, with extents sorted by virtual address (provided that
+ * @p ranges is sorted), so the result does not depend on the number
+ * of threads. Adjacent extents are merged if they are contiguous both
+ * in virtual and target address space.
+ */
+addrxlat_status
+enum_pgt(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+	 const struct enum_range *ranges, size_t nranges,
+	 unsigned nthreads, addrxlat_extent_fn *fn, void *data)
+{
+	struct enum_ctl ctl;
+	struct enum_worker self;
+	struct enum_worker *workers;
+	unsigned nworkers;
+	int savednoerr;
+	size_t i;
+	addrxlat_status status;
+
+	memset(&ctl, 0, sizeof ctl);
+	ctl.ctx = ctx;
+	ctl.sys = sys;
+	ctl.fn = fn;
+	ctl.data = data;
+	if (!split_ranges(&ctl, ranges, nranges)) {
+		status = set_error(ctx, ADDRXLAT_ERR_NOMEM,
+				   "Cannot allocate enumeration chunks");
+		goto out_chunks;
+	}
+	if (mutex_init(&ctl.lock, NULL)) {
+		status = set_error(ctx, ADDRXLAT_ERR_NOMEM,
+				   "Cannot initialize enumeration lock");
+		goto out_chunks;
+	}
+
+	savednoerr = ctx->noerr.notpresent;
+	ctx->noerr.notpresent = 1;
+
+	if (nthreads > ctl.nchunks)
+		nthreads = ctl.nchunks;
+	workers = NULL;
+	nworkers = 0;
+#if USE_PTHREAD
+	if (nthreads > 1)
+		workers = calloc(nthreads - 1, sizeof(*workers));
+	if (workers) {
+		while (nworkers < nthreads - 1) {
+			struct enum_worker *worker = &workers[nworkers];
+			worker->ctl = &ctl;
+			worker->ctx = ctx_clone(ctx);
+			if (!worker->ctx)
+				break;
+			if (pthread_create(&worker->tid, NULL,
+					   enum_worker, worker)) {
+				ctx_clone_free(ctx, worker->ctx);
+				break;
+			}
+			++nworkers;
+		}
+	}
+#endif
+
+	self.ctl = &ctl;
+	self.ctx = ctx;
+	self.deliver = true;
+	status = (addrxlat_status)(intptr_t)enum_worker(&self);
+
+#if USE_PTHREAD
+	for (i = 0; i < nworkers; ++i) {
+		pthread_join(workers[i].tid, NULL);
+		ctx_clone_free(ctx, workers[i].ctx);
+	}
+#endif
+	if (workers)
+		free(workers);
+
+	ctx->noerr.notpresent = savednoerr;
+
+	if (status == ADDRXLAT_OK)
+		status = deliver_chunks(&ctl);
+	if (status == ADDRXLAT_OK && ctl.have_cur)
+		status = fn(data, &ctl.cur);
+	mutex_destroy(&ctl.lock);
+
+ out_chunks:
+	for (i = 0; i < ctl.nchunks; ++i) {
+		if (ctl.chunks[i].ext)
+			free(ctl.chunks[i].ext);
+		if (ctl.chunks[i].err)
+			free(ctl.chunks[i].err);
+	}
+	if (ctl.chunks)
+		free(ctl.chunks);
+	return status;
+}
+
+addrxlat_status
+addrxlat_enum_pgt(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+		  const addrxlat_meth_t *meth,
+		  addrxlat_addr_t first, addrxlat_addr_t last,
+		  unsigned nthreads, addrxlat_extent_fn *fn, void *data)
+{
+	struct enum_range range;
+
+	clear_error(ctx);
+
+	if (meth->kind != ADDRXLAT_PGT)
+		return set_error(ctx, ADDRXLAT_ERR_NOTIMPL,
+				 "Not a page table method");
+	if (first > last)
+		return ADDRXLAT_OK;
+
+	range.first = first;
+	range.last = last;
+	range.meth = meth;
+	return enum_pgt(ctx, sys, &range, 1, nthreads, fn, data);
+}
@@ -0,0 +1,310 @@
+/** @internal @file src/addrxlat/rmap.c
+ * @brief Reverse address translation index.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "addrxlat-priv.h"
+
+/**  Reverse address translation index.
+ */
+struct _addrxlat_rmap {
+	/** Reference counter. */
+	unsigned long refcnt;
+
+	/** Number of extents. */
+	size_t n;
+
+	/** Extents, sorted by target address. */
+	addrxlat_extent_t *ext;
+
+	/** Number of allocated elements in @c ext. */
+	size_t alloc;
+};
+
+/** Add an extent to a reverse index under construction.
+ * @param data  Reverse index.
+ * @param ext   Mapped extent.
+ * @returns     Error status.
+ */
+static addrxlat_status
+rmap_add(void *data, const addrxlat_extent_t *ext)
+{
+	addrxlat_rmap_t *rmap = data;
+
+	if (rmap->n == rmap->alloc) {
+		size_t newalloc = rmap->alloc ? 2 * rmap->alloc : 64;
+		addrxlat_extent_t *newext =
+			realloc(rmap->ext, newalloc * sizeof(*newext));
+		if (!newext)
+			return ADDRXLAT_ERR_NOMEM;
+		rmap->ext = newext;
+		rmap->alloc = newalloc;
+	}
+
+	rmap->ext[rmap->n++] = *ext;
+	return ADDRXLAT_OK;
+}
+
+/** Compare two extents by their target address.
+ * @param a  First extent.
+ * @param b  Second extent.
+ * @returns  Negative, zero or positive (see @c qsort).
+ *
+ * Extents with the same target address are sorted by virtual address.
+ */
+static int
+extent_cmp(const void *a, const void *b)
+{
+	const addrxlat_extent_t *ea = a, *eb = b;
+
+	if (ea->paddr.as != eb->paddr.as)
+		return ea->paddr.as < eb->paddr.as ? -1 : 1;
+	if (ea->paddr.addr != eb->paddr.addr)
+		return ea->paddr.addr < eb->paddr.addr ? -1 : 1;
+	if (ea->vaddr != eb->vaddr)
+		return ea->vaddr < eb->vaddr ? -1 : 1;
+	return 0;
+}
+
+/** Sort a reverse index and remove overlaps.
+ * @param rmap  Reverse index.
+ *
+ * If a target address is covered by more than one extent, only the
+ * extent which comes first in the sort order is kept for that part.
+ * Extents which are contiguous both in target and virtual address
+ * space are merged.
+ */
+static void
+rmap_finish(addrxlat_rmap_t *rmap)
+{
+	addrxlat_extent_t *last, *ext, *end;
+	addrxlat_extent_t *newext;
+
+	if (!rmap->n)
+		return;
+
+	qsort(rmap->ext, rmap->n, sizeof(*rmap->ext), extent_cmp);
+
+	last = rmap->ext;
+	end = &rmap->ext[rmap->n];
+	for (ext = last + 1; ext < end; ++ext) {
+		addrxlat_addr_t lastend = last->paddr.addr + last->endoff;
+
+		if (ext->paddr.as == last->paddr.as &&
+		    ext->paddr.addr <= lastend) {
+			addrxlat_addr_t skip;
+
+			if (ext->paddr.addr + ext->endoff <= lastend)
+				continue;
+			skip = lastend - ext->paddr.addr + 1;
+			ext->vaddr += skip;
+			ext->paddr.addr += skip;
+			ext->endoff -= skip;
+		}
+
+		if (ext->paddr.as == last->paddr.as &&
+		    ext->paddr.addr == lastend + 1 &&
+		    ext->vaddr == last->vaddr + last->endoff + 1) {
+			last->endoff += ext->endoff + 1;
+			continue;
+		}
+
+		*++last = *ext;
+	}
+	rmap->n = last - rmap->ext + 1;
+
+	newext = realloc(rmap->ext, rmap->n * sizeof(*newext));
+	if (newext) {
+		rmap->ext = newext;
+		rmap->alloc = rmap->n;
+	}
+}
+
+/** Check whether a map range is translated using page tables.
+ * @param sys  Translation system.
+ * @param r    Map range.
+ * @returns    Non-zero if @p r uses a page table method.
+ */
+static inline bool
+is_pgt_range(const addrxlat_sys_t *sys, const addrxlat_range_t *r)
+{
+	return r->meth != ADDRXLAT_SYS_METH_NONE &&
+		sys->meth[r->meth].kind == ADDRXLAT_PGT;
+}
+
+/** Count ranges which are translated using page tables.
+ * @param sys  Translation system.
+ * @param map  Kernel virtual to physical map.
+ * @returns    Number of page table ranges in @p map.
+ */
+static size_t
+count_pgt_ranges(const addrxlat_sys_t *sys, const addrxlat_map_t *map)
+{
+	const addrxlat_range_t *r;
+	size_t n = 0;
+
+	for (r = map->ranges; r < &map->ranges[map->n]; ++r)
+		if (is_pgt_range(sys, r))
+			++n;
+	return n;
+}
+
+/** Get ranges which are translated using page tables.
+ * @param sys     Translation system.
+ * @param map     Kernel virtual to physical map.
+ * @param ranges  Array of @ref count_pgt_ranges elements.
+ */
+static void
+get_pgt_ranges(addrxlat_sys_t *sys, const addrxlat_map_t *map,
+	       struct enum_range *ranges)
+{
+	const addrxlat_range_t *r;
+	addrxlat_addr_t addr = 0;
+
+	for (r = map->ranges; r < &map->ranges[map->n]; ++r) {
+		if (is_pgt_range(sys, r)) {
+			ranges->first = addr;
+			ranges->last = addr + r->endoff;
+			ranges->meth = &sys->meth[r->meth];
+			++ranges;
+		}
+		addr += r->endoff + 1;
+	}
+}
+
+addrxlat_status
+addrxlat_rmap_build(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+		    unsigned nthreads, addrxlat_rmap_t **prmap)
+{
+	const addrxlat_map_t *map = sys->map[ADDRXLAT_SYS_MAP_KV_PHYS];
+	struct enum_range *ranges;
+	size_t nranges;
+	addrxlat_rmap_t *rmap;
+	addrxlat_status status;
+
+	clear_error(ctx);
+
+	rmap = calloc(1, sizeof(addrxlat_rmap_t));
+	if (!rmap)
+		return set_error(ctx, ADDRXLAT_ERR_NOMEM,
+				 "Cannot allocate reverse index");
+	rmap->refcnt = 1;
+
+	ranges = NULL;
+	nranges = map ? count_pgt_ranges(sys, map) : 0;
+	if (nranges) {
+		ranges = malloc(nranges * sizeof(*ranges));
+		if (!ranges) {
+			addrxlat_rmap_decref(rmap);
+			return set_error(ctx, ADDRXLAT_ERR_NOMEM,
+					 "Cannot allocate enumeration ranges");
+		}
+		get_pgt_ranges(sys, map, ranges);
+	}
+
+	status = enum_pgt(ctx, sys, ranges, nranges, nthreads,
+			  rmap_add, rmap);
+	free(ranges);
+	if (status != ADDRXLAT_OK) {
+		addrxlat_rmap_decref(rmap);
+		return status == ADDRXLAT_ERR_NOMEM
+			? set_error(ctx, status,
+				    "Cannot allocate reverse index")
+			: status;
+	}
+
+	rmap_finish(rmap);
+	*prmap = rmap;
+	return ADDRXLAT_OK;
+}
+
+unsigned long
+addrxlat_rmap_incref(addrxlat_rmap_t *rmap)
+{
+	return ++rmap->refcnt;
+}
+
+unsigned long
+addrxlat_rmap_decref(addrxlat_rmap_t *rmap)
+{
+	unsigned long refcnt = --rmap->refcnt;
+	if (!refcnt) {
+		if (rmap->ext)
+			free(rmap->ext);
+		free(rmap);
+	}
+	return refcnt;
+}
+
+size_t
+addrxlat_rmap_len(const addrxlat_rmap_t *rmap)
+{
+	return rmap->n;
+}
+
+const addrxlat_extent_t *
+addrxlat_rmap_extents(const addrxlat_rmap_t *rmap)
+{
+	return rmap->ext;
+}
+
+addrxlat_status
+addrxlat_phys_to_virt(const addrxlat_rmap_t *rmap,
+		      const addrxlat_fulladdr_t *paddr,
+		      addrxlat_addr_t *vaddr)
+{
+	const addrxlat_extent_t *ext;
+	size_t lo, hi, mid;
+
+	/* Find the last extent which starts at or below paddr. */
+	lo = 0;
+	hi = rmap->n;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		ext = &rmap->ext[mid];
+		if (ext->paddr.as < paddr->as ||
+		    (ext->paddr.as == paddr->as &&
+		     ext->paddr.addr <= paddr->addr))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo)
+		return ADDRXLAT_ERR_NOTPRESENT;
+
+	ext = &rmap->ext[lo - 1];
+	if (ext->paddr.as != paddr->as ||
+	    paddr->addr - ext->paddr.addr > ext->endoff)
+		return ADDRXLAT_ERR_NOTPRESENT;
+
+	*vaddr = ext->vaddr + (paddr->addr - ext->paddr.addr);
+	return ADDRXLAT_OK;
+}
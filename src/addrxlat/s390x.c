@@ -147,6 +147,159 @@ pgt_s390x(addrxlat_step_t *step)
 	return ADDRXLAT_OK;
 }
 
+/** Page table index bits */
+#define PGTBL_BITS	8
+
+/** Specialized IBM z/Architecture page table walker.
+ * @param step    Step state, initialized as for @ref addrxlat_walk.
+ * @param levels  Number of paging levels (2 to 5).
+ * @returns       Error status.
+ *
+ * This function is meant to be inlined with a constant @p levels,
+ * so all shifts and masks are known at compile time and the loop
+ * over paging levels can be fully unrolled.
+ *
+ * Region tables with a partial length (table offset or table length
+ * other than the full table) are left to the generic walker.
+ */
+static inline __attribute__((always_inline)) addrxlat_status
+walk_s390x(addrxlat_step_t *step, const unsigned short levels)
+{
+	const unsigned short va_bits =
+		SFAA_BITS + (levels - 1) * REGTBL_BITS;
+	const addrxlat_param_pgt_t *pgt = &step->meth->param.pgt;
+	addrxlat_addr_t addr = step->base.addr;
+	addrxlat_addr_t mask;
+	unsigned long caps;
+	unsigned short lvl;
+	addrxlat_pte_t pte;
+	addrxlat_status status;
+
+	if (va_bits < 64 && (addr >> va_bits))
+		return ADDRXLAT_ERR_INVALID;
+
+	if (pgt->root.as == ADDRXLAT_NOADDR)
+		return ADDRXLAT_ERR_NODATA;
+
+	caps = step->ctx->cb->read_caps(step->ctx->cb);
+	step->base = pgt->root;
+	mask = PAGE_MASK;
+
+#pragma GCC unroll 8
+	for (lvl = levels; lvl > 0; --lvl) {
+		unsigned short shift = (lvl == 1)
+			? PAGE_SHIFT
+			: SFAA_BITS + (lvl - 2) * REGTBL_BITS;
+		unsigned short bits = (lvl == 1)
+			? PGTBL_BITS
+			: REGTBL_BITS;
+		step->base.addr += ((addr >> shift) & ADDR_MASK(bits))
+			* sizeof(uint64_t);
+		status = fast_read_pte64(step, caps, &step->base,
+					 ADDRXLAT_BIG_ENDIAN, &pte);
+		if (status != ADDRXLAT_OK)
+			return status;
+		step->raw.pte = pte;
+		pte &= ~pgt->pte_mask;
+
+		if (lvl == 1) {
+			if (PTE_I(pte))
+				return ADDRXLAT_ERR_NOTPRESENT;
+			step->base.addr = pte & ~PAGE_MASK;
+			break;
+		}
+
+		if (RSTE_I(pte))
+			return ADDRXLAT_ERR_NOTPRESENT;
+		if (RSTE_TT(pte) != lvl - 2)
+			return ADDRXLAT_ERR_INVALID;
+
+		if ((lvl == 3 || lvl == 2) && RSTE_FC(pte)) {
+			mask = (lvl == 3) ? RFAA_MASK : SFAA_MASK;
+			step->base.addr = pte & ~mask;
+			break;
+		}
+
+		if (lvl >= 3) {
+			if (RSTE_TF(pte) != 0 || RSTE_TL(pte) != 3)
+				return ADDRXLAT_ERR_NOTIMPL;
+			step->base.addr = pte & ~PAGE_MASK;
+		} else
+			step->base.addr = pte & ~PTO_MASK;
+	}
+
+	step->base.addr |= addr & mask;
+	step->base.as = step->meth->target_as;
+	step->remain = 0;
+	step->elemsz = 0;
+	return ADDRXLAT_OK;
+}
+
+/** Specialized walker for 2-level paging (31-bit VA).
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_s390x_2l(addrxlat_step_t *step)
+{
+	return walk_s390x(step, 2);
+}
+
+/** Specialized walker for 3-level paging (42-bit VA).
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_s390x_3l(addrxlat_step_t *step)
+{
+	return walk_s390x(step, 3);
+}
+
+/** Specialized walker for 4-level paging (53-bit VA).
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_s390x_4l(addrxlat_step_t *step)
+{
+	return walk_s390x(step, 4);
+}
+
+/** Specialized walker for 5-level paging (64-bit VA).
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_s390x_5l(addrxlat_step_t *step)
+{
+	return walk_s390x(step, 5);
+}
+
+/** Select a specialized IBM z/Architecture page table walker.
+ * @param pf  Paging form.
+ * @returns   Specialized walker, or @c NULL if there is none.
+ */
+pgt_walk_fn *
+pgt_walker_s390x(const addrxlat_paging_form_t *pf)
+{
+	unsigned short i;
+
+	if (pf->nfields < 3 ||
+	    pf->fieldsz[0] != PAGE_SHIFT || pf->fieldsz[1] != PGTBL_BITS)
+		return NULL;
+	for (i = 2; i < pf->nfields; ++i)
+		if (pf->fieldsz[i] != REGTBL_BITS)
+			return NULL;
+
+	switch (pf->nfields) {
+	case 3:	return walk_s390x_2l;
+	case 4:	return walk_s390x_3l;
+	case 5:	return walk_s390x_4l;
+	case 6:	return walk_s390x_5l;
+	default: return NULL;
+	}
+}
+
 /** Determine OS-specific page table root.
  * @param ctl        Initialization data.
  * @param[out] root  Page table root address (set on successful return).
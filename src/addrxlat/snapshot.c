@@ -0,0 +1,528 @@
+/** @internal @file src/addrxlat/snapshot.c
+ * @brief Translation system snapshots.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "addrxlat-priv.h"
+
+/* Snapshot format
+ *
+ * All numbers are stored in little-endian byte order.
+ *
+ *   magic[8]	"ADDRXLAT"
+ *   u32	format version (@ref SNAP_VERSION)
+ *   u64	key
+ *   u32	number of methods (@ref ADDRXLAT_SYS_METH_NUM)
+ *   method[]	translation methods
+ *   u32	number of maps (@ref ADDRXLAT_SYS_MAP_NUM)
+ *   map[]	translation maps
+ *
+ * Each method starts with its kind (u32) and target address space (u32),
+ * followed by kind-specific parameters. Each map starts with the number
+ * of ranges (u64), or @ref SNAP_NOMAP if the map is not set, followed by
+ * the ranges (u64 end offset, u32 method index).
+ */
+
+/** Snapshot magic bytes. */
+static const char snap_magic[8] = "ADDRXLAT";
+
+/** Snapshot format version. */
+#define SNAP_VERSION	1
+
+/** Number of ranges for a map which is not set. */
+#define SNAP_NOMAP	(~(uint64_t)0)
+
+/** Snapshot being written.
+ */
+struct snap_writer {
+	/** Output buffer. */
+	unsigned char *data;
+
+	/** Used bytes in @c data. */
+	size_t len;
+
+	/** Allocated bytes in @c data. */
+	size_t alloc;
+
+	/** Set if memory allocation failed. */
+	bool nomem;
+};
+
+/** Snapshot being read.
+ */
+struct snap_reader {
+	/** Current position. */
+	const unsigned char *p;
+
+	/** End of snapshot data. */
+	const unsigned char *end;
+
+	/** Set if the data is truncated. */
+	bool short_read;
+};
+
+/** Append a little-endian number to a snapshot.
+ * @param w    Snapshot writer.
+ * @param val  Value to be written.
+ * @param sz   Size of the number in bytes.
+ */
+static void
+put_num(struct snap_writer *w, uint64_t val, unsigned sz)
+{
+	if (w->nomem)
+		return;
+
+	if (w->len + sz > w->alloc) {
+		size_t newalloc = w->alloc ? 2 * w->alloc : 1024;
+		unsigned char *newdata = realloc(w->data, newalloc);
+		if (!newdata) {
+			w->nomem = true;
+			return;
+		}
+		w->data = newdata;
+		w->alloc = newalloc;
+	}
+
+	while (sz--) {
+		w->data[w->len++] = val & 0xff;
+		val >>= 8;
+	}
+}
+
+/** Get the number of unread bytes in a snapshot.
+ * @param r  Snapshot reader.
+ * @returns  Number of bytes between the current position and the end.
+ */
+static inline size_t
+snap_left(const struct snap_reader *r)
+{
+	return r->end - r->p;
+}
+
+/** Read a little-endian number from a snapshot.
+ * @param r   Snapshot reader.
+ * @param sz  Size of the number in bytes.
+ * @returns   Value, or zero if the snapshot is truncated.
+ */
+static uint64_t
+get_num(struct snap_reader *r, unsigned sz)
+{
+	uint64_t val = 0;
+	unsigned i;
+
+	if (snap_left(r) < sz) {
+		r->short_read = true;
+		return 0;
+	}
+
+	for (i = 0; i < sz; ++i)
+		val |= (uint64_t)r->p[i] << (8 * i);
+	r->p += sz;
+	return val;
+}
+
+#define put_u16(w, val)	put_num(w, val, 2)
+#define put_u32(w, val)	put_num(w, val, 4)
+#define put_u64(w, val)	put_num(w, val, 8)
+#define get_u16(r)	get_num(r, 2)
+#define get_u32(r)	get_num(r, 4)
+#define get_u64(r)	get_num(r, 8)
+
+/** Write a translation method to a snapshot.
+ * @param ctx   Address translation context.
+ * @param w     Snapshot writer.
+ * @param meth  Translation method.
+ * @returns     Error status.
+ */
+static addrxlat_status
+save_meth(addrxlat_ctx_t *ctx, struct snap_writer *w,
+	  const addrxlat_meth_t *meth)
+{
+	const addrxlat_param_t *param = &meth->param;
+	size_t i;
+
+	put_u32(w, meth->kind);
+	put_u32(w, meth->target_as);
+
+	switch (meth->kind) {
+	case ADDRXLAT_NOMETH:
+		break;
+
+	case ADDRXLAT_LINEAR:
+		put_u64(w, param->linear.off);
+		break;
+
+	case ADDRXLAT_PGT:
+		put_u32(w, param->pgt.root.as);
+		put_u64(w, param->pgt.root.addr);
+		put_u64(w, param->pgt.pte_mask);
+		put_u32(w, param->pgt.pf.pte_format);
+		put_u16(w, param->pgt.pf.nfields);
+		for (i = 0; i < ADDRXLAT_FIELDS_MAX; ++i)
+			put_u16(w, param->pgt.pf.fieldsz[i]);
+		break;
+
+	case ADDRXLAT_LOOKUP:
+		put_u64(w, param->lookup.endoff);
+		put_u64(w, param->lookup.nelem);
+		for (i = 0; i < param->lookup.nelem; ++i) {
+			put_u64(w, param->lookup.tbl[i].orig);
+			put_u64(w, param->lookup.tbl[i].dest);
+		}
+		break;
+
+	case ADDRXLAT_MEMARR:
+		put_u32(w, param->memarr.base.as);
+		put_u64(w, param->memarr.base.addr);
+		put_u32(w, param->memarr.shift);
+		put_u32(w, param->memarr.elemsz);
+		put_u32(w, param->memarr.valsz);
+		break;
+
+	default:
+		return set_error(ctx, ADDRXLAT_ERR_NOTIMPL,
+				 "Cannot save translation method kind %u",
+				 (unsigned) meth->kind);
+	}
+
+	return ADDRXLAT_OK;
+}
+
+/** Write a translation map to a snapshot.
+ * @param w    Snapshot writer.
+ * @param map  Translation map (may be @c NULL).
+ */
+static void
+save_map(struct snap_writer *w, const addrxlat_map_t *map)
+{
+	size_t i;
+
+	if (!map) {
+		put_u64(w, SNAP_NOMAP);
+		return;
+	}
+
+	put_u64(w, map->n);
+	for (i = 0; i < map->n; ++i) {
+		put_u64(w, map->ranges[i].endoff);
+		put_u32(w, map->ranges[i].meth);
+	}
+}
+
+addrxlat_status
+addrxlat_sys_save(addrxlat_ctx_t *ctx, const addrxlat_sys_t *sys,
+		  uint64_t key, void **pbuf, size_t *psize)
+{
+	struct snap_writer w;
+	addrxlat_status status;
+	unsigned i;
+
+	clear_error(ctx);
+
+	memset(&w, 0, sizeof w);
+	for (i = 0; i < sizeof snap_magic; ++i)
+		put_num(&w, snap_magic[i], 1);
+	put_u32(&w, SNAP_VERSION);
+	put_u64(&w, key);
+
+	put_u32(&w, ADDRXLAT_SYS_METH_NUM);
+	for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i) {
+		status = save_meth(ctx, &w, &sys->meth[i]);
+		if (status != ADDRXLAT_OK) {
+			if (w.data)
+				free(w.data);
+			return status;
+		}
+	}
+
+	put_u32(&w, ADDRXLAT_SYS_MAP_NUM);
+	for (i = 0; i < ADDRXLAT_SYS_MAP_NUM; ++i)
+		save_map(&w, sys->map[i]);
+
+	if (w.nomem) {
+		if (w.data)
+			free(w.data);
+		return set_error(ctx, ADDRXLAT_ERR_NOMEM,
+				 "Cannot allocate snapshot buffer");
+	}
+
+	*pbuf = w.data;
+	*psize = w.len;
+	return ADDRXLAT_OK;
+}
+
+/** Read a translation method from a snapshot.
+ * @param r       Snapshot reader.
+ * @param meth    Translation method (filled in on success).
+ * @param tbl     Next free element for lookup tables (updated).
+ * @param tblcnt  Total number of lookup table elements (updated).
+ * @returns       @c true on success, @c false if the data is invalid.
+ *
+ * If @c *tbl is @c NULL, lookup table elements are only counted.
+ */
+static bool
+load_meth(struct snap_reader *r, addrxlat_meth_t *meth,
+	  addrxlat_lookup_elem_t **tbl, size_t *tblcnt)
+{
+	addrxlat_param_t *param = &meth->param;
+	size_t i;
+
+	memset(meth, 0, sizeof *meth);
+	meth->kind = get_u32(r);
+	meth->target_as = (int32_t)get_u32(r);
+
+	switch (meth->kind) {
+	case ADDRXLAT_NOMETH:
+		break;
+
+	case ADDRXLAT_LINEAR:
+		param->linear.off = get_u64(r);
+		break;
+
+	case ADDRXLAT_PGT:
+		param->pgt.root.as = (int32_t)get_u32(r);
+		param->pgt.root.addr = get_u64(r);
+		param->pgt.pte_mask = get_u64(r);
+		param->pgt.pf.pte_format = (int32_t)get_u32(r);
+		param->pgt.pf.nfields = get_u16(r);
+		for (i = 0; i < ADDRXLAT_FIELDS_MAX; ++i)
+			param->pgt.pf.fieldsz[i] = get_u16(r);
+		if (param->pgt.pf.nfields > ADDRXLAT_FIELDS_MAX)
+			return false;
+		break;
+
+	case ADDRXLAT_LOOKUP:
+		param->lookup.endoff = get_u64(r);
+		param->lookup.nelem = get_u64(r);
+		if (snap_left(r) / (2 * sizeof(uint64_t)) <
+		    param->lookup.nelem)
+			return false;
+		if (*tbl) {
+			param->lookup.tbl = *tbl;
+			*tbl += param->lookup.nelem;
+		}
+		*tblcnt += param->lookup.nelem;
+		for (i = 0; i < param->lookup.nelem; ++i) {
+			uint64_t orig = get_u64(r);
+			uint64_t dest = get_u64(r);
+			if (param->lookup.tbl) {
+				param->lookup.tbl[i].orig = orig;
+				param->lookup.tbl[i].dest = dest;
+			}
+		}
+		break;
+
+	case ADDRXLAT_MEMARR:
+		param->memarr.base.as = (int32_t)get_u32(r);
+		param->memarr.base.addr = get_u64(r);
+		param->memarr.shift = get_u32(r);
+		param->memarr.elemsz = get_u32(r);
+		param->memarr.valsz = get_u32(r);
+		break;
+
+	default:
+		return false;
+	}
+
+	return !r->short_read;
+}
+
+/** Read a translation map from a snapshot.
+ * @param r     Snapshot reader.
+ * @param pmap  Translation map (set on success, may be @c NULL).
+ * @returns     Error status.
+ *
+ * The ranges of a non-empty map must cover the whole address space,
+ * like the ranges of any map built with @ref addrxlat_map_set.
+ */
+static addrxlat_status
+load_map(struct snap_reader *r, addrxlat_map_t **pmap)
+{
+	addrxlat_map_t *map;
+	addrxlat_addr_t addr;
+	uint64_t n;
+	size_t i;
+
+	*pmap = NULL;
+	n = get_u64(r);
+	if (r->short_read)
+		return ADDRXLAT_ERR_INVALID;
+	if (n == SNAP_NOMAP)
+		return ADDRXLAT_OK;
+	if (snap_left(r) / (sizeof(uint64_t) + sizeof(uint32_t)) < n)
+		return ADDRXLAT_ERR_INVALID;
+
+	map = internal_map_new();
+	if (!map)
+		return ADDRXLAT_ERR_NOMEM;
+	if (n) {
+		map->ranges = malloc(n * sizeof(map->ranges[0]));
+		if (!map->ranges) {
+			internal_map_decref(map);
+			return ADDRXLAT_ERR_NOMEM;
+		}
+	}
+
+	map->n = n;
+	addr = 0;
+	for (i = 0; i < n; ++i) {
+		map->ranges[i].endoff = get_u64(r);
+		map->ranges[i].meth = (int32_t)get_u32(r);
+		if (map->ranges[i].meth < ADDRXLAT_SYS_METH_NONE ||
+		    map->ranges[i].meth >= ADDRXLAT_SYS_METH_NUM)
+			goto err_invalid;
+
+		/* All but the last range must end below the maximum
+		 * address, and the last range must end exactly there.
+		 */
+		if (map->ranges[i].endoff > ADDRXLAT_ADDR_MAX - addr)
+			goto err_invalid;
+		addr += map->ranges[i].endoff;
+		if ((addr == ADDRXLAT_ADDR_MAX) != (i == n - 1))
+			goto err_invalid;
+		++addr;
+	}
+
+	*pmap = map;
+	return ADDRXLAT_OK;
+
+ err_invalid:
+	internal_map_decref(map);
+	return ADDRXLAT_ERR_INVALID;
+}
+
+/** Check the header of a snapshot.
+ * @param ctx  Address translation context.
+ * @param r    Snapshot reader (positioned after the header on success).
+ * @param key  Expected snapshot key.
+ * @returns    Error status.
+ */
+static addrxlat_status
+check_header(addrxlat_ctx_t *ctx, struct snap_reader *r, uint64_t key)
+{
+	if (snap_left(r) < sizeof snap_magic ||
+	    memcmp(r->p, snap_magic, sizeof snap_magic))
+		return set_error(ctx, ADDRXLAT_ERR_INVALID,
+				 "Not a translation system snapshot");
+	r->p += sizeof snap_magic;
+
+	if (get_u32(r) != SNAP_VERSION || r->short_read)
+		return set_error(ctx, ADDRXLAT_ERR_INVALID,
+				 "Unsupported snapshot version");
+	if (get_u64(r) != key || r->short_read)
+		return set_error(ctx, ADDRXLAT_ERR_INVALID,
+				 "Snapshot key mismatch");
+	if (get_u32(r) != ADDRXLAT_SYS_METH_NUM || r->short_read)
+		return set_error(ctx, ADDRXLAT_ERR_INVALID,
+				 "Snapshot method count mismatch");
+	return ADDRXLAT_OK;
+}
+
+addrxlat_status
+addrxlat_sys_load(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+		  uint64_t key, const void *buf, size_t size)
+{
+	addrxlat_meth_t meth[ADDRXLAT_SYS_METH_NUM];
+	addrxlat_map_t *map[ADDRXLAT_SYS_MAP_NUM];
+	addrxlat_lookup_elem_t *tbl, *nexttbl;
+	struct snap_reader r, start;
+	size_t tblcnt;
+	addrxlat_status status;
+	unsigned i;
+
+	clear_error(ctx);
+
+	r.p = buf;
+	r.end = r.p + size;
+	r.short_read = false;
+	status = check_header(ctx, &r, key);
+	if (status != ADDRXLAT_OK)
+		return status;
+
+	/* Count lookup table elements first. */
+	start = r;
+	tblcnt = 0;
+	nexttbl = NULL;
+	for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i)
+		if (!load_meth(&r, &meth[i], &nexttbl, &tblcnt))
+			return set_error(ctx, ADDRXLAT_ERR_INVALID,
+					 "Invalid translation method #%u", i);
+
+	tbl = NULL;
+	if (tblcnt) {
+		tbl = malloc(tblcnt * sizeof(*tbl));
+		if (!tbl)
+			return set_error(ctx, ADDRXLAT_ERR_NOMEM,
+					 "Cannot allocate lookup tables");
+		r = start;
+		nexttbl = tbl;
+		tblcnt = 0;
+		for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i)
+			load_meth(&r, &meth[i], &nexttbl, &tblcnt);
+	}
+
+	if (get_u32(&r) != ADDRXLAT_SYS_MAP_NUM || r.short_read) {
+		status = set_error(ctx, ADDRXLAT_ERR_INVALID,
+				   "Snapshot map count mismatch");
+		goto err_tbl;
+	}
+	for (i = 0; i < ADDRXLAT_SYS_MAP_NUM; ++i) {
+		status = load_map(&r, &map[i]);
+		if (status != ADDRXLAT_OK) {
+			status = status == ADDRXLAT_ERR_NOMEM
+				? set_error(ctx, status,
+					    "Cannot allocate map #%u", i)
+				: set_error(ctx, status,
+					    "Invalid translation map #%u", i);
+			goto err_map;
+		}
+	}
+
+	sys_cleanup(sys);
+	for (i = 0; i < ADDRXLAT_SYS_MAP_NUM; ++i)
+		sys->map[i] = map[i];
+	for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i) {
+		sys->meth[i] = meth[i];
+		sys->walk[i] = pgt_walker(&sys->meth[i]);
+	}
+	sys->lookup_tbl = tbl;
+	sys->lookup_cnt = tblcnt;
+	return ADDRXLAT_OK;
+
+ err_map:
+	while (i--)
+		if (map[i])
+			internal_map_decref(map[i]);
+ err_tbl:
+	if (tbl)
+		free(tbl);
+	return status;
+}
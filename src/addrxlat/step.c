@@ -576,15 +576,73 @@ addrxlat_step(addrxlat_step_t *step)
 	return next_step(step);
 }
 
+/** Select a specialized page table walker.
+ * @param meth  Translation method.
+ * @returns     Specialized walker, or @c NULL if there is none.
+ *
+ * Specialized walkers exist only for the most common page table
+ * formats and layouts.
+ */
+pgt_walk_fn *
+pgt_walker(const addrxlat_meth_t *meth)
+{
+	const addrxlat_paging_form_t *pf = &meth->param.pgt.pf;
+
+	if (meth->kind != ADDRXLAT_PGT)
+		return NULL;
+
+	switch (pf->pte_format) {
+	case ADDRXLAT_PTE_AARCH64:
+		return pgt_walker_aarch64(pf);
+
+	case ADDRXLAT_PTE_S390X:
+		return pgt_walker_s390x(pf);
+
+	case ADDRXLAT_PTE_X86_64:
+		return pgt_walker_x86_64(pf);
+
+	default:
+		return NULL;
+	}
+}
+
+/** Get the specialized walker for a translation step.
+ * @param step  Initialized translation step state.
+ * @returns     Specialized walker, or @c NULL if there is none.
+ *
+ * Walkers are selected when a method is stored in a translation
+ * system, so only methods that belong to @c step->sys can use one.
+ */
+static inline pgt_walk_fn *
+step_walker(const addrxlat_step_t *step)
+{
+	const addrxlat_sys_t *sys = step->sys;
+
+	if (sys && step->meth >= &sys->meth[0] &&
+	    step->meth < &sys->meth[ADDRXLAT_SYS_METH_NUM])
+		return sys->walk[step->meth - sys->meth];
+	return NULL;
+}
+
 DEFINE_ALIAS(walk);
 
 addrxlat_status
 addrxlat_walk(addrxlat_step_t *step)
 {
+	pgt_walk_fn *walk;
 	addrxlat_status status;
 
 	clear_error(step->ctx);
 
+	walk = step_walker(step);
+	if (walk) {
+		addrxlat_addr_t addr = step->base.addr;
+		if (walk(step) == ADDRXLAT_OK)
+			return ADDRXLAT_OK;
+		clear_error(step->ctx);
+		step->base.addr = addr;
+	}
+
 	status = first_step(step, step->base.addr);
 	if (status != ADDRXLAT_OK || !step->remain)
 		return status;
@@ -53,8 +53,11 @@ addrxlat_sys_incref(addrxlat_sys_t *sys)
 
 /** Clean up all translation system maps and methods.
  * @param sys  Translation system.
+ *
+ * Lookup tables loaded from a snapshot are freed, and methods which
+ * refer to them are reset to @ref ADDRXLAT_NOMETH.
  */
-static void
+void
 sys_cleanup(addrxlat_sys_t *sys)
 {
 	unsigned i;
@@ -64,6 +67,34 @@ sys_cleanup(addrxlat_sys_t *sys)
 			internal_map_decref(sys->map[i]);
 			sys->map[i] = NULL;
 		}
+
+	for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i) {
+		addrxlat_meth_t *meth = &sys->meth[i];
+		if (meth->kind == ADDRXLAT_LOOKUP && sys->lookup_tbl &&
+		    meth->param.lookup.tbl >= sys->lookup_tbl &&
+		    meth->param.lookup.tbl <
+		    sys->lookup_tbl + sys->lookup_cnt)
+			meth->kind = ADDRXLAT_NOMETH;
+		sys->walk[i] = NULL;
+	}
+
+	if (sys->lookup_tbl) {
+		free(sys->lookup_tbl);
+		sys->lookup_tbl = NULL;
+		sys->lookup_cnt = 0;
+	}
+}
+
+/** Select specialized page table walkers for all methods.
+ * @param sys  Translation system.
+ */
+static void
+sys_select_walkers(addrxlat_sys_t *sys)
+{
+	unsigned i;
+
+	for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i)
+		sys->walk[i] = pgt_walker(&sys->meth[i]);
 }
 
 unsigned long
@@ -216,7 +247,9 @@ addrxlat_sys_os_init(addrxlat_sys_t *sys, addrxlat_ctx_t *ctx,
 			ctl.os_type = OS_XEN;
 	}
 
-	return arch_fn(&ctl);
+	status = arch_fn(&ctl);
+	sys_select_walkers(sys);
+	return status;
 }
 
 void
@@ -241,6 +274,7 @@ addrxlat_sys_set_meth(addrxlat_sys_t *sys,
 		      addrxlat_sys_meth_t idx, const addrxlat_meth_t *meth)
 {
 	sys->meth[idx] = *meth;
+	sys->walk[idx] = pgt_walker(meth);
 }
 
 const addrxlat_meth_t *
@@ -182,6 +182,112 @@ pgt_x86_64(addrxlat_step_t *step)
 	return ADDRXLAT_OK;
 }
 
+/** Number of bits in a page table index. */
+#define PGT_INDEX_BITS		9
+
+/** Specialized AMD64 (Intel 64) page table walker.
+ * @param step    Step state, initialized as for @ref addrxlat_walk.
+ * @param levels  Number of paging levels (4 or 5).
+ * @returns       Error status.
+ *
+ * This function is meant to be inlined with a constant @p levels,
+ * so all shifts and masks are known at compile time and the loop
+ * over paging levels can be fully unrolled.
+ */
+static inline __attribute__((always_inline)) addrxlat_status
+walk_x86_64(addrxlat_step_t *step, const unsigned short levels)
+{
+	const unsigned short va_bits = PAGE_SHIFT + levels * PGT_INDEX_BITS;
+	const addrxlat_param_pgt_t *pgt = &step->meth->param.pgt;
+	addrxlat_addr_t addr = step->base.addr;
+	addrxlat_addr_t mask;
+	unsigned long caps;
+	unsigned short lvl;
+	addrxlat_pte_t pte;
+	addrxlat_status status;
+
+	/* Reject non-canonical addresses. */
+	if ((addrxlat_addr_t)((int64_t)(addr << (64 - va_bits))
+			      >> (64 - va_bits)) != addr)
+		return ADDRXLAT_ERR_INVALID;
+
+	if (pgt->root.as == ADDRXLAT_NOADDR)
+		return ADDRXLAT_ERR_NODATA;
+
+	caps = step->ctx->cb->read_caps(step->ctx->cb);
+	step->base = pgt->root;
+	mask = PAGE_MASK;
+
+#pragma GCC unroll 8
+	for (lvl = levels; lvl > 0; --lvl) {
+		unsigned short shift = PAGE_SHIFT + (lvl - 1) * PGT_INDEX_BITS;
+		step->base.addr += ((addr >> shift) & ADDR_MASK(PGT_INDEX_BITS))
+			* sizeof(uint64_t);
+		status = fast_read_pte64(step, caps, &step->base,
+					 ADDRXLAT_LITTLE_ENDIAN, &pte);
+		if (status != ADDRXLAT_OK)
+			return status;
+		step->raw.pte = pte;
+		pte &= ~pgt->pte_mask;
+		if (!(pte & _PAGE_PRESENT))
+			return ADDRXLAT_ERR_NOTPRESENT;
+
+		step->base.addr = pte & PHYSADDR_MASK & ~PAGE_MASK;
+		step->base.as = step->meth->target_as;
+		if ((lvl == 3 || lvl == 2) && (pte & _PAGE_PSE)) {
+			mask = (lvl == 3) ? PAGE_MASK_1G : PAGE_MASK_2M;
+			break;
+		}
+	}
+
+	step->base.addr = (step->base.addr & ~mask) | (addr & mask);
+	step->remain = 0;
+	step->elemsz = 0;
+	return ADDRXLAT_OK;
+}
+
+/** Specialized walker for 4-level paging.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_x86_64_4l(addrxlat_step_t *step)
+{
+	return walk_x86_64(step, 4);
+}
+
+/** Specialized walker for 5-level paging.
+ * @param step  Step state, initialized as for @ref addrxlat_walk.
+ * @returns     Error status.
+ */
+static addrxlat_status
+walk_x86_64_5l(addrxlat_step_t *step)
+{
+	return walk_x86_64(step, 5);
+}
+
+/** Select a specialized AMD64 (Intel 64) page table walker.
+ * @param pf  Paging form.
+ * @returns   Specialized walker, or @c NULL if there is none.
+ */
+pgt_walk_fn *
+pgt_walker_x86_64(const addrxlat_paging_form_t *pf)
+{
+	unsigned short i;
+
+	if (pf->fieldsz[0] != PAGE_SHIFT)
+		return NULL;
+	for (i = 1; i < pf->nfields; ++i)
+		if (pf->fieldsz[i] != PGT_INDEX_BITS)
+			return NULL;
+
+	switch (pf->nfields) {
+	case 5:	return walk_x86_64_4l;
+	case 6:	return walk_x86_64_5l;
+	default: return NULL;
+	}
+}
+
 /** Translate virtual to kernel physical using page tables.
  * @param sys    Translation system object.
  * @param ctx    Address translation object.
@@ -63,6 +63,13 @@
 #define _ALIAS_ASM(sym)
 #endif
 
+/** Number of read cache slots in libaddrxlat.
+ * This is also the number of page buffers that libaddrxlat may hold
+ * at the same time, so libkdumpfile uses it to size its pool of page
+ * I/O structures for address translation.
+ */
+#define ADDRXLAT_READ_CACHE_SLOTS	4
+
 /** Internal alias declaration. */
 #define DECLARE_ALIAS(sym)		\
 	extern typeof(PUB_NAME(sym))	\
@@ -33,7 +33,47 @@
 #include "kdumpfile-priv.h"
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**  Cache partitions.
+ */
+enum cache_part {
+	cp_unused,		/**< Entries that are not used */
+	cp_gprobe,		/**< Ghost probed entries */
+	cp_probe,		/**< Cached entries that were hit once */
+	cp_prec,		/**< Cached entries that were hit more than once */
+	cp_gprec,		/**< Ghost precious entries */
+	cp_inflight,		/**< Entries allocated for I/O */
+
+	CP_NUM			/**< Number of partitions */
+};
+
+/** Huge page size used if it cannot be determined at run time. */
+#define DEFAULT_HUGE_PAGE_SIZE	(2UL << 20)
+
+/** Grow the cache if at least 1 / GROW_GHOST_RATIO of misses were
+ * ghost hits, i.e. they would have been hits in a bigger cache.
+ */
+#define GROW_GHOST_RATIO	8
+
+/** Empty slot in the key index. */
+#define HASH_EMPTY	UINT_MAX
+
+/** Multiplier for Fibonacci hashing of cache keys. */
+#define HASH_MULT	0x9e3779b97f4a7c15ULL
+
+/** Entry may be referenced without holding the cache lock. */
+#define REF_VALID	(1U << 31)
+/** Entry was hit without the lock since the last eviction scan. */
+#define REF_HOT		(1U << 30)
+/** Mask for the actual reference count. */
+#define REF_COUNT	(REF_HOT - 1)
 
 /**  Simple cache.
  *
@@ -47,79 +87,198 @@
  * Cached entries have a non-NULL data pointer. Ghost entries do not have
  * any data, so their data pointer is NULL.
  *
- * The cache is implemented as a circular list. This allows to move around
- * entries without copying much data even if the cache is large.
- * The list is organized as follows:
+ * Each partition is a circular list, linked through entry indices.
+ * The list head of each partition is a sentinel entry, stored after the
+ * regular entries (see @ref part_head). The MRU entry of a partition is
+ * the next entry of its list head, and the LRU entry is the previous
+ * entry of its list head. This allows to move entries between partitions
+ * without copying much data even if the cache is large.
  *
- *               <-- ngprobe --> <- nprobe -> <- nprec -> <--- ngprec --->
- *     +--------+---------------+------------+-----------+----------------+
- *     | unused | ghost probed  |   probed   | precious  | ghost precious |
- *     +--------+---------------+------------+-----------+----------------+
- *             ^               ^            ^             ^                ^
- *             eprobe          gprobe     split       gprec            eprec
+ * Unused entries which still own a data buffer are kept at the head of
+ * the unused list, so a data buffer can be taken from the MRU entry
+ * without searching.
  *
+ * Entries that have been allocated for I/O but not yet committed back,
+ * are moved to an in-flight list. They are returned back to the cache
+ * later when the user calls @ref cache_insert or @ref cache_discard on
+ * the in-flight entry.
  *
- * Only the @ref split index and the four sizes are stored in the data
- * structure. The remaining pointers are found as a side effect of searching
- * the cache, and they are stored in @ref cache_search.
- *
- * Any partition may be empty; some pointers will share the same value in
- * that case.
+ * Every entry that carries a key (i.e. cached, ghost and in-flight
+ * entries) is also indexed by an open-addressing hash table, so it can
+ * be found without walking the lists. The table uses linear probing and
+ * it is always at least twice as big as the number of entries.
  *
- * Note that since the list is circular, the unused partition is between
- * the ghost probed and ghost precious partitions. This part of the cache is
- * usually empty after it has been used for some time.
+ * The reference count of each entry also contains two flags. Cached
+ * entries have @ref REF_VALID set, which allows @ref cache_get_entry_fast
+ * to take a reference without holding the cache lock. Such hits cannot
+ * update the lists, so they only set @ref REF_HOT. The recency update is
+ * deferred until eviction, similar to the CLOCK algorithm: a hot entry
+ * found at the LRU end is moved to the MRU end of the precious list
+ * instead of being evicted. Victims are claimed by clearing
+ * @ref REF_VALID atomically, which fails if the entry is referenced.
  *
- * Entries that have been allocated for I/O but not yet committed back,
- * are removed from the main list and added to an in-flight list.
- * They are returned back to the list later when the user calls
- * @ref cache_insert or @ref cache_discard on the in-flight entry.
+ * If a capacity limit is set with @ref cache_set_limit, the cache grows
+ * while a significant share of misses are ghost hits. Since growing
+ * moves all entries, it is deferred until no entries are referenced,
+ * and lock-free lookups are disabled until the cache reaches its limit.
  */
 struct cache {
-	unsigned split;		 /**< Split point between probed and precious
-				  *   entries (index of MRU probed entry) */
 	unsigned nprec;		 /**< Number of cached precious entries */
 	unsigned ngprec;	 /**< Number of ghost precious entries */
 	unsigned nprobe;	 /**< Number of cached probe entries */
 	unsigned ngprobe;	 /**< Number of ghost probe entries */
 	unsigned dprobe;	 /**< Desired number of cached probe entries */
 	unsigned cap;		 /**< Total cache capacity */
-	unsigned inflight;	 /**< Index of first in-flight entry */
 	unsigned ninflight;	 /**< Number of in-flight entries */
+	unsigned limit;		 /**< Capacity limit for adaptive growth */
+	unsigned nmiss;		 /**< Misses since the last growth check */
+	unsigned nghost;	 /**< Ghost hits since the last growth check */
+	bool grow;		 /**< Grow when no entries are referenced */
+	bool fast;		 /**< Lock-free lookups are allowed */
 
 	kdump_attr_value_t hits;   /**< Cache hits */
 	kdump_attr_value_t misses; /**< Cache misses */
+	kdump_attr_value_t evictions; /**< Evicted entries */
+	kdump_attr_value_t busy;   /**< Requests failed with all entries in use */
+
+	/** Occupancy published for statistics attributes.
+	 * These are copies of the counters above, which can be read
+	 * without holding the cache lock.
+	 */
+	struct {
+		kdump_attr_value_t prec;   /**< Copy of @c nprec */
+		kdump_attr_value_t probe;  /**< Copy of @c nprobe */
+		kdump_attr_value_t gprec;  /**< Copy of @c ngprec */
+		kdump_attr_value_t gprobe; /**< Copy of @c ngprobe */
+		kdump_attr_value_t inflight; /**< Copy of @c ninflight */
+		kdump_attr_value_t dprobe; /**< Copy of @c dprobe */
+	} occ;
+
+	unsigned hashbits;	 /**< Log2 of the key index size */
+	unsigned *hash;		 /**< Key index (entry indices) */
 
 	size_t elemsize;	 /**< Element data size */
 	void *data;		 /**< Actual cache data */
+	kdump_cache_arena_t arena; /**< Arena type of @c data */
 
 	/** Cache entry destructor. */
 	cache_entry_cleanup_fn *entry_cleanup;
 	void *cleanup_data;	 /**< User-supplied data for the destructor. */
 
-	struct cache_entry ce[]; /**< Cache entries */
+	struct cache_entry *ce;	 /**< Cache entries */
 };
 
-/**  Temporary information needed during a cache search.
- * This is grouped in a structure to avoid passing an inordinate number
- * of parameters among the various helper functions.
- */
-struct cache_search {
-	unsigned gprec;		/**< Index of MRU precious ghost entry */
-	unsigned eprec;		/**< End of precious entries; this is the
-				 *   index of the first unused entry. */
-	unsigned zprec;		/**< Index of the least recently used precious
-				 *   entry with zero reference count. */
-	unsigned nzprec;	/**< Number of precious entries with zero
-				 *   reference count. */
-	unsigned gprobe;	/**< Index of MRU probed ghost entry */
-	unsigned eprobe;	/**< End of probed entries; this is the
-				 *   index of the last unused entry. */
-	unsigned zprobe;	/**< Index of the least recently used probed
-				 *   entry with zero reference count. */
-	unsigned nzprobe;	/**< Number of probed entries with zero
-				 *   reference count. */
-};
+/**  Get the index of a partition list head.
+ * @param cache  Cache object.
+ * @param part   Cache partition.
+ * @returns      Index of the sentinel entry for @p part.
+ */
+static inline unsigned
+part_head(const struct cache *cache, enum cache_part part)
+{
+	return 2 * cache->cap + part;
+}
+
+/**  Get the home slot of a key in the key index.
+ * @param cache  Cache object.
+ * @param key    Cache entry key.
+ * @returns      Index of the first slot to be probed.
+ */
+static inline unsigned
+hash_slot(const struct cache *cache, cache_key_t key)
+{
+	return ((uint64_t)key * HASH_MULT) >> (64 - cache->hashbits);
+}
+
+/**  Find a key in the key index.
+ * @param cache  Cache object.
+ * @param key    Cache entry key.
+ * @returns      Entry index, or @ref HASH_EMPTY if not found.
+ *
+ * This function may run concurrently with modifications of the index
+ * (see @ref cache_get_entry_fast). The result is then only a hint, but
+ * the search always terminates.
+ */
+static unsigned
+hash_find(const struct cache *cache, cache_key_t key)
+{
+	unsigned mask = (1U << cache->hashbits) - 1;
+	unsigned slot, idx, n;
+
+	slot = hash_slot(cache, key);
+	for (n = mask + 1; n; --n) {
+		idx = __atomic_load_n(&cache->hash[slot], __ATOMIC_RELAXED);
+		if (idx == HASH_EMPTY)
+			break;
+		if (__atomic_load_n(&cache->ce[idx].key,
+				    __ATOMIC_RELAXED) == key)
+			return idx;
+		slot = (slot + 1) & mask;
+	}
+	return HASH_EMPTY;
+}
+
+/**  Store a value in the key index.
+ * @param cache  Cache object.
+ * @param slot   Slot number.
+ * @param idx    Entry index, or @ref HASH_EMPTY.
+ */
+static inline void
+hash_set(struct cache *cache, unsigned slot, unsigned idx)
+{
+	__atomic_store_n(&cache->hash[slot], idx, __ATOMIC_RELAXED);
+}
+
+/**  Add an entry to the key index.
+ * @param cache  Cache object.
+ * @param idx    Entry index.
+ *
+ * The key must not be present in the index yet.
+ */
+static void
+hash_add(struct cache *cache, unsigned idx)
+{
+	unsigned mask = (1U << cache->hashbits) - 1;
+	unsigned slot;
+
+	slot = hash_slot(cache, cache->ce[idx].key);
+	while (cache->hash[slot] != HASH_EMPTY)
+		slot = (slot + 1) & mask;
+	hash_set(cache, slot, idx);
+}
+
+/**  Remove an entry from the key index.
+ * @param cache  Cache object.
+ * @param idx    Entry index.
+ *
+ * Entries which follow the removed one in the same probe sequence are
+ * shifted back, so no tombstones are needed.
+ */
+static void
+hash_remove(struct cache *cache, unsigned idx)
+{
+	unsigned mask = (1U << cache->hashbits) - 1;
+	unsigned i, j, home;
+
+	i = hash_slot(cache, cache->ce[idx].key);
+	while (cache->hash[i] != idx)
+		i = (i + 1) & mask;
+
+	j = i;
+	for (;;) {
+		j = (j + 1) & mask;
+		if (cache->hash[j] == HASH_EMPTY)
+			break;
+		home = hash_slot(cache, cache->ce[cache->hash[j]].key);
+		if (i <= j
+		    ? (i < home && home <= j)
+		    : (i < home || home <= j))
+			continue;
+		hash_set(cache, i, cache->hash[j]);
+		i = j;
+	}
+	hash_set(cache, i, HASH_EMPTY);
+}
 
 /**  Insert an entry to the list after a given position.
  * @param cache   Cache object.
@@ -177,19 +336,48 @@ remove_entry(struct cache *cache, struct cache_entry *entry)
 	prev->next = entry->next;
 }
 
+/**  Move an entry to the MRU position of a partition.
+ *
+ * @param cache  Cache object.
+ * @param idx    Cache entry index.
+ * @param part   Target partition.
+ */
+static void
+move_to_mru(struct cache *cache, unsigned idx, enum cache_part part)
+{
+	struct cache_entry *entry = &cache->ce[idx];
+
+	remove_entry(cache, entry);
+	add_entry_after(cache, entry, idx, part_head(cache, part));
+	entry->part = part;
+}
+
+/**  Move an entry to the LRU position of a partition.
+ *
+ * @param cache  Cache object.
+ * @param idx    Cache entry index.
+ * @param part   Target partition.
+ */
+static void
+move_to_lru(struct cache *cache, unsigned idx, enum cache_part part)
+{
+	struct cache_entry *entry = &cache->ce[idx];
+
+	remove_entry(cache, entry);
+	add_entry_before(cache, entry, idx, part_head(cache, part));
+	entry->part = part;
+}
+
 /**  Add an entry to the in-flight list.
  *
  * @param cache  Cache object.
- * @param entry  Cache entry to be removed.
  * @param idx    Cache entry index.
  */
 static void
-add_inflight(struct cache *cache, struct cache_entry *entry, unsigned idx)
+add_inflight(struct cache *cache, unsigned idx)
 {
-	if (cache->ninflight++)
-		add_entry_before(cache, entry, idx, cache->inflight);
-	else
-		cache->inflight = entry->next = entry->prev = idx;
+	move_to_lru(cache, idx, cp_inflight);
+	++cache->ninflight;
 }
 
 /**  Reuse a cached entry.
@@ -205,106 +393,171 @@ static struct cache_entry *
 reuse_cached_entry(struct cache *cache, struct cache_entry *entry,
 		   unsigned idx)
 {
-	if (cache->split != idx && cache->split != entry->prev) {
-		remove_entry(cache, entry);
-		add_entry_after(cache, entry, idx, cache->split);
+	move_to_mru(cache, idx, cp_prec);
+	__atomic_fetch_and(&entry->refcnt, ~REF_HOT, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&entry->hits, 1, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&cache->hits.number, 1, __ATOMIC_RELAXED);
+	return entry;
+}
+
+/**  Promote a hot entry to the precious partition.
+ * @param cache  Cache object.
+ * @param idx    Entry index.
+ *
+ * This is the deferred list update for a lock-free cache hit.
+ */
+static void
+promote_hot(struct cache *cache, unsigned idx)
+{
+	struct cache_entry *entry = &cache->ce[idx];
+
+	if (entry->part == cp_probe) {
+		--cache->nprobe;
+		++cache->nprec;
 	}
+	move_to_mru(cache, idx, cp_prec);
+	__atomic_fetch_and(&entry->refcnt, ~REF_HOT, __ATOMIC_RELAXED);
+}
 
-	cache->split = entry->prev;
+/**  Claim the LRU entry with zero reference count.
+ * @param cache  Cache object.
+ * @param part   Cache partition.
+ * @returns      Entry index, or the list head if there is none.
+ *
+ * Hot entries are promoted on the way. Other entries are claimed by
+ * clearing @ref REF_VALID, which fails if another thread has just taken
+ * a reference. The claimed entry must be either evicted or released
+ * with @ref release_claim.
+ *
+ * Each entry is visited at most once, so the search is bounded by the
+ * size of the partition.
+ */
+static unsigned
+claim_unref(struct cache *cache, enum cache_part part)
+{
+	unsigned head = part_head(cache, part);
+	unsigned n = (part == cp_probe) ? cache->nprobe : cache->nprec;
+	unsigned idx, prev, ref;
+
+	for (idx = cache->ce[head].prev; n && idx != head; --n, idx = prev) {
+		struct cache_entry *entry = &cache->ce[idx];
+
+		prev = entry->prev;
+		ref = __atomic_load_n(&entry->refcnt, __ATOMIC_RELAXED);
+		if (ref & REF_COUNT)
+			continue;
+		if (ref & REF_HOT)
+			promote_hot(cache, idx);
+		else if (__atomic_compare_exchange_n(
+				 &entry->refcnt, &ref, 0, false,
+				 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return idx;
+	}
+	return head;
+}
 
-	++cache->hits.number;
-	return entry;
+/**  Release an entry claimed by @ref claim_unref.
+ * @param cache  Cache object.
+ * @param idx    Entry index.
+ */
+static inline void
+release_claim(struct cache *cache, unsigned idx)
+{
+	__atomic_store_n(&cache->ce[idx].refcnt, REF_VALID, __ATOMIC_RELEASE);
 }
 
 /**  Evict an entry from the probe partition.
  * @param cache  Cache object.
- * @param cs     Cache search info.
+ * @param idx    Index of the entry to be evicted.
  * @returns      The evicted entry.
  */
 static struct cache_entry *
-evict_probe(struct cache *cache, struct cache_search *cs)
-{
-	struct cache_entry *entry = &cache->ce[cs->zprobe];
-	if (entry->prev != cs->gprobe) {
-		if (cs->zprobe == cache->split)
-			cache->split = entry->prev;
-		remove_entry(cache, entry);
-		add_entry_after(cache, entry, cs->zprobe, cs->gprobe);
-	}
+evict_probe(struct cache *cache, unsigned idx)
+{
+	move_to_mru(cache, idx, cp_gprobe);
 	--cache->nprobe;
 	++cache->ngprobe;
-	return entry;
+	return &cache->ce[idx];
 }
 
 /**  Evict an entry from the precious partition.
  * @param cache  Cache object.
- * @param cs     Cache search info.
+ * @param idx    Index of the entry to be evicted.
  * @returns      The evicted entry.
  */
 static struct cache_entry *
-evict_prec(struct cache *cache, struct cache_search *cs)
+evict_prec(struct cache *cache, unsigned idx)
 {
-	struct cache_entry *entry = &cache->ce[cs->zprec];
-	if (entry->next != cs->gprec) {
-		remove_entry(cache, entry);
-		add_entry_before(cache, entry, cs->zprec, cs->gprec);
-	}
+	move_to_mru(cache, idx, cp_gprec);
 	--cache->nprec;
 	++cache->ngprec;
-	return entry;
+	return &cache->ce[idx];
 }
 
 /** Evict a cached entry.
  *
  * @param cache  Cache object.
- * @param cs     Cache search info.
  * @param bias   Bias towards the probed partition.
- * @returns      The evicted entry.
+ * @returns      The evicted entry, or @c NULL if all entries are in use.
  *
  * The evicted entry is taken either from the probe partition or from the
- * precious partition. If both are non-empty, make a choice based on the
- * value of @c dprobe.
+ * precious partition. If both contain an unreferenced entry, make a choice
+ * based on the value of @c dprobe.
  */
 static struct cache_entry *
-evict_entry(struct cache *cache, struct cache_search *cs, unsigned bias)
+evict_entry(struct cache *cache, unsigned bias)
 {
 	struct cache_entry *entry;
-
-	if (cs->nzprobe != 0 &&
-	    (cs->nzprec == 0 || cache->nprobe + bias > cache->dprobe))
-		entry = evict_probe(cache, cs);
-	else
-		entry = evict_prec(cache, cs);
+	unsigned zprobe, zprec;
+	bool probe_ok;
+
+	zprobe = claim_unref(cache, cp_probe);
+	probe_ok = (zprobe != part_head(cache, cp_probe));
+	if (probe_ok && cache->nprobe + bias > cache->dprobe)
+		entry = evict_probe(cache, zprobe);
+	else {
+		zprec = claim_unref(cache, cp_prec);
+		if (zprec != part_head(cache, cp_prec)) {
+			if (probe_ok)
+				release_claim(cache, zprobe);
+			entry = evict_prec(cache, zprec);
+		} else if (probe_ok)
+			entry = evict_probe(cache, zprobe);
+		else
+			return NULL;
+	}
 	if (cache->entry_cleanup)
 		cache->entry_cleanup(cache->cleanup_data, entry);
+	++cache->evictions.number;
 	return entry;
 }
 
 /** Reclaim a data buffer.
  *
  * @param cache  Cache object.
- * @param cs     Cache search info.
- * @returns      New data buffer.
+ * @returns      New data buffer, or @c NULL if all entries are in use.
  *
  * Find an unused cache entry with non-NULL data and reclaim that data
- * buffer from it. If there are no entries in the unused partition, evict
- * an existing entry.
+ * buffer from it. If there are no such entries in the unused partition,
+ * evict an existing entry.
  */
 static void *
-reclaim_data(struct cache *cache, struct cache_search *cs)
+reclaim_data(struct cache *cache)
 {
 	struct cache_entry *entry;
+	unsigned idx;
 	void *data;
 
-	if (cache->nprec + cache->nprobe + cache->ninflight < cache->cap) {
+	idx = cache->ce[part_head(cache, cp_unused)].next;
+	entry = &cache->ce[idx];
+	if (idx != part_head(cache, cp_unused) && entry->data) {
 		/* Get an entry from the unused partition. */
-		unsigned eprobe = cs->gprobe;
-		unsigned n = cache->ngprobe;
-		while (n--)
-			eprobe = cache->ce[eprobe].prev;
-		entry = &cache->ce[eprobe];
+		move_to_lru(cache, idx, cp_unused);
 	} else {
-		entry = evict_entry(cache, cs, 0);
+		entry = evict_entry(cache, 0);
+		if (!entry)
+			return NULL;
 	}
 	data = entry->data;
 	entry->data = NULL;
@@ -315,52 +568,47 @@ reclaim_data(struct cache *cache, struct cache_search *cs)
  *
  * @param cache  Cache object.
  * @param key    Requested key.
- * @param cs     Cache search info.
- * @returns      A new cache entry.
+ * @returns      A new cache entry, or @c NULL if all entries are in use.
  */
 static struct cache_entry *
-get_missed_entry(struct cache *cache, cache_key_t key,
-		 struct cache_search *cs)
+get_missed_entry(struct cache *cache, cache_key_t key)
 {
 	struct cache_entry *entry;
-	unsigned idx;
-
-	idx = cs->eprobe;
-	entry = &cache->ce[idx];
-	if (entry->next == cs->eprec) {
-		if (cache->ngprobe) {
-			/* Full cache and non-empty ghost probe partition.
-			 * Use an entry from that partition instead.
-			 */
-			idx = entry->next;
-			entry = &cache->ce[idx];
-			--cache->ngprobe;
-		} else if (cache->ngprec) {
-			/* Full cache and empty ghost probe partition.
-			 * Entry is from the ghost precious partition,
-			 * so its size must be adjusted.
-			 */
-			--cache->ngprec;
-		}
-		/* Else empty cache. Entry is from the unused partition. */
+	unsigned head, idx;
+
+	head = part_head(cache, cp_unused);
+	idx = cache->ce[head].next;
+	if (idx == head) {
+		/* No unused entries. Recycle the LRU ghost entry,
+		 * preferably from the ghost probe partition.
+		 */
+		idx = cache->ngprobe
+			? cache->ce[part_head(cache, cp_gprobe)].prev
+			: cache->ce[part_head(cache, cp_gprec)].prev;
 	}
-	/* Else ghost probe and ghost precious partitions do not touch,
-	 * so entry must be from the unused partition in between.
-	 */
+	entry = &cache->ce[idx];
 
 	if (!entry->data) {
-		struct cache_entry *evict = evict_entry(cache, cs, 1);
+		struct cache_entry *evict = evict_entry(cache, 1);
+		if (!evict)
+			return NULL;
 		entry->data = evict->data;
 		evict->data = NULL;
 	}
 
-	if (cache->split == idx)
-		cache->split = entry->prev;
+	if (entry->part == cp_gprobe) {
+		--cache->ngprobe;
+		hash_remove(cache, idx);
+	} else if (entry->part == cp_gprec) {
+		--cache->ngprec;
+		hash_remove(cache, idx);
+	}
+	add_inflight(cache, idx);
 
-	remove_entry(cache, entry);
-	add_inflight(cache, entry, idx);
-	entry->key = key;
+	__atomic_store_n(&entry->key, key, __ATOMIC_RELAXED);
 	entry->state = cs_probe;
+	entry->hits = 0;
+	hash_add(cache, idx);
 
 	return entry;
 }
@@ -376,163 +624,357 @@ static struct cache_entry *
 reuse_ghost_entry(struct cache *cache, struct cache_entry *entry,
 		  unsigned idx)
 {
-	if (cache->split == idx)
-		cache->split = entry->prev;
-
-	remove_entry(cache, entry);
-	add_inflight(cache, entry, idx);
+	add_inflight(cache, idx);
 	entry->state = cs_precious;
 	return entry;
 }
 
-/**  Get an entry for a given non-cached key.
+/**  Get an in-flight entry for a ghost entry.
  *
  * @param cache  Cache object.
- * @param key    Key to be searched.
- * @param cs     Cache search info.
- * @returns      An in-flight entry.
+ * @param entry  Ghost entry.
+ * @param idx    Index of @p entry.
+ * @returns      An in-flight entry, or @c NULL if all entries are in use.
+ *
+ * A hit in a ghost partition means that the other cached partition
+ * should shrink, so adjust @c dprobe accordingly.
  */
 static struct cache_entry *
-get_ghost_or_missed_entry(struct cache *cache, cache_key_t key,
-			  struct cache_search *cs)
+get_ghost_entry(struct cache *cache, struct cache_entry *entry,
+		unsigned idx)
 {
-	struct cache_entry *entry;
-	unsigned n, idx;
-
-	/* Search precious ghost entries */
-	n = cache->ngprec;
-	idx = cs->gprec;
-	while (n--) {
-		entry = &cache->ce[idx];
-		if (entry->key == key) {
-			int delta = cache->ngprobe > cache->ngprec
-				? cache->ngprobe / cache->ngprec
-				: 1;
-			if (cache->dprobe > delta)
-				cache->dprobe -= delta;
-			else
-				cache->dprobe = 0;
-			entry->data = reclaim_data(cache, cs);
-			--cache->ngprec;
-			return reuse_ghost_entry(cache, entry, idx);
-		}
-		idx = entry->next;
+	unsigned dprobe = cache->dprobe;
+	void *data;
+
+	if (entry->part == cp_gprec) {
+		int delta = cache->ngprobe > cache->ngprec
+			? cache->ngprobe / cache->ngprec
+			: 1;
+		if (cache->dprobe > delta)
+			cache->dprobe -= delta;
+		else
+			cache->dprobe = 0;
+	} else {
+		int delta = cache->ngprec > cache->ngprobe
+			? cache->ngprec / cache->ngprobe
+			: 1;
+		if (cache->dprobe + delta < cache->cap)
+			cache->dprobe += delta;
+		else
+			cache->dprobe = cache->cap;
 	}
-	cs->eprec = idx;
-
-	/* Search probed ghost entries */
-	n = cache->ngprobe;
-	idx = cs->gprobe;
-	while (n--) {
-		entry = &cache->ce[idx];
-		if (entry->key == key) {
-			int delta = cache->ngprec > cache->ngprobe
-				? cache->ngprec / cache->ngprobe
-				: 1;
-			if (cache->dprobe + delta < cache->cap)
-				cache->dprobe += delta;
-			else
-				cache->dprobe = cache->cap;
-			entry->data = reclaim_data(cache, cs);
-			--cache->ngprobe;
-			return reuse_ghost_entry(cache, entry, idx);
-		}
-		idx = entry->prev;
+
+	data = reclaim_data(cache);
+	if (!data) {
+		cache->dprobe = dprobe;
+		return NULL;
 	}
-	cs->eprobe = idx;
+	entry->data = data;
+	if (entry->part == cp_gprec)
+		--cache->ngprec;
+	else
+		--cache->ngprobe;
+	return reuse_ghost_entry(cache, entry, idx);
+}
 
-	return get_missed_entry(cache, key, cs);
+/**  Publish cache occupancy for statistics attributes.
+ * @param cache  Cache object.
+ *
+ * This function must be called with the cache lock held after changing
+ * the number of entries in any partition.
+ */
+static void
+publish_occupancy(struct cache *cache)
+{
+	__atomic_store_n(&cache->occ.prec.number, cache->nprec,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&cache->occ.probe.number, cache->nprobe,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&cache->occ.gprec.number, cache->ngprec,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&cache->occ.gprobe.number, cache->ngprobe,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&cache->occ.inflight.number, cache->ninflight,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&cache->occ.dprobe.number, cache->dprobe,
+			 __ATOMIC_RELAXED);
 }
 
-/**  Get the in-flight entry for a given key.
+/**  Search the cache for an entry.
  *
  * @param cache  Cache object.
  * @param key    Key to be searched.
- * @returns      In-flight entry, or @c NULL if there is none.
+ * @returns      Pointer to a cache entry, or @c NULL if cache is full.
  */
 static struct cache_entry *
-get_inflight_entry(struct cache *cache, cache_key_t key)
+cache_get_entry_noref(struct cache *cache, cache_key_t key)
 {
 	struct cache_entry *entry;
-	unsigned idx, n;
+	unsigned idx;
+
+	idx = hash_find(cache, key);
+	entry = (idx != HASH_EMPTY) ? &cache->ce[idx] : NULL;
 
-	idx = cache->inflight;
-	for (n = cache->ninflight; n; --n) {
-		entry = &cache->ce[idx];
-		if (entry->key == key) {
+	if (entry) {
+		switch (entry->part) {
+		case cp_prec:
+			return reuse_cached_entry(cache, entry, idx);
+
+		case cp_probe:
+			--cache->nprobe;
+			++cache->nprec;
+			return reuse_cached_entry(cache, entry, idx);
+
+		case cp_inflight:
 			entry->state = cs_precious;
+			__atomic_fetch_add(&cache->misses.number, 1,
+					   __ATOMIC_RELAXED);
 			return entry;
+
+		default:	/* Ghost entry. */
+			break;
 		}
-		idx = entry->next;
 	}
 
-	return NULL;
+	if (entry) {
+		entry = get_ghost_entry(cache, entry, idx);
+		if (!entry)
+			return NULL;
+		++cache->nghost;
+	} else {
+		entry = get_missed_entry(cache, key);
+		if (!entry)
+			return NULL;
+	}
+
+	__atomic_fetch_add(&cache->misses.number, 1, __ATOMIC_RELAXED);
+
+	if (cache->limit > cache->cap && ++cache->nmiss >= cache->cap) {
+		if (cache->nghost * GROW_GHOST_RATIO >= cache->nmiss)
+			cache->grow = true;
+		cache->nmiss = 0;
+		cache->nghost = 0;
+	}
+
+	return entry;
 }
 
-/**  Search the cache for an entry.
+/**  Initialize all cache lists and the key index.
  *
  * @param cache  Cache object.
- * @param key    Key to be searched.
- * @returns      Pointer to a cache entry, or @c NULL if cache is full.
+ *
+ * All entries are put into the unused partition, and the key index
+ * is emptied.
  */
-static struct cache_entry *
-cache_get_entry_noref(struct cache *cache, cache_key_t key)
+static void
+init_lists(struct cache *cache)
 {
-	struct cache_search cs;
-	struct cache_entry *entry;
-	unsigned n, idx;
+	unsigned i, n;
 
-	cs.nzprec = 0;
-	cs.nzprobe = 0;
+	for (i = 0; i < CP_NUM; ++i) {
+		struct cache_entry *head = &cache->ce[part_head(cache, i)];
+		head->next = head->prev = part_head(cache, i);
+		head->part = i;
+	}
 
-	/* Search precious entries */
-	n = cache->nprec;
-	idx = cache->ce[cache->split].next;
-	while (n--) {
-		entry = &cache->ce[idx];
-		if (entry->key == key)
-			return reuse_cached_entry(cache, entry, idx);
-		if (entry->refcnt == 0) {
-			cs.zprec = idx;
-			++cs.nzprec;
-		}
-		idx = entry->next;
+	/* Entries with data must be at the head of the unused list. */
+	n = 2 * cache->cap;
+	for (i = 0; i < n; ++i) {
+		struct cache_entry *entry = &cache->ce[i];
+		add_entry_before(cache, entry, i,
+				 part_head(cache, cp_unused));
+		entry->part = cp_unused;
+		entry->refcnt = 0;
+		entry->data = i < cache->cap
+			? cache->data + i * cache->elemsize
+			: NULL;
 	}
-	cs.gprec = idx;
-
-	/* Search probed entries */
-	n = cache->nprobe;
-	idx = cache->split;
-	while (n--) {
-		entry = &cache->ce[idx];
-		if (entry->key == key) {
-			--cache->nprobe;
-			++cache->nprec;
-			return reuse_cached_entry(cache, entry, idx);
-		}
-		if (entry->refcnt == 0) {
-			cs.zprobe = idx;
-			++cs.nzprobe;
+
+	for (i = 0; i < 1U << cache->hashbits; ++i)
+		cache->hash[i] = HASH_EMPTY;
+}
+
+/**  Allocate cache arrays.
+ * @param cache  Cache object.
+ * @param n      Number of elements in the cache.
+ * @param arena  Arena type for the cache data.
+ * @returns      @c true on success, @c false if out of memory.
+ *
+ * Allocate entries, the key index and data for @p n elements and store
+ * them in @p cache. The previous arrays (if any) are overwritten.
+ */
+static bool
+alloc_arrays(struct cache *cache, unsigned n, kdump_cache_arena_t arena)
+{
+	unsigned hashbits;
+
+	cache->ce = malloc((2 * (size_t)n + CP_NUM) *
+			   sizeof(struct cache_entry));
+	if (!cache->ce)
+		return false;
+
+	/* Keep the key index at most half full. */
+	hashbits = 2;
+	while ((1UL << hashbits) < 4UL * n)
+		++hashbits;
+	cache->hash = malloc(sizeof(unsigned) << hashbits);
+	if (!cache->hash)
+		goto err_ce;
+
+	cache->arena = arena;
+	if (cache->elemsize) {
+		cache->data = arena_alloc(n * cache->elemsize, &cache->arena);
+		if (!cache->data)
+			goto err_hash;
+	} else
+		cache->data = cache; /* Any non-NULL pointer */
+
+	cache->cap = n;
+	cache->hashbits = hashbits;
+	return true;
+
+ err_hash:
+	free(cache->hash);
+ err_ce:
+	free(cache->ce);
+	return false;
+}
+
+/**  Free cache arrays.
+ * @param cache  Cache object.
+ */
+static void
+free_arrays(struct cache *cache)
+{
+	if (cache->elemsize)
+		arena_free(cache->data, cache->cap * cache->elemsize,
+			   cache->arena);
+	free(cache->hash);
+	free(cache->ce);
+}
+
+/**  Migrate entries of one partition to a grown cache.
+ * @param cache  Cache object with new (empty) arrays.
+ * @param old    Copy of the cache object with the old arrays.
+ * @param part   Cache partition.
+ * @returns      Number of migrated entries.
+ *
+ * Entries are migrated from MRU to LRU. Cached entries take an unused
+ * entry with data, and their data is copied. Ghost entries take an unused
+ * entry without data; if there are none left, the remaining (older)
+ * ghost entries are dropped.
+ */
+static unsigned
+migrate_part(struct cache *cache, const struct cache *old,
+	     enum cache_part part)
+{
+	unsigned ohead = part_head(old, part);
+	unsigned uhead = part_head(cache, cp_unused);
+	bool cached = (part == cp_probe || part == cp_prec);
+	struct cache_entry *entry;
+	const struct cache_entry *oentry;
+	unsigned oidx, idx, n;
+
+	n = 0;
+	for (oidx = old->ce[ohead].next; oidx != ohead;
+	     oidx = old->ce[oidx].next) {
+		oentry = &old->ce[oidx];
+		if (cached) {
+			idx = cache->ce[uhead].next;
+			entry = &cache->ce[idx];
+			if (cache->elemsize)
+				memcpy(entry->data, oentry->data,
+				       cache->elemsize);
+			else
+				entry->data = oentry->data;
+		} else {
+			idx = cache->ce[uhead].prev;
+			entry = &cache->ce[idx];
+			if (idx == uhead || entry->data)
+				break;
 		}
-		idx = entry->prev;
+		entry->key = oentry->key;
+		entry->hits = oentry->hits;
+		entry->state = cs_valid;
+		entry->refcnt = cached ? REF_VALID : 0;
+		move_to_lru(cache, idx, part);
+		hash_add(cache, idx);
+		++n;
 	}
-	cs.gprobe = idx;
+	return n;
+}
 
-	entry = get_inflight_entry(cache, key);
+/**  Grow a cache.
+ * @param cache  Cache object.
+ *
+ * Double the capacity, but do not exceed the limit. All cached and ghost
+ * entries are preserved. No entries may be referenced, because they are
+ * moved to new locations. If memory cannot be allocated, the cache stays
+ * as it is, and the limit is lowered to prevent further attempts.
+ */
+static void
+grow_cache(struct cache *cache)
+{
+	struct cache old = *cache;
+	unsigned newcap;
+
+	cache->grow = false;
+	newcap = cache->cap < cache->limit / 2
+		? 2 * cache->cap
+		: cache->limit;
+	if (!alloc_arrays(cache, newcap, old.arena)) {
+		*cache = old;
+		cache->grow = false;
+		cache->limit = cache->cap;
+		__atomic_store_n(&cache->fast, true, __ATOMIC_RELEASE);
+		return;
+	}
 
-	if (!entry) {
-		unsigned inuse = (cache->nprec - cs.nzprec) +
-			(cache->nprobe - cs.nzprobe) +
-			cache->ninflight;
-		if (inuse >= cache->cap)
-			return NULL;
+	init_lists(cache);
+	cache->nprec = migrate_part(cache, &old, cp_prec);
+	cache->nprobe = migrate_part(cache, &old, cp_probe);
+	cache->ngprec = migrate_part(cache, &old, cp_gprec);
+	cache->ngprobe = migrate_part(cache, &old, cp_gprobe);
+	cache->dprobe = (unsigned long long)old.dprobe * newcap / old.cap;
 
-		entry = get_ghost_or_missed_entry(cache, key, &cs);
-	}
+	free_arrays(&old);
+	if (cache->cap >= cache->limit)
+		__atomic_store_n(&cache->fast, true, __ATOMIC_RELEASE);
+}
 
-	++cache->misses.number;
+/**  Check whether any cached entry is referenced.
+ * @param cache  Cache object.
+ * @param part   Cache partition.
+ * @returns      @c true if at least one entry in @p part is referenced.
+ */
+static bool
+part_referenced(const struct cache *cache, enum cache_part part)
+{
+	unsigned head = part_head(cache, part);
+	unsigned idx;
 
-	return entry;
+	for (idx = cache->ce[head].next; idx != head;
+	     idx = cache->ce[idx].next)
+		if (cache->ce[idx].refcnt & REF_COUNT)
+			return true;
+	return false;
+}
+
+/**  Check whether it is safe to grow a cache.
+ * @param cache  Cache object.
+ * @returns      @c true if no entries are referenced.
+ *
+ * The check walks all cached entries, so it is done at most once for
+ * each growth decision. If it fails, growth is retried only after the
+ * next check of the ghost hit ratio.
+ */
+static bool
+can_grow(struct cache *cache)
+{
+	cache->grow = false;
+	return !cache->ninflight &&
+		!part_referenced(cache, cp_prec) &&
+		!part_referenced(cache, cp_probe);
 }
 
 /**  Get the cache entry for a given key.
@@ -553,13 +995,65 @@ cache_get_entry(struct cache *cache, cache_key_t key)
 {
 	struct cache_entry *entry;
 
+	if (cache->grow && can_grow(cache))
+		grow_cache(cache);
+
 	entry = cache_get_entry_noref(cache, key);
 	if (entry)
-		++entry->refcnt;
+		__atomic_fetch_add(&entry->refcnt, 1, __ATOMIC_ACQUIRE);
+	else
+		++cache->busy.number;
+	publish_occupancy(cache);
 
 	return entry;
 }
 
+/**  Look up a cached entry without holding the cache lock.
+ *
+ * @param cache  Cache object.
+ * @param key    Key to be searched.
+ * @returns      Pointer to a valid cache entry, or @c NULL.
+ *
+ * Only cache hits are handled here. If the entry is not cached (or if
+ * lock-free lookups are not possible at the moment), return @c NULL,
+ * and the caller should take the cache lock and call @ref cache_get_entry.
+ *
+ * The reference count of the returned entry is incremented. The entry
+ * is only marked as hot, and its recency is updated later by eviction.
+ */
+struct cache_entry *
+cache_get_entry_fast(struct cache *cache, cache_key_t key)
+{
+	struct cache_entry *entry;
+	unsigned idx, ref;
+
+	if (!__atomic_load_n(&cache->fast, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	idx = hash_find(cache, key);
+	if (idx == HASH_EMPTY)
+		return NULL;
+
+	entry = &cache->ce[idx];
+	ref = __atomic_load_n(&entry->refcnt, __ATOMIC_RELAXED);
+	do {
+		if (!(ref & REF_VALID))
+			return NULL;
+	} while (!__atomic_compare_exchange_n(
+			 &entry->refcnt, &ref, (ref + 1) | REF_HOT, true,
+			 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	/* The entry may have been reused before the reference was taken. */
+	if (__atomic_load_n(&entry->key, __ATOMIC_RELAXED) != key) {
+		cache_put_entry(cache, entry);
+		return NULL;
+	}
+
+	__atomic_fetch_add(&entry->hits, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&cache->hits.number, 1, __ATOMIC_RELAXED);
+	return entry;
+}
+
 /**  Insert an entry into the cache.
  *
  * @param cache  Cache object.
@@ -578,20 +1072,16 @@ cache_insert(struct cache *cache, struct cache_entry *entry)
 		return;
 
 	idx = entry - cache->ce;
-	if (cache->ninflight--) {
-		if (cache->inflight == idx)
-			cache->inflight = entry->next;
-		remove_entry(cache, entry);
-	}
-	add_entry_after(cache, entry, idx, cache->split);
+	--cache->ninflight;
 
 	switch (entry->state) {
 	case cs_probe:
+		move_to_mru(cache, idx, cp_probe);
 		++cache->nprobe;
-		cache->split = idx;
 		break;
 
 	case cs_precious:
+		move_to_mru(cache, idx, cp_prec);
 		++cache->nprec;
 		break;
 
@@ -599,17 +1089,35 @@ cache_insert(struct cache *cache, struct cache_entry *entry)
 		break;
 	}
 	entry->state = cs_valid;
+	__atomic_fetch_or(&entry->refcnt, REF_VALID, __ATOMIC_RELEASE);
+	publish_occupancy(cache);
 }
 
 /**  Drop a reference to a cache entry.
  *
  * @param cache  Cache object.
  * @param entry  Cache entry.
+ *
+ * This function does not need the cache lock.
  */
 void
 cache_put_entry(struct cache *cache, struct cache_entry *entry)
 {
-	--entry->refcnt;
+	__atomic_fetch_sub(&entry->refcnt, 1, __ATOMIC_RELEASE);
+}
+
+/**  Check whether a cache entry has only one reference.
+ * @param entry  Cache entry.
+ * @returns      @c true if the caller holds the only reference.
+ *
+ * The result is reliable only if the caller holds the cache lock, and
+ * no references to @p entry are taken with @ref cache_get_entry_fast.
+ */
+bool
+cache_entry_unshared(const struct cache_entry *entry)
+{
+	return (__atomic_load_n(&entry->refcnt, __ATOMIC_ACQUIRE)
+		& REF_COUNT) == 1;
 }
 
 /**  Discard an entry.
@@ -628,27 +1136,35 @@ cache_put_entry(struct cache *cache, struct cache_entry *entry)
 void
 cache_discard(struct cache *cache, struct cache_entry *entry)
 {
-	unsigned n, idx, eprobe;
+	unsigned idx;
 
-	if (--entry->refcnt)
+	if (__atomic_sub_fetch(&entry->refcnt, 1, __ATOMIC_ACQ_REL) &
+	    REF_COUNT)
 		return;
 	if (cache_entry_valid(entry))
 		return;
 	--cache->ninflight;
 
 	idx = entry - cache->ce;
-	if (cache->inflight == idx)
-		cache->inflight = entry->next;
-	remove_entry(cache, entry);
+	hash_remove(cache, idx);
+	move_to_mru(cache, idx, cp_unused);
+	publish_occupancy(cache);
+}
 
-	eprobe = cache->split;
-	n = cache->nprobe + cache->ngprobe;
-	if (!n)
-		cache->split = idx;
-	else while (n--)
-		eprobe = cache->ce[eprobe].prev;
+/**  Clean up all entries in a partition.
+ *
+ * @param cache  Cache object.
+ * @param part   Cache partition.
+ */
+static void
+cleanup_part(struct cache *cache, enum cache_part part)
+{
+	unsigned head = part_head(cache, part);
+	unsigned idx;
 
-	add_entry_after(cache, entry, idx, eprobe);
+	for (idx = cache->ce[head].next; idx != head;
+	     idx = cache->ce[idx].next)
+		cache->entry_cleanup(cache->cleanup_data, &cache->ce[idx]);
 }
 
 /**  Clean up all cache entries.
@@ -660,28 +1176,34 @@ cache_discard(struct cache *cache, struct cache_entry *entry)
 static void
 cleanup_entries(struct cache *cache)
 {
-	unsigned n, idx;
-	struct cache_entry *entry;
-
 	if (!cache->entry_cleanup)
 		return;
 
-	/* Clean up precious entries */
-	n = cache->nprec;
-	idx = cache->ce[cache->split].next;
-	while (n--) {
-		entry = &cache->ce[idx];
-		cache->entry_cleanup(cache->cleanup_data, entry);
-		idx = entry->next;
-	}
+	cleanup_part(cache, cp_prec);
+	cleanup_part(cache, cp_probe);
+}
 
-	/* Clean up probed entries */
-	n = cache->nprobe;
-	idx = cache->split;
-	while (n--) {
-		entry = &cache->ce[idx];
-		cache->entry_cleanup(cache->cleanup_data, entry);
-		idx = entry->prev;
+/**  Call a function for all cached entries.
+ *
+ * @param cache  Cache object.
+ * @param fn     Callback function.
+ * @param data   User-supplied data for @p fn.
+ *
+ * Precious entries are visited first, then probed entries, each from
+ * the most recently used. The caller must hold the cache lock.
+ */
+void
+cache_walk(struct cache *cache, cache_walk_fn *fn, void *data)
+{
+	static const enum cache_part parts[] = { cp_prec, cp_probe };
+	unsigned head, idx;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(parts); ++i) {
+		head = part_head(cache, parts[i]);
+		for (idx = cache->ce[head].next; idx != head;
+		     idx = cache->ce[idx].next)
+			fn(data, &cache->ce[idx]);
 	}
 }
 
@@ -692,67 +1214,210 @@ cleanup_entries(struct cache *cache)
 void
 cache_flush(struct cache *cache)
 {
-	unsigned i, n;
-
 	cleanup_entries(cache);
+	init_lists(cache);
 
-	n = 2 * cache->cap;
-	for (i = 0; i < n; ++i) {
-		struct cache_entry *entry = &cache->ce[i];
-		entry->next = (i > 0) ? (i - 1) : (n - 1);
-		entry->prev = (i < n - 1) ? (i + 1) : 0;
-		entry->refcnt = 0;
-		entry->data = i < cache->cap
-			? cache->data + i * cache->elemsize
-			: NULL;
-	}
-
-	cache->split = 0;
 	cache->nprec = 0;
 	cache->ngprec = 0;
 	cache->nprobe = 0;
 	cache->ngprobe = 0;
 	cache->dprobe = 0;
 	cache->ninflight = 0;
+	cache->nmiss = 0;
+	cache->nghost = 0;
+	cache->grow = false;
+	publish_occupancy(cache);
+}
+
+/**  Reset cache statistics counters.
+ *
+ * @param cache  Cache object.
+ *
+ * Reset the number of hits, misses, evictions and failed requests.
+ * Occupancy is not affected.
+ */
+void
+cache_reset_stats(struct cache *cache)
+{
+	__atomic_store_n(&cache->hits.number, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&cache->misses.number, 0, __ATOMIC_RELAXED);
+	cache->evictions.number = 0;
+	cache->busy.number = 0;
+}
+
+/**  Get the huge page size.
+ * @returns  Size of a PMD-level huge page in bytes.
+ */
+static size_t
+huge_page_size(void)
+{
+	static size_t hpsz;
+	unsigned long val;
+	FILE *f;
+
+	if (hpsz)
+		return hpsz;
+
+	val = DEFAULT_HUGE_PAGE_SIZE;
+	f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+	if (f) {
+		if (fscanf(f, "%lu", &val) != 1 || !val ||
+		    (val & (val - 1)))
+			val = DEFAULT_HUGE_PAGE_SIZE;
+		fclose(f);
+	}
+	hpsz = val;
+	return hpsz;
+}
+
+/**  Round up an arena size to a whole number of huge pages.
+ * @param size  Requested size.
+ * @returns     Size of the mapping.
+ */
+static inline size_t
+arena_map_size(size_t size)
+{
+	size_t hpsz = huge_page_size();
+	return (size + hpsz - 1) & ~(hpsz - 1);
+}
+
+/**  Allocate memory for cache data.
+ * @param size   Size of the allocation.
+ * @param arena  Requested arena type; updated to the actual type.
+ * @returns      Allocated memory, or @c NULL on failure.
+ *
+ * If the requested arena type is not available, fall back to the next
+ * simpler one: hugetlbfs pages, transparent huge pages, and finally
+ * @c malloc(3). Allocations smaller than a huge page always come from
+ * @c malloc(3). The memory must be freed with @ref arena_free, passing
+ * the arena type stored in @p arena.
+ *
+ * Allocations of at least one page are always page-aligned.
+ */
+void *
+arena_alloc(size_t size, kdump_cache_arena_t *arena)
+{
+	void *ptr;
+	size_t mapsz;
+
+	if (size < huge_page_size())
+		*arena = KDUMP_ARENA_MALLOC;
+	mapsz = arena_map_size(size);
+
+	switch (*arena) {
+	case KDUMP_ARENA_HUGETLB:
+#ifdef MAP_HUGETLB
+		ptr = mmap(NULL, mapsz, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (ptr != MAP_FAILED)
+			return ptr;
+#endif
+		*arena = KDUMP_ARENA_THP;
+		/* fall through */
+
+	case KDUMP_ARENA_THP:
+#ifdef MADV_HUGEPAGE
+		ptr = mmap(NULL, mapsz + huge_page_size(),
+			   PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr != MAP_FAILED) {
+			/* Trim the mapping to a huge page boundary. */
+			uintptr_t start = (uintptr_t)ptr;
+			uintptr_t astart = (start + huge_page_size() - 1) &
+				~(uintptr_t)(huge_page_size() - 1);
+			uintptr_t end = start + mapsz + huge_page_size();
+
+			if (astart > start)
+				munmap(ptr, astart - start);
+			if (end > astart + mapsz)
+				munmap((void *)(astart + mapsz),
+				       end - astart - mapsz);
+			madvise((void *)astart, mapsz, MADV_HUGEPAGE);
+			return (void *)astart;
+		}
+#endif
+		*arena = KDUMP_ARENA_MALLOC;
+		/* fall through */
+
+	default:
+		*arena = KDUMP_ARENA_MALLOC;
+		/* Page-aligned buffers can be used for direct I/O. */
+		if (size >= (size_t)sysconf(_SC_PAGESIZE))
+			return posix_memalign(&ptr, sysconf(_SC_PAGESIZE), size)
+				? NULL : ptr;
+		return malloc(size);
+	}
+}
+
+/**  Free memory allocated with @ref arena_alloc.
+ * @param ptr    Allocated memory.
+ * @param size   Size of the allocation.
+ * @param arena  Arena type returned by @ref arena_alloc.
+ */
+void
+arena_free(void *ptr, size_t size, kdump_cache_arena_t arena)
+{
+	if (arena == KDUMP_ARENA_MALLOC)
+		free(ptr);
+	else if (ptr)
+		munmap(ptr, arena_map_size(size));
 }
 
 /**  Allocate a cache object.
  *
- * @param n     Number of elements in the cache.
- * @param size  Data size for each element.
- * @returns     Newly allocated cache object, or @c NULL on failure.
+ * @param n      Number of elements in the cache.
+ * @param size   Data size for each element.
+ * @param arena  Arena type for the cache data.
+ * @returns      Newly allocated cache object, or @c NULL on failure.
  *
  * The reference count of the new cache object is set to 1.
  */
 struct cache *
-cache_alloc(unsigned n, size_t size)
+cache_alloc(unsigned n, size_t size, kdump_cache_arena_t arena)
 {
 	struct cache *cache;
 
-	cache = malloc(sizeof(struct cache) +
-		       2 * n * sizeof(struct cache_entry));
+	cache = malloc(sizeof(struct cache));
 	if (!cache)
 		return cache;
 
 	cache->elemsize = size;
-	cache->cap = n;
 	cache->hits.number = 0;
 	cache->misses.number = 0;
+	cache->evictions.number = 0;
+	cache->busy.number = 0;
+	cache->limit = 0;
+	cache->fast = true;
 	cache->entry_cleanup = NULL;
 
-	if (cache->elemsize) {
-		cache->data = malloc(cache->cap * cache->elemsize);
-		if (!cache->data) {
-			free(cache);
-			return NULL;
-		}
-	} else
-		cache->data = cache; /* Any non-NULL pointer */
+	if (!alloc_arrays(cache, n, arena)) {
+		free(cache);
+		return NULL;
+	}
 
 	cache_flush(cache);
 	return cache;
 }
 
+/**  Set the capacity limit for adaptive growth.
+ * @param cache  Cache object.
+ * @param limit  Maximum number of elements.
+ *
+ * The cache grows up to @p limit elements while ghost hits indicate
+ * that a bigger cache would have a better hit rate. A limit that is not
+ * above the current capacity disables growth.
+ *
+ * Lock-free lookups are disabled while the cache may still grow.
+ */
+void
+cache_set_limit(struct cache *cache, unsigned limit)
+{
+	cache->limit = limit;
+	cache->grow = false;
+	__atomic_store_n(&cache->fast, limit <= cache->cap,
+			 __ATOMIC_RELEASE);
+}
+
 /** Set cache entry destructor.
  * @param cache  Cache object.
  * @param fn     Entry destructor, or @c NULL.
@@ -782,8 +1447,7 @@ void
 cache_free(struct cache *cache)
 {
 	cleanup_entries(cache);
-	if (cache->data != cache)
-		free(cache->data);
+	free_arrays(cache);
 	free(cache);
 }
 
@@ -803,30 +1467,239 @@ get_cache_size(kdump_ctx_t *ctx)
 		: DEFAULT_CACHE_SIZE;
 }
 
+/**  Get the configured private cache size.
+ * @param ctx  Dump file object.
+ * @returns    Number of pages in the private (L1) cache.
+ *
+ * Get the cache size from "cache.l1_size" attribute. If not set,
+ * return zero (no private cache).
+ */
+unsigned
+get_cache_l1_size(kdump_ctx_t *ctx)
+{
+	struct attr_data *attr = gattr(ctx, GKI_cache_l1_size);
+	return attr_isset(attr) && attr_revalidate(ctx, attr) == KDUMP_OK
+		? attr_value(attr)->number
+		: 0;
+}
+
+/**  Get the configured cache arena type.
+ * @param ctx  Dump file object.
+ * @returns    Arena type.
+ *
+ * Get the arena type from "cache.arena" attribute. If not set, return
+ * @c KDUMP_ARENA_MALLOC.
+ */
+kdump_cache_arena_t
+get_cache_arena(kdump_ctx_t *ctx)
+{
+	struct attr_data *attr = gattr(ctx, GKI_cache_arena);
+	return attr_isset(attr) && attr_revalidate(ctx, attr) == KDUMP_OK
+		? attr_value(attr)->number
+		: KDUMP_ARENA_MALLOC;
+}
+
+/**  Get the memory cost of one cache element.
+ * @param elemsize  Data size of each element.
+ * @returns         Total bytes per element, including metadata.
+ *
+ * Metadata are two entries (one of them for ghost tracking) and up to
+ * eight key index slots.
+ */
+static inline size_t
+slot_size(size_t elemsize)
+{
+	return elemsize + 2 * sizeof(struct cache_entry) +
+		8 * sizeof(unsigned);
+}
+
+/**  Get the number of entries which are not in flight.
+ * @param cache  Cache object.
+ * @returns      Number of entries which are either unused or cached.
+ *
+ * The caller must hold the cache lock.
+ */
+unsigned
+cache_idle(const struct cache *cache)
+{
+	return cache->cap - cache->ninflight;
+}
+
+/**  Get the memory footprint of a cache.
+ * @param cache    Cache object.
+ * @param extsize  Size of external data referenced by each element.
+ * @returns        Memory footprint in bytes.
+ *
+ * Use @p extsize for data which is not allocated by the cache itself,
+ * e.g. mmap windows referenced by the data pointers.
+ */
+size_t
+cache_footprint(const struct cache *cache, size_t extsize)
+{
+	return (size_t)cache->cap * slot_size(cache->elemsize + extsize);
+}
+
+/**  Get the cache size limit imposed by the memory budget.
+ * @param ctx       Dump file object.
+ * @param elemsize  Data size of each element.
+ * @returns         Maximum number of elements, or @c UINT_MAX
+ *                  if "cache.max_bytes" is not set.
+ *
+ * The budget is shared with the file cache, so its footprint is
+ * subtracted first.
+ */
+unsigned
+get_cache_limit(kdump_ctx_t *ctx, size_t elemsize)
+{
+	struct attr_data *attr = gattr(ctx, GKI_cache_max_bytes);
+	kdump_num_t budget, used, n;
+
+	if (!attr_isset(attr) || attr_revalidate(ctx, attr) != KDUMP_OK)
+		return UINT_MAX;
+
+	budget = attr_value(attr)->number;
+	used = ctx->shared->fcache
+		? fcache_footprint(ctx->shared->fcache)
+		: 0;
+	if (budget <= used)
+		return 0;
+	n = (budget - used) / slot_size(elemsize);
+	return n < UINT_MAX ? n : UINT_MAX;
+}
+
+/**  Check whether adaptive cache sizing is enabled.
+ * @param ctx  Dump file object.
+ * @returns    Non-zero if "cache.adaptive" is set to a non-zero value.
+ */
+bool
+get_cache_adaptive(kdump_ctx_t *ctx)
+{
+	struct attr_data *attr = gattr(ctx, GKI_cache_adaptive);
+	return attr_isset(attr) && attr_revalidate(ctx, attr) == KDUMP_OK &&
+		attr_value(attr)->number;
+}
+
+/**  Get the budget of the compressed page cache.
+ * @param ctx  Dump file object.
+ * @returns    Size in bytes, or zero if "cache.compressed_bytes" is not set.
+ */
+kdump_num_t
+get_cache_compressed_bytes(kdump_ctx_t *ctx)
+{
+	struct attr_data *attr = gattr(ctx, GKI_cache_compressed_bytes);
+	return attr_isset(attr) && attr_revalidate(ctx, attr) == KDUMP_OK
+		? attr_value(attr)->number
+		: 0;
+}
+
+/**  Get the maximum age of cached live pages.
+ * @param ctx  Dump file object.
+ * @returns    Age in milliseconds, or zero if "cache.max_age" is not set.
+ */
+kdump_num_t
+get_cache_max_age(kdump_ctx_t *ctx)
+{
+	struct attr_data *attr = gattr(ctx, GKI_cache_max_age);
+	return attr_isset(attr) && attr_revalidate(ctx, attr) == KDUMP_OK
+		? attr_value(attr)->number
+		: 0;
+}
+
+/**  Cache statistics attributes.
+ */
+static const struct {
+	const char *key;	/**< Key relative to the statistics directory. */
+	size_t off;		/**< Offset of the value in @c struct cache. */
+} stat_attrs[] = {
+	{ "hits", offsetof(struct cache, hits) },
+	{ "misses", offsetof(struct cache, misses) },
+	{ "evictions", offsetof(struct cache, evictions) },
+	{ "busy", offsetof(struct cache, busy) },
+	{ "precious", offsetof(struct cache, occ.prec) },
+	{ "probed", offsetof(struct cache, occ.probe) },
+	{ "ghost_precious", offsetof(struct cache, occ.gprec) },
+	{ "ghost_probed", offsetof(struct cache, occ.gprobe) },
+	{ "inflight", offsetof(struct cache, occ.inflight) },
+	{ "probe_target", offsetof(struct cache, occ.dprobe) },
+};
+
+/**  Look up a cache statistics attribute.
+ * @param ctx  Dump file object containing the attributes.
+ * @param dir  Directory of the statistics attributes.
+ * @param i    Index in @ref stat_attrs.
+ * @returns    Attribute data, or @c NULL if not found.
+ */
+static struct attr_data *
+stat_attr(kdump_ctx_t *ctx, struct attr_data *dir, int i)
+{
+	const char *key = stat_attrs[i].key;
+	return lookup_dir_attr(ctx->dict, dir, key, strlen(key));
+}
+
+/**  Initialize cache statistics attributes.
+ * @param ctx  Dump file object containing the attributes.
+ * @param dir  Directory of the statistics attributes.
+ *
+ * Set all statistics to zero before a cache is attached with
+ * @ref cache_set_attrs.
+ */
+void
+cache_init_attrs(kdump_ctx_t *ctx, struct attr_data *dir)
+{
+	struct attr_data *attr;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stat_attrs); ++i)
+		if ((attr = stat_attr(ctx, dir, i)))
+			set_attr_number(ctx, attr, ATTR_PERSIST, 0);
+}
+
+/**  Detach cache statistics attributes from a cache.
+ * @param ctx  Dump file object containing the attributes.
+ * @param dir  Directory of the statistics attributes.
+ *
+ * Copy the current values into the attributes, so they remain valid
+ * after the cache is freed.
+ */
+void
+cache_embed_attrs(kdump_ctx_t *ctx, struct attr_data *dir)
+{
+	struct attr_data *attr;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stat_attrs); ++i)
+		if ((attr = stat_attr(ctx, dir, i)))
+			attr_embed_value(attr);
+}
+
 /**  Set up cache statistics attributes.
  * @param cache   Cache object.
  * @param ctx     Dump file object containing the attributes.
- * @param hits    Attribute for cache hits.
- * @param misses  Attribute for cache misses.
+ * @param dir     Directory of the statistics attributes.
  * @returns       Error status.
  */
 kdump_status
-cache_set_attrs(struct cache *cache, kdump_ctx_t *ctx,
-		struct attr_data *hits, struct attr_data *misses)
+cache_set_attrs(struct cache *cache, kdump_ctx_t *ctx, struct attr_data *dir)
 {
+	struct attr_data *attr;
 	kdump_status status;
-
-	status = set_attr(ctx, hits, ATTR_PERSIST_INDIRECT, &cache->hits);
-	if (status != KDUMP_OK)
-		return set_error(ctx, status,
-				 "Cannot set up cache '%s' attribute",
-				 "hits");
-
-	status = set_attr(ctx, misses, ATTR_PERSIST_INDIRECT, &cache->misses);
-	if (status != KDUMP_OK)
-		return set_error(ctx, status,
-				 "Cannot set up cache '%s' attribute",
-				 "misses");
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stat_attrs); ++i) {
+		const char *key = stat_attrs[i].key;
+		attr = stat_attr(ctx, dir, i);
+		if (!attr)
+			return set_error(ctx, KDUMP_ERR_NOKEY,
+					 "Cache '%s' attribute not found",
+					 key);
+		status = set_attr(ctx, attr, ATTR_PERSIST_INDIRECT,
+				  (kdump_attr_value_t *)
+				  ((char *)cache + stat_attrs[i].off));
+		if (status != KDUMP_OK)
+			return set_error(ctx, status,
+					 "Cannot set up cache '%s' attribute",
+					 key);
+	}
 
 	return KDUMP_OK;
 }
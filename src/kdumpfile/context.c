@@ -100,8 +100,12 @@ shared_free(struct kdump_shared *shared)
 		shared->ops->cleanup(shared);
 	if (shared->arch_ops && shared->arch_ops->cleanup)
 		shared->arch_ops->cleanup(shared);
+	cache_profile_save(shared);
+	free(shared->profile_path);
 	if (shared->cache)
 		cache_free(shared->cache);
+	read_pool_free(shared);
+	free_zero_page(shared);
 	flatmap_free(shared->flatmap);
 	if (shared->fcache)
 		fcache_decref(shared->fcache);
@@ -152,17 +156,22 @@ kdump_new(void)
 		enum global_keyidx key;
 		kdump_num_t val;
 	} numeric_attrs[] = {
-		{ GKI_cache_hits, 0 },
-		{ GKI_cache_misses, 0 },
 		{ GKI_cache_size, DEFAULT_CACHE_SIZE },
+		{ GKI_cache_arena, KDUMP_ARENA_MALLOC },
+		{ GKI_cache_l1_size, 0 },
 		{ GKI_file_mmap_policy, KDUMP_MMAP_TRY },
-		{ GKI_mmap_cache_hits, 0 },
-		{ GKI_mmap_cache_misses, 0 },
-		{ GKI_read_cache_hits, 0 },
-		{ GKI_read_cache_misses, 0 },
+		{ GKI_file_access, KDUMP_ACCESS_NORMAL },
+		{ GKI_file_direct_io, 0 },
 		{ GKI_num_files, 0 },
 	};
 
+	/* Cache statistics directories */
+	static const enum global_keyidx stats_dirs[] = {
+		GKI_dir_cache,
+		GKI_dir_file_mmap_cache,
+		GKI_dir_file_read_cache,
+	};
+
 	kdump_ctx_t *ctx;
 	int i;
 
@@ -190,6 +199,12 @@ kdump_new(void)
 	for (i = 0; i < ARRAY_SIZE(numeric_attrs); ++i)
 		set_attr_number(ctx, gattr(ctx, numeric_attrs[i].key),
 				ATTR_PERSIST, numeric_attrs[i].val);
+	for (i = 0; i < ARRAY_SIZE(stats_dirs); ++i)
+		cache_init_attrs(ctx, gattr(ctx, stats_dirs[i]));
+	set_attr_number(ctx, gattr(ctx, GKI_xlat_read_cache_hits),
+			(struct attr_flags){ .persist = 1, .invalid = 1 }, 0);
+	set_attr_number(ctx, gattr(ctx, GKI_xlat_read_cache_misses),
+			(struct attr_flags){ .persist = 1, .invalid = 1 }, 0);
 
 	return ctx;
 
@@ -198,7 +213,7 @@ kdump_new(void)
  err_shared:
 	shared_decref(ctx->shared);
  err:
-	addrxlat_ctx_decref(ctx->xlatctx);
+	cleanup_addrxlat(ctx);
 	free(ctx);
 	return NULL;
 }
@@ -240,7 +255,7 @@ kdump_clone(const kdump_ctx_t *orig, unsigned long flags)
 			while (slot-- > 0)
 				if (orig->shared->per_ctx_size[slot])
 					free(ctx->data[slot]);
-			addrxlat_ctx_decref(ctx->xlatctx);
+			cleanup_addrxlat(ctx);
 			free(ctx);
 			return NULL;
 		}
@@ -301,7 +316,11 @@ kdump_free(kdump_ctx_t *ctx)
 		if (shared->per_ctx_size[slot])
 			free(ctx->data[slot]);
 
-	addrxlat_ctx_decref(ctx->xlatctx);
+	cleanup_addrxlat(ctx);
+
+	if (ctx->l1cache)
+		cache_free(ctx->l1cache);
+	free(ctx->scratch);
 
 	list_del(&ctx->xlat_list);
 	xlat_decref(ctx->xlat);
@@ -379,6 +398,9 @@ per_ctx_alloc(struct kdump_shared *shared, size_t sz)
 	}
 	shared->per_ctx_size[slot] = sz;
 
+	/* Worker contexts of the read pool lack the new slot. */
+	read_pool_free(shared);
+
 	/* Allocate memory. */
 	list_for_each_entry(ctx, &shared->ctx, list)
 		if (! (ctx->data[slot] = malloc(sz)) ) {
@@ -403,11 +425,72 @@ per_ctx_free(struct kdump_shared *shared, int slot)
 {
 	kdump_ctx_t *ctx;
 
+	read_pool_free(shared);
 	list_for_each_entry(ctx, &shared->ctx, list)
 		free(ctx->data[slot]);
 	shared->per_ctx_size[slot] = 0;
 }
 
+/**  Allocate a context for a worker thread.
+ * @param orig  Dump file object.
+ * @returns     New context, or @c NULL on allocation failure.
+ *
+ * The worker context shares everything with @p orig except the error
+ * message buffer and per-context data. It does not use a private page
+ * cache. No references are taken, so the worker context may be used
+ * only while the shared lock is held (at least for reading), and the
+ * dump file object which provides @c dict and @c xlat stays alive.
+ *
+ * Sharing @c dict and @c xlat with another dump file object is as safe
+ * as sharing them between clones made by @ref kdump_clone without any
+ * flags, which may also read concurrently under the shared lock.
+ *
+ * A worker context may be kept across releases of the shared lock if
+ * its owner re-points @c dict and @c xlat to a live dump file object
+ * before each use, and frees the worker context when per-context data
+ * changes (see @ref per_ctx_alloc). The read pool does this.
+ */
+kdump_ctx_t *
+worker_ctx_new(kdump_ctx_t *orig)
+{
+	kdump_ctx_t *ctx;
+	int slot;
+
+	ctx = calloc(1, sizeof (kdump_ctx_t) + ERRBUF);
+	if (!ctx)
+		return NULL;
+	err_init(&ctx->err, ERRBUF);
+
+	for (slot = 0; slot < PER_CTX_SLOTS; ++slot) {
+		size_t sz = orig->shared->per_ctx_size[slot];
+		if (sz && !(ctx->data[slot] = malloc(sz))) {
+			worker_ctx_free(ctx);
+			return NULL;
+		}
+	}
+
+	ctx->shared = orig->shared;
+	ctx->dict = orig->dict;
+	ctx->xlat = orig->xlat;
+	ctx->l1gen = orig->shared->cache_gen;
+	return ctx;
+}
+
+/**  Free a worker thread context.
+ * @param ctx  Context allocated by @ref worker_ctx_new.
+ */
+void
+worker_ctx_free(kdump_ctx_t *ctx)
+{
+	int slot;
+
+	for (slot = 0; slot < PER_CTX_SLOTS; ++slot)
+		free(ctx->data[slot]);
+	free(ctx->scratch);
+	err_cleanup(&ctx->err);
+	free(ctx);
+}
+
 const char *
 kdump_strerror(kdump_status status)
 {
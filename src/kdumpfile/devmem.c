@@ -39,6 +39,8 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 #include <endian.h>
 #include <sys/sysmacros.h>
 
@@ -47,11 +49,29 @@
 #define FN_XEN_CAPS	FN_XEN "/capabilities"
 #define FN_XEN_GUEST_TYPE	"/sys/hypervisor/guest_type"
 
-struct devmem_priv {
-	unsigned cache_size;
-	struct cache_entry *ce;
+/**  Trailer of a cached live page.
+ *
+ * Live memory changes, so each page cache element is followed by the
+ * time when the page was read and the page cache generation at that
+ * time.
+ */
+struct devmem_stamp {
+	uint64_t loaded;	/**< Load time (monotonic, in milliseconds). */
+	unsigned long gen;	/**< Value of @c cache_gen when loaded. */
 };
 
+/**  Get the current monotonic time in milliseconds.
+ * @returns  Current time.
+ */
+static uint64_t
+now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 static kdump_status
 check_xen_pv(kdump_ctx_t *ctx, bool *result)
 {
@@ -176,87 +196,170 @@ linux_iomem_kcode(kdump_ctx_t *ctx, kdump_paddr_t *paddr)
 	return ret;
 }
 
+/**  Check whether a cached live page must be re-read.
+ * @param ctx    Dump file object.
+ * @param stamp  Trailer of the cached page.
+ * @param now    Current time in milliseconds.
+ * @returns      @c true if the page is stale.
+ */
+static bool
+devmem_stale(kdump_ctx_t *ctx, const struct devmem_stamp *stamp, uint64_t now)
+{
+	kdump_num_t max_age;
+
+	if (stamp->gen != ctx->shared->cache_gen)
+		return true;
+	max_age = get_cache_max_age(ctx);
+	return max_age && now - stamp->loaded >= max_age;
+}
+
+/**  Read a live page from the memory device.
+ * @param ctx   Dump file object.
+ * @param buf   Target buffer.
+ * @param addr  Physical address of the page.
+ * @returns     Error status.
+ *
+ * The file cache is bypassed, because it would keep stale data.
+ */
 static kdump_status
-devmem_get_page(struct page_io *pio)
+devmem_read(kdump_ctx_t *ctx, void *buf, kdump_addr_t addr)
+{
+	size_t sz = get_page_size(ctx);
+	ssize_t rd;
+
+	rd = pread(fcache_fd(ctx->shared->fcache, 0), buf, sz, addr);
+	if (rd == sz)
+		return KDUMP_OK;
+	return set_error(ctx, read_error(rd),
+			 "Cannot read memory device at 0x%llx",
+			 (unsigned long long) addr);
+}
+
+/**  Refresh a stale live page.
+ * @param pio    Page I/O control.
+ * @param entry  Stale cache entry, referenced by the caller.
+ * @param now    Current time in milliseconds.
+ * @returns      Error status.
+ *
+ * Other readers may be copying from @p entry, so the page is read into
+ * a new buffer. If the caller holds the only reference, the new data
+ * is copied into the cache entry under the cache lock. Otherwise, the
+ * new buffer is returned, and the cached page is refreshed by a later
+ * read.
+ */
+static kdump_status
+devmem_refresh(struct page_io *pio, struct cache_entry *entry, uint64_t now)
 {
 	kdump_ctx_t *ctx = pio->ctx;
-	struct devmem_priv *dmp = ctx->shared->fmtdata;
-	struct cache_entry *ce;
-	unsigned i;
+	struct cache *cache = ctx->shared->cache;
+	size_t sz = get_page_size(ctx);
+	struct devmem_stamp *stamp = entry->data + sz;
 	kdump_status ret;
+	void *buf;
+	bool unshared;
 
-	ce = NULL;
-	for (i = 0; i < dmp->cache_size; ++i) {
-		if (dmp->ce[i].refcnt == 0) {
-			ce = &dmp->ce[i];
-		} else if (dmp->ce[i].key == pio->addr.addr) {
-			ce = &dmp->ce[i];
-			break;
-		}
+	buf = malloc(sz);
+	if (!buf) {
+		cache_put_entry(cache, entry);
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate page buffer");
+	}
+	ret = devmem_read(ctx, buf, pio->addr.addr);
+	if (ret != KDUMP_OK) {
+		free(buf);
+		cache_put_entry(cache, entry);
+		return ret;
 	}
-	if (!ce)
-		return set_error(ctx, KDUMP_ERR_BUSY,
-				 "Cache is fully utilized");
-	++ce->refcnt;
 
-	ce->key = pio->addr.addr;
 	mutex_lock(&ctx->shared->cache_lock);
-	ret = fcache_get_chunk(ctx->shared->fcache, &pio->chunk,
-			       get_page_size(ctx), 0, pio->addr.addr);
-	mutex_unlock(&ctx->shared->cache_lock);
-	if (ret != KDUMP_OK) {
-		--ce->refcnt;
-		return set_error(ctx, ret,
-				 "Cannot read memory device");
+	unshared = cache_entry_unshared(entry);
+	if (unshared) {
+		memcpy(entry->data, buf, sz);
+		stamp->loaded = now;
+		stamp->gen = ctx->shared->cache_gen;
 	}
+	mutex_unlock(&ctx->shared->cache_lock);
 
+	if (unshared) {
+		free(buf);
+		pio->chunk.data = entry->data;
+		pio->chunk.nent = 1;
+		pio->chunk.embed_fces->cache = cache;
+		pio->chunk.embed_fces->ce = entry;
+	} else {
+		cache_put_entry(cache, entry);
+		pio->chunk.data = buf;
+		pio->chunk.nent = 0;
+	}
 	return KDUMP_OK;
 }
 
-static void
-devmem_put_page(struct page_io *pio)
-{
-	--pio->chunk.embed_fces->ce->refcnt;
-}
-
+/**  Get a live page.
+ * @param pio  Page I/O control.
+ * @returns    Error status.
+ *
+ * Page stamps are read and written with the cache lock held, and all
+ * references to devmem cache entries are taken under the cache lock.
+ */
 static kdump_status
-devmem_realloc_caches(kdump_ctx_t *ctx)
+devmem_get_page(struct page_io *pio)
 {
-	struct devmem_priv *dmp = ctx->shared->fmtdata;
-	unsigned cache_size = get_cache_size(ctx);
-	struct cache_entry *ce;
-	unsigned i;
+	kdump_ctx_t *ctx = pio->ctx;
+	struct cache *cache = ctx->shared->cache;
+	size_t sz = get_page_size(ctx);
+	struct devmem_stamp *stamp;
+	struct cache_entry *entry;
+	bool valid, stale;
+	kdump_status ret;
+	uint64_t now;
 
-	ce = calloc(cache_size, sizeof *ce);
-	if (!ce)
-		return set_error(ctx, KDUMP_ERR_SYSTEM,
-				 "Cannot allocate cache (%u * %zu bytes)",
-				 cache_size, sizeof *ce);
-
-	ce[0].data = ctx_malloc(cache_size * get_page_size(ctx),
-				ctx, "cache data");
-	if (!ce[0].data) {
-		free(ce);
-		return KDUMP_ERR_SYSTEM;
+	now = now_ms();
+	mutex_lock(&ctx->shared->cache_lock);
+	entry = cache_get_entry(cache, pio->addr.addr | pio->addr.as);
+	if (entry) {
+		stamp = entry->data + sz;
+		valid = cache_entry_valid(entry);
+		stale = valid && devmem_stale(ctx, stamp, now);
 	}
+	mutex_unlock(&ctx->shared->cache_lock);
+	if (!entry)
+		return set_error(ctx, KDUMP_ERR_BUSY,
+				 "Cache is fully utilized");
 
-	for (i = 1; i < cache_size; ++i)
-		ce[i].data = ce[i-1].data + get_page_size(ctx);
-
-	dmp->cache_size = cache_size;
-	if (dmp->ce) {
-		free(dmp->ce[0].data);
-		free(dmp->ce);
+	if (stale)
+		return devmem_refresh(pio, entry, now);
+
+	if (!valid) {
+		ret = devmem_read(ctx, entry->data, pio->addr.addr);
+		mutex_lock(&ctx->shared->cache_lock);
+		if (ret == KDUMP_OK) {
+			stamp->loaded = now;
+			stamp->gen = ctx->shared->cache_gen;
+			cache_insert(cache, entry);
+		} else
+			cache_discard(cache, entry);
+		mutex_unlock(&ctx->shared->cache_lock);
+		if (ret != KDUMP_OK)
+			return ret;
 	}
-	dmp->ce = ce;
 
+	pio->chunk.data = entry->data;
+	pio->chunk.nent = 1;
+	pio->chunk.embed_fces->cache = cache;
+	pio->chunk.embed_fces->ce = entry;
 	return KDUMP_OK;
 }
 
+static kdump_status
+devmem_realloc_caches(kdump_ctx_t *ctx)
+{
+	return realloc_page_cache(ctx, get_page_size(ctx) +
+				  sizeof(struct devmem_stamp));
+}
+
 static kdump_status
 devmem_probe(kdump_ctx_t *ctx)
 {
-	struct devmem_priv *dmp;
 	struct stat st;
 	kdump_status ret;
 
@@ -269,12 +372,6 @@ devmem_probe(kdump_ctx_t *ctx)
 		return set_error(ctx, KDUMP_NOPROBE,
 				 "Not a memory dump character device");
 
-	dmp = ctx_malloc(sizeof *dmp, ctx, "Live source private data");
-	if (!dmp)
-		return KDUMP_ERR_SYSTEM;
-	dmp->ce = NULL;
-	ctx->shared->fmtdata = dmp;
-
 	set_file_description(ctx, "Live memory source");
 #if __BYTE_ORDER == __LITTLE_ENDIAN
 	set_byte_order(ctx, KDUMP_LITTLE_ENDIAN);
@@ -334,28 +431,10 @@ devmem_probe(kdump_ctx_t *ctx)
 	return KDUMP_OK;
 }
 
-static void
-devmem_cleanup(struct kdump_shared *shared)
-{
-	struct devmem_priv *dmp = shared->fmtdata;
-
-	if (!dmp)
-		return;
-
-	if (dmp->ce) {
-		free(dmp->ce[0].data);
-		free(dmp->ce);
-	}
-
-	free(dmp);
-	shared->fmtdata = NULL;
-}
-
 const struct format_ops devmem_ops = {
 	.name = "memory",
 	.probe = devmem_probe,
 	.get_page = devmem_get_page,
-	.put_page = devmem_put_page,
+	.put_page = cache_put_page,
 	.realloc_caches = devmem_realloc_caches,
-	.cleanup = devmem_cleanup,
 };
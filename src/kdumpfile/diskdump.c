@@ -194,6 +194,15 @@ struct disk_dump_priv {
 	/** Memory region mapping. */
 	struct pfn_file_map mem_pagemap;
 
+	/** Compressed page cache, or @c NULL. */
+	struct zcache *zcache;
+
+	/** File offsets of zero page data, or zero if not known.
+	 * makedumpfile writes only one copy of a page filled with zeros,
+	 * and the page descriptors of all zero pages point to it.
+	 */
+	off_t *zero_off;
+
 	/** Page descriptor mapping. */
 	struct pfn_file_map pdmap[];
 };
@@ -212,6 +221,11 @@ struct setup_data {
 #define DUMP_DH_COMPRESSED_SNAPPY 0x4	/* page is compressed with snappy */
 #define DUMP_DH_COMPRESSED_ZSTD	0x20	/* page is compressed with zstd */
 
+/** Expected compression ratio of page data.
+ * This is used to size the index of the compressed page cache.
+ */
+#define ZCACHE_RATIO	4
+
 /* Any compression flag */
 #define DUMP_DH_COMPRESSED	( 0	\
 	| DUMP_DH_COMPRESSED_ZLIB	\
@@ -237,6 +251,43 @@ pfn_to_pdpos(const struct pfn_file_map *pdmap, unsigned long pfn)
 		: (off_t) -1;
 }
 
+/**  Find the page descriptor of a PFN.
+ * @param ddp    Diskdump private data.
+ * @param pfn    Page frame number.
+ * @param pdmap  Set to the page descriptor map of the file.
+ * @returns      File position of the page descriptor,
+ *               or @c (off_t)-1 if the page is excluded.
+ */
+static off_t
+find_pd(const struct disk_dump_priv *ddp, kdump_pfn_t pfn,
+	const struct pfn_file_map **pdmap)
+{
+	*pdmap = find_pfn_file_map(ddp->pdmap, ddp->num_files, pfn);
+	return *pdmap && (*pdmap)->start_pfn <= pfn
+		? pfn_to_pdpos(*pdmap, pfn)
+		: (off_t) -1;
+}
+
+/**  Find the end of a dump file's PFN range.
+ * @param ctx  Dump file object.
+ * @param pfn  Page frame number.
+ * @returns    First PFN above @p pfn which is in another file
+ *             (or in a gap between files).
+ */
+static kdump_pfn_t
+diskdump_file_end_pfn(kdump_ctx_t *ctx, kdump_pfn_t pfn)
+{
+	struct disk_dump_priv *ddp = ctx->shared->fmtdata;
+	const struct pfn_file_map *pdmap;
+
+	pdmap = find_pfn_file_map(ddp->pdmap, ddp->num_files, pfn);
+	if (!pdmap)
+		return KDUMP_PFN_MAX;
+	return pfn < pdmap->start_pfn
+		? pdmap->start_pfn
+		: pdmap->end_pfn;
+}
+
 static kdump_status
 diskdump_get_bits(kdump_errmsg_t *err, const kdump_bmp_t *bmp,
 		  kdump_addr_t first, kdump_addr_t last, unsigned char *bits)
@@ -349,84 +400,25 @@ static const struct kdump_bmp_ops mem_pagemap_ops = {
 	.cleanup = diskdump_bmp_cleanup,
 };
 
+/** Decompress a page.
+ * @param ctx    Dump file object.
+ * @param dst    Destination buffer (one page).
+ * @param src    Compressed data.
+ * @param size   Size of compressed data.
+ * @param flags  Page descriptor flags.
+ * @returns      Error status.
+ */
 static kdump_status
-diskdump_read_page(struct page_io *pio)
+decompress_page(kdump_ctx_t *ctx, void *dst, void *src, size_t size,
+		uint32_t flags)
 {
-	kdump_ctx_t *ctx = pio->ctx;
-	struct disk_dump_priv *ddp = ctx->shared->fmtdata;
-	kdump_pfn_t pfn;
-	const struct pfn_file_map *pdmap;
-	struct fcache_chunk fch;
-	struct page_desc pd;
-	off_t pd_pos;
-	kdump_status ret;
-
-	pfn = pio->addr.addr >> get_page_shift(ctx);
-	if (pfn >= get_max_pfn(ctx))
-		return set_error(ctx, KDUMP_ERR_NODATA, "Out-of-bounds PFN");
-
-	pdmap = find_pfn_file_map(ddp->pdmap, ddp->num_files, pfn);
-	pd_pos = pdmap && pdmap->start_pfn <= pfn
-		? pfn_to_pdpos(pdmap, pfn)
-		: (off_t) -1;
-	if (pd_pos == (off_t)-1) {
-		if (get_zero_excluded(ctx)) {
-			memset(pio->chunk.data, 0, get_page_size(ctx));
-			return KDUMP_OK;
-		}
-		return set_error(ctx, KDUMP_ERR_NODATA, "Excluded page");
-	}
-
-	mutex_lock(&ctx->shared->cache_lock);
-	ret = flatmap_pread(ctx->shared->flatmap, &pd, sizeof pd,
-			    pdmap->fidx, pd_pos);
-	mutex_unlock(&ctx->shared->cache_lock);
-	if (ret != KDUMP_OK)
-		return set_error(ctx, ret,
-				 "Cannot read page descriptor at %llu",
-				 (unsigned long long) pd_pos);
-
-	pd.offset = dump64toh(ctx, pd.offset);
-	pd.size = dump32toh(ctx, pd.size);
-	pd.flags = dump32toh(ctx, pd.flags);
-	pd.page_flags = dump64toh(ctx, pd.page_flags);
-
-	/* read page data */
-	if (pd.flags & DUMP_DH_COMPRESSED) {
-		mutex_lock(&ctx->shared->cache_lock);
-		ret = flatmap_get_chunk(ctx->shared->flatmap, &fch, pd.size,
-					pdmap->fidx, pd.offset);
-		mutex_unlock(&ctx->shared->cache_lock);
-	} else {
-		if (pd.size != get_page_size(ctx))
-			return set_error(ctx, KDUMP_ERR_CORRUPT,
-					 "Wrong page size: %"PRIu32,
-					 pd.size);
-		mutex_lock(&ctx->shared->cache_lock);
-		ret = flatmap_pread(ctx->shared->flatmap, pio->chunk.data,
-				    pd.size, pdmap->fidx, pd.offset);
-		mutex_unlock(&ctx->shared->cache_lock);
-	}
-
-	if (ret != KDUMP_OK)
-		return set_error(ctx, ret,
-				 "Cannot read page data at %llu",
-				 (unsigned long long) pd.offset);
-
-	if (pd.flags & DUMP_DH_COMPRESSED_ZLIB) {
-		ret = uncompress_page_gzip(ctx, pio->chunk.data,
-					   fch.data, pd.size);
-		fcache_put_chunk(&fch);
-		if (ret != KDUMP_OK)
-			return ret;
-	} else if (pd.flags & DUMP_DH_COMPRESSED_LZO) {
+	if (flags & DUMP_DH_COMPRESSED_ZLIB)
+		return uncompress_page_gzip(ctx, dst, src, size);
+	else if (flags & DUMP_DH_COMPRESSED_LZO) {
 #if USE_LZO
 		lzo_uint retlen = get_page_size(ctx);
-		int ret = lzo1x_decompress_safe(fch.data, pd.size,
-						pio->chunk.data,
-						&retlen,
+		int ret = lzo1x_decompress_safe(src, size, dst, &retlen,
 						LZO1X_MEM_DECOMPRESS);
-		fcache_put_chunk(&fch);
 		if (ret != LZO_E_OK)
 			return set_error(ctx, KDUMP_ERR_CORRUPT,
 					 "Decompression failed: %d", ret);
@@ -439,13 +431,11 @@ diskdump_read_page(struct page_io *pio)
 				 "Unsupported compression method: %s",
 				 "lzo");
 #endif
-	} else if (pd.flags & DUMP_DH_COMPRESSED_SNAPPY) {
+	} else if (flags & DUMP_DH_COMPRESSED_SNAPPY) {
 #if USE_SNAPPY
 		size_t retlen = get_page_size(ctx);
 		snappy_status ret;
-		ret = snappy_uncompress(fch.data, pd.size,
-					pio->chunk.data, &retlen);
-		fcache_put_chunk(&fch);
+		ret = snappy_uncompress(src, size, dst, &retlen);
 		if (ret != SNAPPY_OK)
 			return set_error(ctx, KDUMP_ERR_CORRUPT,
 					 "Decompression failed: %d",
@@ -459,12 +449,10 @@ diskdump_read_page(struct page_io *pio)
 				 "Unsupported compression method: %s",
 				 "snappy");
 #endif
-	} else if (pd.flags & DUMP_DH_COMPRESSED_ZSTD) {
+	} else if (flags & DUMP_DH_COMPRESSED_ZSTD) {
 #if USE_ZSTD
 		size_t ret;
-		ret = ZSTD_decompress(pio->chunk.data, get_page_size(ctx),
-				      fch.data, pd.size);
-		fcache_put_chunk(&fch);
+		ret = ZSTD_decompress(dst, get_page_size(ctx), src, size);
 		if (ZSTD_isError(ret))
 			return set_error(ctx, KDUMP_ERR_CORRUPT,
 					 "Decompression failed: %s",
@@ -479,12 +467,118 @@ diskdump_read_page(struct page_io *pio)
 #endif
 	}
 
+
 	return KDUMP_OK;
 }
 
+static kdump_status
+diskdump_read_page(struct page_io *pio)
+{
+	kdump_ctx_t *ctx = pio->ctx;
+	struct disk_dump_priv *ddp = ctx->shared->fmtdata;
+	kdump_pfn_t pfn;
+	const struct pfn_file_map *pdmap;
+	struct fcache_chunk fch;
+	struct page_desc pd;
+	off_t pd_pos;
+	void *scratch;
+	kdump_status ret;
+
+	pfn = pio->addr.addr >> get_page_shift(ctx);
+	if (pfn >= get_max_pfn(ctx))
+		return set_error(ctx, KDUMP_ERR_NODATA, "Out-of-bounds PFN");
+
+	pd_pos = find_pd(ddp, pfn, &pdmap);
+	if (pd_pos == (off_t)-1) {
+		if (get_zero_excluded(ctx))
+			return get_zero_page(pio);
+		return set_error(ctx, KDUMP_ERR_NODATA, "Excluded page");
+	}
+
+	/* Try the compressed page cache first. */
+	if (ddp->zcache) {
+		size_t size = get_page_size(ctx);
+		unsigned flags;
+
+		scratch = get_scratch(ctx, size);
+		size = scratch
+			? zcache_get(ddp->zcache, pfn, &flags, scratch, size)
+			: 0;
+		if (size)
+			return decompress_page(ctx, pio->chunk.data,
+					       scratch, size, flags);
+	}
+
+	ret = flatmap_pread(ctx->shared->flatmap, &pd, sizeof pd,
+			    pdmap->fidx, pd_pos);
+	if (ret != KDUMP_OK)
+		return set_error(ctx, ret,
+				 "Cannot read page descriptor at %llu",
+				 (unsigned long long) pd_pos);
+
+	pd.offset = dump64toh(ctx, pd.offset);
+	pd.size = dump32toh(ctx, pd.size);
+	pd.flags = dump32toh(ctx, pd.flags);
+	pd.page_flags = dump64toh(ctx, pd.page_flags);
+
+	/* read page data */
+	if (!(pd.flags & DUMP_DH_COMPRESSED)) {
+		off_t *zero_off = &ddp->zero_off[pdmap->fidx];
+
+		if (pd.size != get_page_size(ctx))
+			return set_error(ctx, KDUMP_ERR_CORRUPT,
+					 "Wrong page size: %"PRIu32,
+					 pd.size);
+		if (pd.offset == __atomic_load_n(zero_off, __ATOMIC_RELAXED))
+			return get_zero_page(pio);
+
+		ret = flatmap_pread(ctx->shared->flatmap, pio->chunk.data,
+				    pd.size, pdmap->fidx, pd.offset);
+		if (ret != KDUMP_OK)
+			return set_error(ctx, ret,
+					 "Cannot read page data at %llu",
+					 (unsigned long long) pd.offset);
+
+		/* Remember where the shared zero page data is. */
+		if (!memcmp(pio->chunk.data, ctx->shared->zero_page, pd.size)) {
+			__atomic_store_n(zero_off, pd.offset, __ATOMIC_RELAXED);
+			return get_zero_page(pio);
+		}
+		return KDUMP_OK;
+	}
+
+	scratch = get_scratch(ctx, pd.size);
+	ret = scratch
+		? flatmap_get_chunk_buf(ctx->shared->flatmap, &fch, pd.size,
+					pdmap->fidx, pd.offset, scratch)
+		: flatmap_get_chunk(ctx->shared->flatmap, &fch, pd.size,
+				    pdmap->fidx, pd.offset);
+	if (ret != KDUMP_OK)
+		return set_error(ctx, ret,
+				 "Cannot read page data at %llu",
+				 (unsigned long long) pd.offset);
+
+	if (ddp->zcache)
+		zcache_put(ddp->zcache, pfn, pd.flags, fch.data, pd.size);
+	ret = decompress_page(ctx, pio->chunk.data, fch.data, pd.size,
+			      pd.flags);
+	fcache_put_chunk(&fch);
+	return ret;
+}
+
 static kdump_status
 diskdump_get_page(struct page_io *pio)
 {
+	kdump_ctx_t *ctx = pio->ctx;
+	const struct pfn_file_map *pdmap;
+	kdump_pfn_t pfn;
+
+	/* Excluded pages need not go through the cache. */
+	pfn = pio->addr.addr >> get_page_shift(ctx);
+	if (get_zero_excluded(ctx) && pfn < get_max_pfn(ctx) &&
+	    find_pd(ctx->shared->fmtdata, pfn, &pdmap) == (off_t)-1)
+		return get_zero_page(pio);
+
 	return cache_get_page(pio, diskdump_read_page);
 }
 
@@ -1033,6 +1127,11 @@ init_private(kdump_ctx_t *ctx)
 	ctx->shared->fmtdata = ddp;
 	ddp->num_files = get_num_files(ctx);
 
+	ddp->zero_off = calloc(ddp->num_files, sizeof(*ddp->zero_off));
+	if (!ddp->zero_off)
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate diskdump private data");
+
 	return KDUMP_OK;
 }
 
@@ -1156,6 +1255,46 @@ diskdump_probe(kdump_ctx_t *ctx)
 	return open_common(ctx, hdr);
 }
 
+/**  Re-allocate diskdump caches.
+ * @param ctx  Dump file object.
+ * @returns    Error status.
+ *
+ * In addition to the default page cache, allocate a cache of compressed
+ * page payloads if "cache.compressed_bytes" is set.
+ */
+static kdump_status
+diskdump_realloc_caches(kdump_ctx_t *ctx)
+{
+	struct disk_dump_priv *ddp = ctx->shared->fmtdata;
+	kdump_num_t bytes;
+	kdump_status status;
+
+	status = def_realloc_caches(ctx);
+	if (status != KDUMP_OK || !ddp)
+		return status;
+
+	if (ddp->zcache) {
+		zcache_free(ddp->zcache);
+		ddp->zcache = NULL;
+	}
+
+	bytes = get_cache_compressed_bytes(ctx);
+	if (!bytes)
+		return KDUMP_OK;
+	if (bytes > SIZE_MAX)
+		bytes = SIZE_MAX;
+
+	ddp->zcache = zcache_alloc(bytes,
+				   get_page_size(ctx) / ZCACHE_RATIO,
+				   get_cache_arena(ctx));
+	if (!ddp->zcache)
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate compressed page cache"
+				 " (%" KDUMP_PRIuNUM " bytes)", bytes);
+
+	return KDUMP_OK;
+}
+
 static void
 diskdump_attr_cleanup(struct attr_dict *dict)
 {
@@ -1172,6 +1311,10 @@ diskdump_cleanup(struct kdump_shared *shared)
 
 	if (ddp) {
 		unsigned fidx;
+		if (ddp->zcache)
+			zcache_free(ddp->zcache);
+		if (ddp->zero_off)
+			free(ddp->zero_off);
 		for (fidx = 0; fidx < ddp->num_files; ++fidx) {
 			struct pfn_file_map *pdmap = &ddp->pdmap[fidx];
 			if (pdmap->regions)
@@ -1187,7 +1330,8 @@ const struct format_ops diskdump_ops = {
 	.probe = diskdump_probe,
 	.get_page = diskdump_get_page,
 	.put_page = cache_put_page,
-	.realloc_caches = def_realloc_caches,
+	.file_end_pfn = diskdump_file_end_pfn,
+	.realloc_caches = diskdump_realloc_caches,
 	.attr_cleanup = diskdump_attr_cleanup,
 	.cleanup = diskdump_cleanup,
 };
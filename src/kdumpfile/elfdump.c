@@ -108,8 +108,8 @@ struct pfn2idx_map {
 	struct pfn2idx *singles; /**< Single pages outside of any range. */
 };
 
-/** PFN-to-index vector allocation increment.
- * For optimal performance, this should be a power of two.
+/** Initial PFN-to-index vector allocation.
+ * This must be a power of two.
  */
 #define PFN2IDX_ALLOC_INC    16
 
@@ -632,14 +632,31 @@ pfn2idx_map_free(struct pfn2idx_map *map)
 	free(map->singles);
 }
 
+/** Get the new size of a full PFN-to-index vector.
+ * @param n  Number of elements in the vector.
+ * @returns  New number of allocated elements if the vector is full,
+ *           zero otherwise.
+ *
+ * Vectors grow by doubling, so building a map with millions of single
+ * pages does not re-allocate the vector millions of times.
+ */
+static inline size_t
+pfn2idx_grow(size_t n)
+{
+	if (!n)
+		return PFN2IDX_ALLOC_INC;
+	return n >= PFN2IDX_ALLOC_INC && !(n & (n - 1)) ? 2 * n : 0;
+}
+
 static kdump_status
 pfn2idx_map_addrange(struct pfn2idx_map *map, struct pfn2idx_range *range)
 {
+	size_t newnum;
+
 	if (range->len > 1 || range->len < -1) {
-		if (map->nranges % PFN2IDX_ALLOC_INC == 0) {
+		if ( (newnum = pfn2idx_grow(map->nranges)) ) {
 			struct pfn2idx_range *newranges;
-			size_t newsz = (map->nranges + PFN2IDX_ALLOC_INC) *
-				sizeof *newranges;
+			size_t newsz = newnum * sizeof *newranges;
 			newranges = realloc(map->ranges, newsz);
 			if (!newranges)
 				return KDUMP_ERR_SYSTEM;
@@ -651,10 +668,9 @@ pfn2idx_map_addrange(struct pfn2idx_map *map, struct pfn2idx_range *range)
 		map->ranges[map->nranges].len = range->len;
 		map->nranges++;
 	} else if (range->len) {
-		if (map->nsingles % PFN2IDX_ALLOC_INC == 0) {
+		if ( (newnum = pfn2idx_grow(map->nsingles)) ) {
 			struct pfn2idx *newsingles;
-			size_t newsz = (map->nsingles + PFN2IDX_ALLOC_INC) *
-				sizeof *newsingles;
+			size_t newsz = newnum * sizeof *newsingles;
 			newsingles = realloc(map->singles, newsz);
 			if (!newsingles)
 				return KDUMP_ERR_SYSTEM;
@@ -722,165 +738,368 @@ pfn2idx_map_end(struct pfn2idx_map *map, struct pfn2idx_range *range)
 	return KDUMP_OK;
 }
 
+/** Merge sorted arrays.
+ * @param dst   Target array.
+ * @param src   Source arrays.
+ * @param cnt   Number of elements in each source array.
+ * @param n     Number of source arrays.
+ * @param size  Size of one element.
+ * @param cmp   Comparison function.
+ */
+static void
+merge_sorted(void *dst, void *const *src, const size_t *cnt, unsigned n,
+	     size_t size, int (*cmp)(const void *, const void *))
+{
+	size_t pos[n];
+	unsigned i, best;
+
+	memset(pos, 0, sizeof pos);
+	for (;;) {
+		best = n;
+		for (i = 0; i < n; ++i)
+			if (pos[i] < cnt[i] &&
+			    (best == n ||
+			     cmp(src[i] + pos[i] * size,
+				 src[best] + pos[best] * size) < 0))
+				best = i;
+		if (best == n)
+			break;
+		memcpy(dst, src[best] + pos[best] * size, size);
+		dst += size;
+		++pos[best];
+	}
+}
+
+/** Merge sorted PFN-to-index maps.
+ * @param map  Target map.
+ * @param src  Source maps. They are freed on success.
+ * @param n    Number of source maps.
+ * @returns    Error status.
+ */
+static kdump_status
+pfn2idx_map_merge(struct pfn2idx_map *map, struct pfn2idx_map *const *src,
+		  unsigned n)
+{
+	void *ranges[n], *singles[n];
+	size_t nranges[n], nsingles[n];
+	unsigned i;
+
+	if (n == 1) {
+		*map = *src[0];
+		return KDUMP_OK;
+	}
+
+	map->nranges = map->nsingles = 0;
+	for (i = 0; i < n; ++i) {
+		ranges[i] = src[i]->ranges;
+		nranges[i] = src[i]->nranges;
+		map->nranges += nranges[i];
+		singles[i] = src[i]->singles;
+		nsingles[i] = src[i]->nsingles;
+		map->nsingles += nsingles[i];
+	}
+
+	map->ranges = malloc(map->nranges * sizeof *map->ranges);
+	map->singles = malloc(map->nsingles * sizeof *map->singles);
+	if ((map->nranges && !map->ranges) ||
+	    (map->nsingles && !map->singles)) {
+		pfn2idx_map_free(map);
+		map->nranges = map->nsingles = 0;
+		map->ranges = NULL;
+		map->singles = NULL;
+		return KDUMP_ERR_SYSTEM;
+	}
+
+	merge_sorted(map->ranges, ranges, nranges, n,
+		     sizeof *map->ranges, pfn2idx_range_cmp);
+	merge_sorted(map->singles, singles, nsingles, n,
+		     sizeof *map->singles, pfn2idx_single_cmp);
+	for (i = 0; i < n; ++i)
+		pfn2idx_map_free(src[i]);
+	return KDUMP_OK;
+}
+
 static uint_fast64_t
-pfn2idx_map_search(struct pfn2idx_map *map, kdump_pfn_t pfn)
+pfn2idx_map_search(const struct pfn2idx_map *map, kdump_pfn_t pfn)
 {
-	size_t i;
-	for (i = 0; i < map->nranges; ++i) {
-		struct pfn2idx_range *r = &map->ranges[i];
+	const struct pfn2idx *single;
+	struct pfn2idx key;
+	size_t left, right;
+
+	left = 0;
+	right = map->nranges;
+	while (left != right) {
+		size_t mid = (left + right) / 2;
+		const struct pfn2idx_range *r = &map->ranges[mid];
+		kdump_pfn_t first, last;
+
 		if (r->len >= 0) {
-			if (pfn < r->pfn - r->len + 1)
-				break;
-			if (pfn <= r->pfn)
-				return r->idx + pfn - r->pfn;
+			first = r->pfn - r->len + 1;
+			last = r->pfn;
 		} else {
-			if (pfn < r->pfn)
-				break;
-			if (pfn <= r->pfn - r->len - 1)
-				return r->idx + r->pfn - pfn;
+			first = r->pfn;
+			last = r->pfn - r->len - 1;
 		}
-	}
 
-	for (i = 0; i < map->nsingles && pfn >= map->singles[i].pfn; ++i)
-		if (map->singles[i].pfn == pfn)
-			return map->singles[i].idx;
+		if (pfn < first)
+			right = mid;
+		else if (pfn > last)
+			left = mid + 1;
+		else
+			return r->len >= 0
+				? r->idx + pfn - r->pfn
+				: r->idx + r->pfn - pfn;
+	}
 
-	return IDX_NONE;
+	key.pfn = pfn;
+	single = bsearch(&key, map->singles, map->nsingles,
+			 sizeof *map->singles, pfn2idx_single_cmp);
+	return single ? single->idx : IDX_NONE;
 }
 
-static kdump_status
-make_xen_pfn_map_auto(kdump_ctx_t *ctx, const struct section *sect)
+#if USE_PTHREAD
+/** Maximum number of threads used to parse a Xen page map. */
+#define XEN_MAP_THREADS		8
+#else
+#define XEN_MAP_THREADS		1
+#endif
+
+/** Minimum number of Xen page map entries parsed by one thread. */
+#define XEN_MAP_PART_ENTRIES	4096
+
+/** Part of a Xen page map parsed by one thread.
+ */
+struct xen_map_part {
+	kdump_ctx_t *ctx;	   /**< Dump file object. */
+	off_t pos;		   /**< File position of the first entry. */
+	size_t count;		   /**< Number of entries. */
+	uint_fast64_t idx;	   /**< Page index of the first entry. */
+	bool p2m;		   /**< Entries are @c struct @ref xen_p2m. */
+
+	struct pfn2idx_map pfnmap; /**< PFN map of this part. */
+	struct pfn2idx_map mfnmap; /**< GMFN map of this part. */
+	kdump_pfn_t max_pfn;	   /**< One above the highest PFN. */
+
+	kdump_status status;	   /**< Result of parsing. */
+	const char *errwhat;	   /**< What cannot be mapped, or @c NULL
+				    *   if the page map cannot be read. */
+	uint64_t errval;	   /**< Value that cannot be mapped. */
+	uint_fast64_t erridx;	   /**< Index that cannot be mapped. */
+	off_t errpos;		   /**< File position of a read error. */
+
+#if USE_PTHREAD
+	pthread_t tid;		   /**< Worker thread. */
+	bool started;		   /**< Worker thread is running. */
+#endif
+};
+
+/** Parse a part of a Xen page map.
+ * @param arg  Part to be parsed.
+ * @returns    Always @c NULL.
+ *
+ * The resulting maps are sorted, and they can be merged with other
+ * parts. Errors are stored in @p arg, because the dump file object
+ * is shared with other threads.
+ */
+static void *
+parse_xen_map_part(void *arg)
 {
-	struct elfdump_priv *edp = ctx->shared->fmtdata;
-	kdump_pfn_t max_pfn = 0;
-	uint64_t pfn;
-	struct pfn2idx_range range;
-	off_t pos, endpos;
+	struct xen_map_part *part = arg;
+	kdump_ctx_t *ctx = part->ctx;
+	size_t entsz = part->p2m ? sizeof(struct xen_p2m) : sizeof(uint64_t);
+	struct pfn2idx_range pfnrange, mfnrange;
+	struct xen_p2m fb;
 	struct fcache_entry fce;
+	uint64_t pfn, gmfn;
+	off_t pos;
+	size_t i;
 	kdump_status status;
 
-	pfn2idx_map_start(&edp->xen_pfnmap, &range);
+	pfn2idx_map_start(&part->pfnmap, &pfnrange);
+	pfn2idx_map_start(&part->mfnmap, &mfnrange);
+	pfnrange.idx = mfnrange.idx = part->idx;
+	part->max_pfn = 0;
+	part->errwhat = NULL;
 
-	pos = edp->xen_map_offset = sect->file_offset;
-	endpos = pos + sect->size - sizeof pfn;
+	pos = part->pos;
 	fce.len = 0;
 	fce.cache = NULL;
-	while (pos <= endpos) {
-		if (fce.len < sizeof pfn) {
+	for (i = 0; i < part->count; ++i) {
+		if (fce.len < entsz) {
 			fcache_put(&fce);
 			status = fcache_get_fb(ctx->shared->fcache, &fce,
-					       0, pos, &pfn, sizeof pfn);
-			if (status != KDUMP_OK)
-				goto err_read;
+					       0, pos, &fb, entsz);
+			if (status != KDUMP_OK) {
+				part->errpos = pos;
+				goto out;
+			}
 		}
-		pfn = dump64toh(ctx, *(uint64_t*)fce.data);
 
-		if (pfn >= max_pfn)
-			max_pfn = pfn + 1;
+		/* The PFN is the first member of struct xen_p2m. */
+		pfn = dump64toh(ctx, *(uint64_t*)fce.data);
+		if (pfn >= part->max_pfn)
+			part->max_pfn = pfn + 1;
+		status = pfn2idx_map_add(&part->pfnmap, &pfnrange, pfn);
+		if (status != KDUMP_OK) {
+			part->errwhat = "PFN";
+			part->errval = pfn;
+			part->erridx = pfnrange.idx;
+			goto out_put;
+		}
 
-		status = pfn2idx_map_add(&edp->xen_pfnmap, &range, pfn);
-		if (status != KDUMP_OK)
-			goto err_pfn;
+		if (part->p2m) {
+			gmfn = dump64toh(ctx,
+					 ((struct xen_p2m*)fce.data)->gmfn);
+			status = pfn2idx_map_add(&part->mfnmap,
+						 &mfnrange, gmfn);
+			if (status != KDUMP_OK) {
+				part->errwhat = "MFN";
+				part->errval = gmfn;
+				part->erridx = mfnrange.idx;
+				goto out_put;
+			}
+		}
 
-		fce.data += sizeof pfn;
-		fce.len -= sizeof pfn;
-		pos += sizeof pfn;
+		fce.data += entsz;
+		fce.len -= entsz;
+		pos += entsz;
 	}
-	status = pfn2idx_map_end(&edp->xen_pfnmap, &range);
-	if (status != KDUMP_OK)
-		goto err_pfn;
-
-	/* TODO: Warn if endpos - pos < sizeof pfn */
 
-	fcache_put(&fce);
-
-	set_max_pfn(ctx, max_pfn);
-	return status;
+	status = pfn2idx_map_end(&part->pfnmap, &pfnrange);
+	if (status != KDUMP_OK) {
+		part->errwhat = "PFN";
+		part->errval = pfnrange.pfn;
+		part->erridx = pfnrange.idx;
+	} else if (part->p2m) {
+		status = pfn2idx_map_end(&part->mfnmap, &mfnrange);
+		if (status != KDUMP_OK) {
+			part->errwhat = "MFN";
+			part->errval = mfnrange.pfn;
+			part->erridx = mfnrange.idx;
+		}
+	}
 
- err_pfn:
-	pfn = dump64toh(ctx, *(uint64_t*)fce.data);
-	set_error(ctx, status, "Cannot map %s 0x%"PRIx64" -> 0x%"PRIxFAST64,
-		  "PFN", pfn, range.idx);
+ out_put:
 	fcache_put(&fce);
-	return status;
-
- err_read:
-	return set_read_error(ctx, status, "Xen map", pos);
+ out:
+	part->status = status;
+	return NULL;
 }
 
+/** Build the PFN-to-index maps from a Xen page map.
+ * @param ctx   Dump file object.
+ * @param sect  Section with the Xen page map.
+ * @param p2m   @c true for a P2M map (non-auto-translated guests),
+ *              @c false for a PFN map (auto-translated guests).
+ * @returns     Error status.
+ *
+ * Big page maps are split into parts, and each part is parsed by
+ * a separate thread. The sorted results are merged afterwards.
+ */
 static kdump_status
-make_xen_pfn_map_nonauto(kdump_ctx_t *ctx, const struct section *sect)
+make_xen_pfn_map(kdump_ctx_t *ctx, const struct section *sect, bool p2m)
 {
 	struct elfdump_priv *edp = ctx->shared->fmtdata;
-	kdump_pfn_t max_pfn = 0;
-	struct xen_p2m p2m;
-	struct pfn2idx_range pfnrange, mfnrange;
-	off_t pos, endpos;
-	struct fcache_entry fce;
+	size_t entsz = p2m ? sizeof(struct xen_p2m) : sizeof(uint64_t);
+	size_t count = sect->size / entsz;
+	struct xen_map_part parts[XEN_MAP_THREADS];
+	struct pfn2idx_map *maps[XEN_MAP_THREADS];
+	kdump_pfn_t max_pfn;
 	kdump_status status;
+	size_t start;
+	unsigned i, n;
+
+	/* TODO: Warn if sect->size is not a multiple of entsz */
+
+	edp->xen_map_offset = sect->file_offset;
+
+	n = count / XEN_MAP_PART_ENTRIES;
+	if (n > XEN_MAP_THREADS)
+		n = XEN_MAP_THREADS;
+	else if (!n)
+		n = 1;
+
+	start = 0;
+	for (i = 0; i < n; ++i) {
+		struct xen_map_part *part = &parts[i];
+		size_t end = (i < n - 1) ? (i + 1) * (count / n) : count;
+
+		part->ctx = ctx;
+		part->pos = sect->file_offset + start * entsz;
+		part->count = end - start;
+		part->idx = start;
+		part->p2m = p2m;
+		start = end;
+
+#if USE_PTHREAD
+		part->started = i &&
+			!pthread_create(&part->tid, NULL,
+					parse_xen_map_part, part);
+#endif
+	}
 
-	pfn2idx_map_start(&edp->xen_pfnmap, &pfnrange);
-	pfn2idx_map_start(&edp->xen_mfnmap, &mfnrange);
-
-	pos = edp->xen_map_offset = sect->file_offset;
-	endpos = pos + sect->size - sizeof p2m;
-	fce.len = 0;
-	fce.cache = NULL;
-	while (pos <= endpos) {
-		if (fce.len < sizeof p2m) {
-			fcache_put(&fce);
-			status = fcache_get_fb(ctx->shared->fcache, &fce,
-					       0, pos, &p2m, sizeof p2m);
-			if (status != KDUMP_OK)
-				goto err_read;
-		}
-		p2m.pfn = dump64toh(ctx, ((struct xen_p2m*)fce.data)->pfn);
-		p2m.gmfn = dump64toh(ctx, ((struct xen_p2m*)fce.data)->gmfn);
-
-		if (p2m.pfn >= max_pfn)
-			max_pfn = p2m.pfn + 1;
+	for (i = 0; i < n; ++i) {
+#if USE_PTHREAD
+		if (parts[i].started)
+			continue;
+#endif
+		parse_xen_map_part(&parts[i]);
+	}
 
-		status = pfn2idx_map_add(&edp->xen_pfnmap, &pfnrange, p2m.pfn);
-		if (status != KDUMP_OK)
-			goto err_pfn;
-		status = pfn2idx_map_add(&edp->xen_mfnmap, &mfnrange, p2m.gmfn);
-		if (status != KDUMP_OK)
-			goto err_mfn;
+	status = KDUMP_OK;
+	max_pfn = 0;
+	for (i = 0; i < n; ++i) {
+		struct xen_map_part *part = &parts[i];
 
-		fce.data += sizeof p2m;
-		fce.len -= sizeof p2m;
-		pos += sizeof p2m;
+#if USE_PTHREAD
+		if (part->started)
+			pthread_join(part->tid, NULL);
+#endif
+		if (status == KDUMP_OK && part->status != KDUMP_OK) {
+			status = part->status;
+			if (part->errwhat)
+				set_error(ctx, status, "Cannot map %s 0x%"PRIx64
+					  " -> 0x%"PRIxFAST64, part->errwhat,
+					  part->errval, part->erridx);
+			else
+				set_read_error(ctx, status, "Xen map",
+					       part->errpos);
+		}
+		if (part->max_pfn > max_pfn)
+			max_pfn = part->max_pfn;
 	}
-	status = pfn2idx_map_end(&edp->xen_pfnmap, &pfnrange);
-	if (status != KDUMP_OK)
-			goto err_pfn;
-	status = pfn2idx_map_end(&edp->xen_mfnmap, &mfnrange);
 	if (status != KDUMP_OK)
-			goto err_mfn;
+		goto err;
 
-	/* TODO: Warn if endpos - pos < sizeof p2m */
-
-	fcache_put(&fce);
+	for (i = 0; i < n; ++i)
+		maps[i] = &parts[i].pfnmap;
+	status = pfn2idx_map_merge(&edp->xen_pfnmap, maps, n);
+	if (status != KDUMP_OK)
+		goto err_alloc;
+
+	if (p2m) {
+		for (i = 0; i < n; ++i)
+			maps[i] = &parts[i].mfnmap;
+		status = pfn2idx_map_merge(&edp->xen_mfnmap, maps, n);
+		if (status != KDUMP_OK) {
+			for (i = 0; i < n; ++i)
+				pfn2idx_map_free(&parts[i].mfnmap);
+			return set_error(ctx, status,
+					 "Cannot allocate %s map", "MFN");
+		}
+	}
 
 	set_max_pfn(ctx, max_pfn);
-	return status;
-
- err_pfn:
-	p2m.pfn = dump64toh(ctx, ((struct xen_p2m*)fce.data)->pfn);
-	set_error(ctx, status, "Cannot map %s 0x%"PRIx64" -> 0x%"PRIxFAST64,
-		  "PFN", p2m.pfn, pfnrange.idx);
-	fcache_put(&fce);
-	return status;
+	return KDUMP_OK;
 
-err_mfn:
-	p2m.gmfn = dump64toh(ctx, ((struct xen_p2m*)fce.data)->gmfn);
-	set_error(ctx, status, "Cannot map %s 0x%"PRIx64" -> 0x%"PRIxFAST64,
-			 "MFN", p2m.gmfn, mfnrange.idx);
-	fcache_put(&fce);
+ err_alloc:
+	set_error(ctx, status, "Cannot allocate %s map", "PFN");
+ err:
+	for (i = 0; i < n; ++i) {
+		pfn2idx_map_free(&parts[i].pfnmap);
+		pfn2idx_map_free(&parts[i].mfnmap);
+	}
 	return status;
-
- err_read:
-	return set_read_error(ctx, status, "Xen map", pos);
 }
 
 static addrxlat_status
@@ -1521,13 +1740,13 @@ open_common(kdump_ctx_t *ctx)
 			edp->xen_pages_offset = sect->file_offset;
 		else if (!strcmp(name, ".xen_p2m")) {
 			set_xen_xlat(ctx, KDUMP_XEN_NONAUTO);
-			ret = make_xen_pfn_map_nonauto(ctx, sect);
+			ret = make_xen_pfn_map(ctx, sect, true);
 			if (ret != KDUMP_OK)
 				return set_error(ctx, ret,
 						 "Cannot create Xen P2M map");
 		} else if (!strcmp(name, ".xen_pfn")) {
 			set_xen_xlat(ctx, KDUMP_XEN_AUTO);
-			ret = make_xen_pfn_map_auto(ctx, sect);
+			ret = make_xen_pfn_map(ctx, sect, false);
 			if (ret != KDUMP_OK)
 				return set_error(ctx, ret,
 						 "Cannot create Xen PFN map");
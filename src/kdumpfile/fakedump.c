@@ -0,0 +1,199 @@
+/** @internal @file src/kdumpfile/fakedump.c
+ * @brief Fake dump format for unit tests.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "fakedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+unsigned long fake_npages;
+unsigned char fake_version = 1;
+bool fake_zero_even;
+unsigned long fake_nreads;
+
+/** Check whether a page of the fake dump contains only zeros.
+ * @param pfn  Page frame number.
+ * @returns    @c true if all bytes in the page are zero.
+ *
+ * Pages beyond the end of the fake dump are not read by
+ * @ref fake_get_page. If a test provides them in another way,
+ * they must read as zeros.
+ */
+bool
+fake_zero_page(unsigned long pfn)
+{
+	return pfn >= fake_npages || (fake_zero_even && !(pfn % 2));
+}
+
+/** Get the expected content of the fake dump.
+ * @param pfn  Page frame number.
+ * @param off  Offset within the page.
+ * @returns    Byte value at @p off in page @p pfn.
+ */
+unsigned char
+fake_byte(unsigned long pfn, size_t off)
+{
+	return fake_zero_page(pfn) ? 0 : pfn + fake_version + off;
+}
+
+/** Fill a page with a pattern derived from its address and version.
+ * @param pio  Page I/O control.
+ * @returns    Always @c KDUMP_OK.
+ *
+ * This function may be called from multiple threads.
+ */
+kdump_status
+fake_read(struct page_io *pio)
+{
+	unsigned char *p = pio->chunk.data;
+	unsigned long pfn = pio->addr.addr / FAKE_PAGE_SIZE;
+	size_t i, sz = get_page_size(pio->ctx);
+
+	__atomic_fetch_add(&fake_nreads, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < sz; ++i)
+		p[i] = fake_byte(pfn, i);
+	return KDUMP_OK;
+}
+
+kdump_status
+fake_get_page(struct page_io *pio)
+{
+	if (pio->addr.addr >= fake_npages * FAKE_PAGE_SIZE)
+		return set_error(pio->ctx, KDUMP_ERR_NODATA,
+				 "Page not found");
+	return cache_get_page(pio, fake_read);
+}
+
+const struct format_ops fake_ops = {
+	.name = "fake",
+	.get_page = fake_get_page,
+	.put_page = cache_put_page,
+	.realloc_caches = def_realloc_caches,
+};
+
+/** Set up a dump file object with fake format operations.
+ * @param ops     Format operations.
+ * @param npages  Number of pages in the fake dump.
+ * @returns       New dump file object, or @c NULL on failure.
+ */
+kdump_ctx_t *
+fake_dump(const struct format_ops *ops, unsigned long npages)
+{
+	kdump_ctx_t *ctx;
+
+	fake_npages = npages;
+	ctx = kdump_new();
+	if (!ctx) {
+		perror("Cannot allocate kdump context");
+		return NULL;
+	}
+	ctx->shared->ops = ops;
+	if (set_page_size(ctx, FAKE_PAGE_SIZE) != KDUMP_OK) {
+		fprintf(stderr, "Cannot set up fake dump: %s\n",
+			kdump_get_err(ctx));
+		ctx->shared->ops = NULL;
+		kdump_free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+/** Read a page and check its content.
+ * @param ctx  Dump file object.
+ * @param pfn  Page frame number.
+ * @returns    @c TEST_OK on success, @c TEST_FAIL otherwise.
+ *
+ * Pages which contain only zeros must be mapped to the shared
+ * zero page.
+ */
+int
+fake_check_page(kdump_ctx_t *ctx, unsigned long pfn)
+{
+	struct page_io pio;
+	unsigned char *p;
+	size_t i, sz = get_page_size(ctx);
+	kdump_status status;
+	int rc = TEST_OK;
+
+	pio.ctx = ctx;
+	pio.addr.addr = (kdump_addr_t)pfn * FAKE_PAGE_SIZE;
+	pio.addr.as = ADDRXLAT_MACHPHYSADDR;
+	status = get_page(&pio);
+	if (status != KDUMP_OK) {
+		fprintf(stderr, "Cannot read page %lu: %s\n",
+			pfn, kdump_get_err(ctx));
+		return TEST_FAIL;
+	}
+
+	p = pio.chunk.data;
+	for (i = 0; i < sz; ++i)
+		if (p[i] != fake_byte(pfn, i)) {
+			fprintf(stderr, "Page %lu: wrong data at 0x%zx\n",
+				pfn, i);
+			rc = TEST_FAIL;
+			break;
+		}
+	if (fake_zero_page(pfn) && p != ctx->shared->zero_page) {
+		fprintf(stderr, "Page %lu: not the shared zero page\n", pfn);
+		rc = TEST_FAIL;
+	}
+	put_page(&pio);
+	return rc;
+}
+
+/** Read pages and check how many of them were not cached.
+ * @param ctx     Dump file object.
+ * @param what    Description of the check (for error messages).
+ * @param first   First page frame number.
+ * @param n       Number of pages.
+ * @param step    Distance between page frame numbers.
+ * @param expect  Expected number of calls to @ref fake_read.
+ * @returns       @c TEST_OK on success, @c TEST_FAIL otherwise.
+ */
+int
+fake_check_reads(kdump_ctx_t *ctx, const char *what, unsigned long first,
+		 unsigned long n, unsigned long step, unsigned long expect)
+{
+	unsigned long start = fake_nreads;
+	unsigned long i;
+	int rc = TEST_OK;
+
+	for (i = first; i < first + n * step && rc == TEST_OK; i += step)
+		rc = fake_check_page(ctx, i);
+	if (rc == TEST_OK && fake_nreads - start != expect) {
+		fprintf(stderr, "%s: %lu reads (expect %lu)\n",
+			what, fake_nreads - start, expect);
+		rc = TEST_FAIL;
+	}
+	return rc;
+}
@@ -0,0 +1,71 @@
+/** @internal @file src/kdumpfile/fakedump.h
+ * @brief Fake dump format for unit tests.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _FAKEDUMP_H
+#define _FAKEDUMP_H	1
+
+#include "kdumpfile-priv.h"
+
+#define TEST_OK     0
+#define TEST_FAIL   1
+#define TEST_ERR   99
+
+/** Initial page size of the fake dump. */
+#define FAKE_PAGE_SIZE	4096
+
+/** Number of pages in the fake dump. */
+extern unsigned long fake_npages;
+
+/** Content version of the fake dump. */
+extern unsigned char fake_version;
+
+/** Pages with an even PFN contain only zeros if non-zero. */
+extern bool fake_zero_even;
+
+/** Number of calls to @ref fake_read. */
+extern unsigned long fake_nreads;
+
+bool fake_zero_page(unsigned long pfn);
+unsigned char fake_byte(unsigned long pfn, size_t off);
+
+kdump_status fake_read(struct page_io *pio);
+kdump_status fake_get_page(struct page_io *pio);
+
+extern const struct format_ops fake_ops;
+
+kdump_ctx_t *fake_dump(const struct format_ops *ops, unsigned long npages);
+
+int fake_check_page(kdump_ctx_t *ctx, unsigned long pfn);
+int fake_check_reads(kdump_ctx_t *ctx, const char *what, unsigned long first,
+		     unsigned long n, unsigned long step,
+		     unsigned long expect);
+
+#endif	/* fakedump.h */
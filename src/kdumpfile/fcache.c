@@ -33,11 +33,36 @@
 #include "kdumpfile-priv.h"
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
+
+/** Number of consecutive pages which make a linear scan. */
+#define SEQ_SCAN_PAGES	4
+
+/** Maximum number of read blocks in one preadv(2) call. */
+#define MAX_COALESCE	8
+
+/** Read-ahead during a linear scan in bytes. */
+#define READ_AHEAD	(256 * 1024)
+
+/** posix_fadvise(2) and madvise(2) advice for each access pattern. */
+static const struct {
+	int fadvice;		/**< Advice for posix_fadvise(2). */
+	int madvice;		/**< Advice for madvise(2). */
+} advice_map[] = {
+	[KDUMP_ACCESS_NORMAL] = { POSIX_FADV_NORMAL, MADV_NORMAL },
+	[KDUMP_ACCESS_RANDOM] = { POSIX_FADV_RANDOM, MADV_RANDOM },
+	[KDUMP_ACCESS_SEQUENTIAL] = { POSIX_FADV_SEQUENTIAL, MADV_SEQUENTIAL },
+	[KDUMP_ACCESS_WILLNEED] = { POSIX_FADV_WILLNEED, MADV_WILLNEED },
+};
 
 /** Destructor for mmapped cache entries.
  * @param ce  Cache entry.
@@ -55,13 +80,18 @@ unmap_entry(void *data, struct cache_entry *ce)
  * @param fd     File descriptors.
  * @param n      Number of elements in the cache.
  * @param order  Page order of mmap regions.
+ * @param rdblksz  Size of read(2) blocks, or zero for the page size.
  * @returns      File cache object, or @c NULL on allocation failure.
  *
  * The @p fd array need not stay valid after calling this function,
  * because a copy of the array is stored in the file cache.
+ *
+ * The fallback cache gets @ref FCACHE_FB_RESERVE more elements, so
+ * concurrent readers can always get their blocks.
  */
 struct fcache *
-fcache_new(unsigned nfds, const int *fd, unsigned n, unsigned order)
+fcache_new(unsigned nfds, const int *fd, unsigned n, unsigned order,
+	   size_t rdblksz)
 {
 	struct fcache *fc;
 	struct stat st;
@@ -78,20 +108,36 @@ fcache_new(unsigned nfds, const int *fd, unsigned n, unsigned order)
 
 	fc->refcnt = 1;
 	fc->mmap_policy.number = KDUMP_MMAP_TRY;
+	fc->access.number = KDUMP_ACCESS_NORMAL;
+	fc->direct_io.number = 0;
 	fc->pgsz = pgsz;
 	fc->mmapsz = fc->pgsz << order;
+	fc->rdblksz = rdblksz > fc->pgsz ? rdblksz : fc->pgsz;
+	fc->nfds = nfds;
 
-	fc->cache = cache_alloc(n, 0);
+	fc->cache = cache_alloc(n, 0, KDUMP_ARENA_MALLOC);
 	if (!fc->cache)
 		goto err;
 	set_cache_entry_cleanup(fc->cache, unmap_entry, fc);
 
-	fc->fbcache = cache_alloc(n, fc->pgsz);
+	fc->fbcache = cache_alloc(n + FCACHE_FB_RESERVE, fc->rdblksz,
+				  KDUMP_ARENA_MALLOC);
 	if (!fc->fbcache)
 		goto err_cache;
 
+	if (mutex_init(&fc->lock, NULL))
+		goto err_fbcache;
+
 	for (i = 0; i < nfds; ++i) {
+		if (mutex_init(&fc->info[i].lock, NULL))
+			goto err_lock;
 		fc->info[i].fd = fd[i];
+		fc->info[i].stream = NULL;
+		fc->info[i].map = NULL;
+		fc->info[i].dfd = FCACHE_DFD_UNKNOWN;
+		fc->info[i].advice = KDUMP_ACCESS_NORMAL;
+		fc->info[i].seqlru = 0;
+		memset(fc->info[i].seq, 0, sizeof fc->info[i].seq);
 		fc->info[i].filesz = (
 			fstat(fd[i], &st) == 0 && S_ISREG(st.st_mode)
 			? st.st_size
@@ -100,6 +146,12 @@ fcache_new(unsigned nfds, const int *fd, unsigned n, unsigned order)
 
 	return fc;
 
+ err_lock:
+	while (i--)
+		mutex_destroy(&fc->info[i].lock);
+	mutex_destroy(&fc->lock);
+ err_fbcache:
+	cache_free(fc->fbcache);
  err_cache:
 	cache_free(fc->cache);
  err:
@@ -113,17 +165,138 @@ fcache_new(unsigned nfds, const int *fd, unsigned n, unsigned order)
 void
 fcache_free(struct fcache *fc)
 {
+	unsigned i;
+
+	for (i = 0; i < fc->nfds; ++i) {
+		if (fc->info[i].map && fc->info[i].map != MAP_FAILED)
+			munmap(fc->info[i].map, fc->info[i].filesz);
+		if (fc->info[i].dfd >= 0)
+			close(fc->info[i].dfd);
+		if (fc->info[i].stream)
+			flat_stream_free(fc->info[i].stream);
+		mutex_destroy(&fc->info[i].lock);
+	}
+	mutex_destroy(&fc->lock);
 	cache_free(fc->fbcache);
 	cache_free(fc->cache);
 	free(fc);
 }
 
+/** Read a file from a flattened stream.
+ * @param fc    File cache object.
+ * @param fidx  Index of the file.
+ * @param fs    Flattened stream.
+ *
+ * The file descriptor must be the descriptor of the rearranged data
+ * (see @ref flat_stream_fd). Reads then wait until the data is received.
+ * The file cache takes ownership of @p fs.
+ *
+ * The file grows while data is received, so it is never mapped, and
+ * its size is not known.
+ */
+void
+fcache_set_stream(struct fcache *fc, unsigned fidx, struct flat_stream *fs)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+
+	info->stream = fs;
+	info->filesz = ((unsigned long long) ~(off_t)0) >> 1;
+	info->map = MAP_FAILED;
+	info->dfd = FCACHE_DFD_NONE;
+}
+
+/** Get the memory footprint of a file cache.
+ * @param fc  File cache object.
+ * @returns   Memory footprint in bytes, including mmap windows.
+ */
+size_t
+fcache_footprint(const struct fcache *fc)
+{
+	return cache_footprint(fc->cache, fc->mmapsz) +
+		cache_footprint(fc->fbcache, 0);
+}
+
+/** Apply access advice to a file.
+ * @param fc      File cache object.
+ * @param fidx    Index of the file.
+ * @param advice  New access pattern.
+ *
+ * Errors are ignored, because the advice is only a hint.
+ *
+ * The caller must hold the lock of file @p fidx.
+ */
+static void
+apply_advice(struct fcache *fc, unsigned fidx, kdump_access_t advice)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+	void *map;
+
+	/* Whole-file mappings read the advice without a lock. */
+	__atomic_store_n(&info->advice, advice, __ATOMIC_RELAXED);
+	posix_fadvise(info->fd, 0, 0, advice_map[advice].fadvice);
+	map = __atomic_load_n(&info->map, __ATOMIC_ACQUIRE);
+	if (map && map != MAP_FAILED)
+		madvise(map, info->filesz, advice_map[advice].madvice);
+}
+
+/** Track file accesses and update access advice.
+ * @param fc    File cache object.
+ * @param fidx  Index of the file.
+ * @param pos   File position.
+ * @param len   Length of the access.
+ *
+ * If the access pattern is @ref KDUMP_ACCESS_NORMAL, detect linear scans.
+ * Up to two interleaved scans are tracked (e.g. page descriptors and
+ * page data), so a scan of compressed pages is also recognized.
+ *
+ * The stream state is updated under the lock of file @p fidx.
+ */
+static void
+track_access(struct fcache *fc, unsigned fidx, off_t pos, size_t len)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+	kdump_access_t advice =
+		__atomic_load_n(&fc->access.number, __ATOMIC_RELAXED);
+	off_t first = pos / fc->pgsz;
+	off_t last = (pos + len - 1) / fc->pgsz;
+	unsigned i;
+
+	mutex_lock(&info->lock);
+	if (advice == KDUMP_ACCESS_NORMAL) {
+		for (i = 0; i < ARRAY_SIZE(info->seq); ++i)
+			if (first == info->seq[i].lastpg ||
+			    first == info->seq[i].lastpg + 1)
+				break;
+		if (i < ARRAY_SIZE(info->seq)) {
+			if (last > info->seq[i].lastpg &&
+			    info->seq[i].run < SEQ_SCAN_PAGES)
+				info->seq[i].run += last - info->seq[i].lastpg;
+			info->seqlru = !i;
+		} else {
+			i = info->seqlru;
+			info->seq[i].run = 0;
+			info->seqlru = !i;
+		}
+		info->seq[i].lastpg = last;
+
+		for (i = 0; i < ARRAY_SIZE(info->seq); ++i)
+			if (info->seq[i].run >= SEQ_SCAN_PAGES)
+				advice = KDUMP_ACCESS_SEQUENTIAL;
+	}
+
+	if (advice != info->advice)
+		apply_advice(fc, fidx, advice);
+	mutex_unlock(&info->lock);
+}
+
 /** Get file cache content using mmap(2).
  * @param fc   File cache object.
  * @param fce  File cache entry, updated on success.
  * @param fidx Index of the file to read from.
  * @param pos  File position.
  * @returns    Error status.
+ *
+ * The caller must hold the lock of file @p fidx.
  */
 kdump_status
 fcache_get_mmap(struct fcache *fc, struct fcache_entry *fce,
@@ -138,14 +311,22 @@ fcache_get_mmap(struct fcache *fc, struct fcache_entry *fce,
 		return KDUMP_ERR_NODATA;
 
 	blkpos = pos & ~(off_t)(fc->mmapsz - 1);
+	mutex_lock(&fc->lock);
 	ce = cache_get_entry(fc->cache, blkpos | fidx);
+	mutex_unlock(&fc->lock);
 	if (!ce)
 		return KDUMP_ERR_BUSY;
 
 	if (!cache_entry_valid(ce)) {
 		ce->data = mmap(NULL, fc->mmapsz, PROT_READ,
 				MAP_SHARED, fc->info[fidx].fd, blkpos);
+		if (ce->data != MAP_FAILED &&
+		    fc->info[fidx].advice != KDUMP_ACCESS_NORMAL)
+			madvise(ce->data, fc->mmapsz,
+				advice_map[fc->info[fidx].advice].madvice);
+		mutex_lock(&fc->lock);
 		cache_insert(fc->cache, ce);
+		mutex_unlock(&fc->lock);
 	}
 
 	if (ce->data == MAP_FAILED)
@@ -159,75 +340,366 @@ fcache_get_mmap(struct fcache *fc, struct fcache_entry *fce,
 	return KDUMP_OK;
 }
 
+/** Get the direct I/O descriptor of a file.
+ * @param fc   File cache object.
+ * @param fidx Index of the file.
+ * @returns    Descriptor opened with @c O_DIRECT, or a negative number
+ *             if direct I/O is not used for this file.
+ *
+ * The file is re-opened through @c /proc/self/fd, so the flags of the
+ * descriptor which was passed to the library are not changed. Only
+ * regular files are opened for direct I/O.
+ */
+static int
+direct_fd(struct fcache *fc, unsigned fidx)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+	char path[sizeof("/proc/self/fd/") + 3 * sizeof(int)];
+	struct stat st;
+
+	if (!fc->direct_io.number)
+		return FCACHE_DFD_NONE;
+	if (info->dfd != FCACHE_DFD_UNKNOWN)
+		return info->dfd;
+
+	info->dfd = FCACHE_DFD_NONE;
+	if (fstat(info->fd, &st) || !S_ISREG(st.st_mode))
+		return info->dfd;
+	sprintf(path, "/proc/self/fd/%d", info->fd);
+	info->dfd = open(path, O_RDONLY | O_DIRECT);
+	if (info->dfd < 0)
+		info->dfd = FCACHE_DFD_NONE;
+	return info->dfd;
+}
+
+/** Stop using direct I/O for a file.
+ * @param fc   File cache object.
+ * @param fidx Index of the file.
+ */
+static void
+drop_direct_fd(struct fcache *fc, unsigned fidx)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+
+	if (info->dfd >= 0)
+		close(info->dfd);
+	info->dfd = FCACHE_DFD_NONE;
+}
+
+/** Read blocks into the fallback cache.
+ * @param fc       File cache object.
+ * @param fidx     Index of the file to read from.
+ * @param blkpos   File position of the first block.
+ * @param first    Cache entry for the first block.
+ * @param nblocks  Desired number of blocks.
+ * @returns        Error status.
+ *
+ * The first block is always read. Following blocks are read only while
+ * they are missing from the cache, and all of them are read with a single
+ * preadv(2) call. On success, @p first is valid and the caller still
+ * holds a reference to it. On failure, the reference is dropped.
+ *
+ * Following blocks are not read if that would leave fewer than
+ * @ref FCACHE_FB_RESERVE entries for other readers.
+ *
+ * The caller must hold the lock of file @p fidx.
+ */
+static kdump_status
+read_blocks(struct fcache *fc, unsigned fidx, off_t blkpos,
+	    struct cache_entry *first, unsigned nblocks)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+	struct cache_entry *ce[MAX_COALESCE];
+	struct iovec iov[MAX_COALESCE];
+	unsigned n, i;
+	ssize_t rd;
+	int dfd;
+
+	if (nblocks > MAX_COALESCE)
+		nblocks = MAX_COALESCE;
+
+	ce[0] = first;
+	mutex_lock(&fc->lock);
+	for (n = 1; n < nblocks; ++n) {
+		off_t pos = blkpos + (off_t)n * fc->rdblksz;
+		if (pos >= info->filesz ||
+		    cache_idle(fc->fbcache) <= FCACHE_FB_RESERVE)
+			break;
+		ce[n] = cache_get_entry(fc->fbcache, pos | fidx);
+		if (!ce[n])
+			break;
+		if (cache_entry_valid(ce[n])) {
+			cache_put_entry(fc->fbcache, ce[n]);
+			break;
+		}
+	}
+	mutex_unlock(&fc->lock);
+
+	if (info->stream) {
+		kdump_status status;
+
+		status = flat_stream_wait(info->stream, blkpos,
+					  n * fc->rdblksz);
+		if (status != KDUMP_OK) {
+			mutex_lock(&fc->lock);
+			for (i = 0; i < n; ++i)
+				cache_discard(fc->fbcache, ce[i]);
+			mutex_unlock(&fc->lock);
+			return status;
+		}
+	}
+
+	for (i = 0; i < n; ++i) {
+		iov[i].iov_base = ce[i]->data;
+		iov[i].iov_len = fc->rdblksz;
+	}
+	rd = -1;
+	dfd = direct_fd(fc, fidx);
+	if (dfd >= 0) {
+		rd = preadv(dfd, iov, n, blkpos);
+		/* The file system may not support direct I/O. */
+		if (rd < 0 && errno == EINVAL) {
+			drop_direct_fd(fc, fidx);
+			dfd = FCACHE_DFD_NONE;
+		}
+	}
+	if (dfd < 0)
+		rd = preadv(info->fd, iov, n, blkpos);
+	if (rd < 0) {
+		mutex_lock(&fc->lock);
+		for (i = 0; i < n; ++i)
+			cache_discard(fc->fbcache, ce[i]);
+		mutex_unlock(&fc->lock);
+		return KDUMP_ERR_SYSTEM;
+	}
+
+	for (i = 0; i < n; ++i) {
+		size_t got = (rd < fc->rdblksz) ? rd : fc->rdblksz;
+		if (got < fc->rdblksz)
+			memset(ce[i]->data + got, 0, fc->rdblksz - got);
+		rd -= got;
+	}
+	mutex_lock(&fc->lock);
+	for (i = 0; i < n; ++i) {
+		cache_insert(fc->fbcache, ce[i]);
+		if (i)
+			cache_put_entry(fc->fbcache, ce[i]);
+	}
+	mutex_unlock(&fc->lock);
+	return KDUMP_OK;
+}
+
 /** Get file cache content using read(2).
  * @param fc   File cache object.
  * @param fce  File cache entry, updated on success.
  * @param fidx Index of the file to read from.
  * @param pos  File position.
+ * @param len  Number of bytes which will be needed.
  * @returns    Error status.
+ *
+ * If the block at @p pos is not cached, all missing blocks up to
+ * @c pos+len are read at once. During a linear scan, more blocks are
+ * read ahead.
+ *
+ * The caller must hold the lock of file @p fidx.
  */
-kdump_status
+static kdump_status
 fcache_get_read(struct fcache *fc, struct fcache_entry *fce,
-		unsigned fidx, off_t pos)
+		unsigned fidx, off_t pos, size_t len)
 {
 	struct cache_entry *ce;
 	off_t blkpos;
 	size_t off;
 
-	blkpos = pos & ~(off_t)(fc->pgsz - 1);
+	blkpos = pos & ~(off_t)(fc->rdblksz - 1);
+	mutex_lock(&fc->lock);
 	ce = cache_get_entry(fc->fbcache, blkpos | fidx);
+	mutex_unlock(&fc->lock);
 	if (!ce)
 		return KDUMP_ERR_BUSY;
 
 	if (!cache_entry_valid(ce)) {
-		ssize_t rd = pread(fc->info[fidx].fd,
-				   ce->data, fc->pgsz, blkpos);
-		if (rd < 0) {
-			cache_discard(fc->fbcache, ce);
-			return KDUMP_ERR_SYSTEM;
-		}
-		if (rd < fc->pgsz)
-			memset(ce->data + rd, 0, fc->pgsz - rd);
-		cache_insert(fc->fbcache, ce);
+		size_t want = pos - blkpos + len;
+		kdump_status status;
+
+		/* Do not wait for data which has not been requested. */
+		if (fc->info[fidx].advice == KDUMP_ACCESS_SEQUENTIAL &&
+		    !fc->info[fidx].stream && want < READ_AHEAD)
+			want = READ_AHEAD;
+		status = read_blocks(fc, fidx, blkpos, ce,
+				     (want - 1) / fc->rdblksz + 1);
+		if (status != KDUMP_OK)
+			return status;
 	}
 
 	fce->ce = ce;
-	off = pos & (fc->pgsz - 1);
-	fce->len = fc->pgsz - off;
+	off = pos & (fc->rdblksz - 1);
+	fce->len = fc->rdblksz - off;
 	fce->data = ce->data + off;
 	fce->cache = fc->fbcache;
 	return KDUMP_OK;
 }
 
-/** Get file cache content.
+/** Map a whole file.
+ * @param fc   File cache object.
+ * @param fidx Index of the file to map.
+ * @returns    Mapping of the file, or @c MAP_FAILED.
+ *
+ * The result is stored in the file information, so each file is mapped
+ * at most once. This function does not need a lock. If two threads map
+ * the same file concurrently, the loser unmaps its own mapping.
+ */
+static void *
+map_whole(struct fcache *fc, unsigned fidx)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+	void *map, *expect;
+	struct stat st;
+
+	if (fstat(info->fd, &st) || !S_ISREG(st.st_mode) ||
+	    st.st_size != info->filesz || !st.st_size ||
+	    (unsigned long long) st.st_size > SIZE_MAX)
+		map = MAP_FAILED;
+	else
+		map = mmap(NULL, st.st_size, PROT_READ,
+			   MAP_SHARED, info->fd, 0);
+
+	expect = NULL;
+	if (!__atomic_compare_exchange_n(&info->map, &expect, map, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		if (map != MAP_FAILED)
+			munmap(map, st.st_size);
+		map = expect;
+	} else if (map != MAP_FAILED) {
+		kdump_access_t advice =
+			__atomic_load_n(&info->advice, __ATOMIC_RELAXED);
+		if (advice != KDUMP_ACCESS_NORMAL)
+			madvise(map, st.st_size, advice_map[advice].madvice);
+	}
+	return map;
+}
+
+/** Get the whole-file mapping of a file.
+ * @param fc   File cache object.
+ * @param fidx Index of the file.
+ * @returns    Mapping of the file, or @c NULL if the file cannot be
+ *             mapped at once or if whole-file mapping is not used.
+ */
+static inline void *
+whole_map(struct fcache *fc, unsigned fidx)
+{
+	void *map;
+
+	if (__atomic_load_n(&fc->mmap_policy.number, __ATOMIC_RELAXED)
+	    != KDUMP_MMAP_WHOLE ||
+	    fc->direct_io.number)
+		return NULL;
+	map = __atomic_load_n(&fc->info[fidx].map, __ATOMIC_ACQUIRE);
+	if (!map)
+		map = map_whole(fc, fidx);
+	return map != MAP_FAILED ? map : NULL;
+}
+
+/** Get file cache content for a range with the file lock held.
  * @param fc   File cache object.
  * @param fce  File cache entry, updated on success.
  * @param fidx Index of the file to read from.
  * @param pos  File position.
+ * @param len  Number of bytes which will be needed.
  * @returns    Error status.
  */
-kdump_status
-fcache_get(struct fcache *fc, struct fcache_entry *fce,
-	   unsigned fidx, off_t pos)
+static kdump_status
+get_entry_locked(struct fcache *fc, struct fcache_entry *fce,
+	  unsigned fidx, off_t pos, size_t len)
 {
-	kdump_mmap_policy_t policy = fc->mmap_policy.number;
+	kdump_mmap_policy_t policy =
+		__atomic_load_n(&fc->mmap_policy.number, __ATOMIC_RELAXED);
 	kdump_status status;
 
+	/* Mapped files would be cached by the kernel. */
+	if (direct_fd(fc, fidx) >= 0)
+		return fcache_get_read(fc, fce, fidx, pos, len);
+
+	/* If the file is not mapped as a whole, or past EOF, use windows.
+	 * The windowed path pads the last page with zeros.
+	 */
+	if (policy == KDUMP_MMAP_WHOLE)
+		policy = KDUMP_MMAP_TRY;
+
+	/* Streamed files grow, so mapping them is not safe. */
+	if (fc->info[fidx].stream)
+		policy = KDUMP_MMAP_NEVER;
+
 	if (policy != KDUMP_MMAP_NEVER) {
 		status = fcache_get_mmap(fc, fce, fidx, pos);
 
-		if (policy == KDUMP_MMAP_TRY_ONCE)
-			fc->mmap_policy.number =
+		/* Only the first attempt from any file decides. */
+		if (policy == KDUMP_MMAP_TRY_ONCE) {
+			kdump_num_t expect = KDUMP_MMAP_TRY_ONCE;
+			__atomic_compare_exchange_n(
+				&fc->mmap_policy.number, &expect,
 				(status == KDUMP_OK
 				 ? KDUMP_MMAP_ALWAYS
-				 : KDUMP_MMAP_NEVER);
+				 : KDUMP_MMAP_NEVER),
+				false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		}
 
 		if (status == KDUMP_OK ||
 		    policy == KDUMP_MMAP_ALWAYS)
 			return status;
 	}
 
-	return fcache_get_read(fc, fce, fidx, pos);
+	return fcache_get_read(fc, fce, fidx, pos, len);
+}
+
+/** Get file cache content for a range.
+ * @param fc   File cache object.
+ * @param fce  File cache entry, updated on success.
+ * @param fidx Index of the file to read from.
+ * @param pos  File position.
+ * @param len  Number of bytes which will be needed.
+ * @returns    Error status.
+ *
+ * Like @ref fcache_get, but @p len allows to read all missing blocks
+ * at once. The returned entry may still be shorter than @p len.
+ */
+static kdump_status
+get_entry(struct fcache *fc, struct fcache_entry *fce,
+	  unsigned fidx, off_t pos, size_t len)
+{
+	struct fcache_fileinfo *info = &fc->info[fidx];
+	kdump_status status;
+	void *map;
+
+	/* Whole-file mappings need no cache entry and no lock. */
+	map = whole_map(fc, fidx);
+	if (map && pos < info->filesz) {
+		fce->data = map + pos;
+		fce->len = info->filesz - pos;
+		fce->ce = NULL;
+		fce->cache = NULL;
+		return KDUMP_OK;
+	}
+
+	mutex_lock(&info->lock);
+	status = get_entry_locked(fc, fce, fidx, pos, len);
+	mutex_unlock(&info->lock);
+	return status;
+}
+
+/** Get file cache content.
+ * @param fc   File cache object.
+ * @param fce  File cache entry, updated on success.
+ * @param fidx Index of the file to read from.
+ * @param pos  File position.
+ * @returns    Error status.
+ */
+kdump_status
+fcache_get(struct fcache *fc, struct fcache_entry *fce,
+	   unsigned fidx, off_t pos)
+{
+	track_access(fc, fidx, pos, 1);
+	return get_entry(fc, fce, fidx, pos, 1);
 }
 
 /** Get file cache content with a fallback buffer.
@@ -264,17 +736,20 @@ fcache_get_fb(struct fcache *fc, struct fcache_entry *fce,
 	return ret;
 }
 
-/** Read file cache content into a pre-allocated buffer.
+/** Copy file cache content into a buffer.
  * @param fc   File cache object.
  * @param buf  Target buffer.
+ * @param len  Length of data.
  * @param fidx Index of the file to read from.
  * @param pos  File position.
- * @param len  Length of data.
  * @returns    Error status.
+ *
+ * Unlike @ref fcache_pread, this function does not track the access
+ * pattern, so it can be used by callers which have already done so.
  */
-kdump_status
-fcache_pread(struct fcache *fc, void *buf, size_t len,
-	     unsigned fidx, off_t pos)
+static kdump_status
+copy_range(struct fcache *fc, void *buf, size_t len,
+	   unsigned fidx, off_t pos)
 {
 	struct fcache_entry fce;
 	kdump_status ret;
@@ -282,7 +757,7 @@ fcache_pread(struct fcache *fc, void *buf, size_t len,
 	while (len) {
 		size_t partlen;
 
-		ret = fcache_get(fc, &fce, fidx, pos);
+		ret = get_entry(fc, &fce, fidx, pos, len);
 		if (ret != KDUMP_OK)
 			return ret;
 
@@ -298,6 +773,23 @@ fcache_pread(struct fcache *fc, void *buf, size_t len,
 	return KDUMP_OK;
 }
 
+/** Read file cache content into a pre-allocated buffer.
+ * @param fc   File cache object.
+ * @param buf  Target buffer.
+ * @param fidx Index of the file to read from.
+ * @param pos  File position.
+ * @param len  Length of data.
+ * @returns    Error status.
+ */
+kdump_status
+fcache_pread(struct fcache *fc, void *buf, size_t len,
+	     unsigned fidx, off_t pos)
+{
+	if (len)
+		track_access(fc, fidx, pos, len);
+	return copy_range(fc, buf, len, fidx, pos);
+}
+
 /** Put an array of file cache entries.
  * @param fces  Array of file cache entries.
  * @param n     Number of entries in the array.
@@ -339,6 +831,25 @@ copy_data(void *data, struct fcache_entry *fces, size_t n)
 	return data;
 }
 
+/** Point a chunk at data which is not owned by the chunk.
+ * @param fch   File cache chunk.
+ * @param data  Chunk data.
+ * @param len   Length of data.
+ *
+ * The chunk holds no cache references, and @ref fcache_put_chunk does
+ * not free @p data.
+ */
+static inline void
+set_borrowed_chunk(struct fcache_chunk *fch, void *data, size_t len)
+{
+	fch->data = data;
+	fch->nent = 1;
+	fch->embed_fces->data = data;
+	fch->embed_fces->len = len;
+	fch->embed_fces->ce = NULL;
+	fch->embed_fces->cache = NULL;
+}
+
 /** Get a contiguous data chunk using a file cache.
  * @param fc   File cache.
  * @param fch  File cache chunk, updated on success.
@@ -354,7 +865,7 @@ fcache_get_chunk(struct fcache *fc, struct fcache_chunk *fch,
 	off_t first, last;
 	struct fcache_entry fce;
 	struct fcache_entry *fces, *curfce;
-	void *data, *curdata;
+	void *data, *curdata, *map;
 	size_t remain;
 	size_t nent;
 	kdump_status status;
@@ -365,6 +876,13 @@ fcache_get_chunk(struct fcache *fc, struct fcache_chunk *fch,
 		return KDUMP_OK;
 	}
 
+	track_access(fc, fidx, pos, len);
+	map = whole_map(fc, fidx);
+	if (map && pos + len <= fc->info[fidx].filesz) {
+		set_borrowed_chunk(fch, map + pos, len);
+		return KDUMP_OK;
+	}
+
 	first = pos & ~(off_t)(fc->pgsz - 1);
 	last = (pos + len - 1) & ~(off_t)(fc->pgsz - 1);
 	nent = (last - first) / fc->pgsz + 1;
@@ -382,7 +900,7 @@ fcache_get_chunk(struct fcache *fc, struct fcache_chunk *fch,
 	data = NULL;
 	remain = len;
 	while (remain) {
-		status = fcache_get(fc, curfce, fidx, pos);
+		status = get_entry(fc, curfce, fidx, pos, remain);
 		if (status != KDUMP_OK) {
 			put_fces(curfce - nent, nent);
 			if (fces)
@@ -443,6 +961,58 @@ fcache_get_chunk(struct fcache *fc, struct fcache_chunk *fch,
 	return KDUMP_OK;
 }
 
+/** Get a contiguous data chunk using a file cache and a bounce buffer.
+ * @param fc   File cache.
+ * @param fch  File cache chunk, updated on success.
+ * @param len  Length of data.
+ * @param fidx Index of the file to read from.
+ * @param pos  File position.
+ * @param buf  Bounce buffer of at least @p len bytes.
+ * @returns    Error status.
+ *
+ * This function works like @ref fcache_get_chunk, but if the data is
+ * not contiguous in the cache, it is copied into @p buf instead of a
+ * newly allocated buffer, so it never allocates any memory. The caller
+ * must not reuse @p buf until the chunk is put back.
+ */
+kdump_status
+fcache_get_chunk_buf(struct fcache *fc, struct fcache_chunk *fch,
+		     size_t len, unsigned fidx, off_t pos, void *buf)
+{
+	void *map;
+	kdump_status status;
+
+	if (!len) {
+		fch->data = NULL;
+		fch->nent = 0;
+		return KDUMP_OK;
+	}
+
+	track_access(fc, fidx, pos, len);
+	map = whole_map(fc, fidx);
+	if (map && pos + len <= fc->info[fidx].filesz) {
+		set_borrowed_chunk(fch, map + pos, len);
+		return KDUMP_OK;
+	}
+
+	status = get_entry(fc, fch->embed_fces, fidx, pos, len);
+	if (status != KDUMP_OK)
+		return status;
+	if (fch->embed_fces->len >= len) {
+		fch->embed_fces->len = len;
+		fch->data = fch->embed_fces->data;
+		fch->nent = 1;
+		return KDUMP_OK;
+	}
+	fcache_put(fch->embed_fces);
+
+	status = copy_range(fc, buf, len, fidx, pos);
+	if (status != KDUMP_OK)
+		return status;
+	set_borrowed_chunk(fch, buf, len);
+	return KDUMP_OK;
+}
+
 /** Return a no longer needed file cache chunk.
  * @param fch  File cache chunk.
  */
@@ -33,6 +33,11 @@
 #include "kdumpfile-priv.h"
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define MDF_SIGNATURE		"makedumpfile"
 #define MDF_SIG_LEN		16
@@ -57,6 +62,9 @@ struct makedumpfile_data_header {
 
 #define ALLOC_INC	32
 
+/** Size of the copy buffer of a flattened stream. */
+#define STREAM_BUF_SIZE	(64 * 1024)
+
 /** Initialize flattened dump maps for one file.
  * @param fmap  Flattened format mapping to be initialized.
  * @param ctx   Dump file object.
@@ -293,13 +301,16 @@ flatmap_pread_flat(struct flattened_map *map, void *buf, size_t len,
  * @param len   Length of data.
  * @param fidx  Index of the file to read from.
  * @param pos   File position.
+ * @param buf   Bounce buffer of at least @p len bytes, or @c NULL.
  * @returns     Error status.
  *
- * Get a contiguous data chunk from a flattened dump file.
+ * Get a contiguous data chunk from a flattened dump file. If the data
+ * is split between multiple flattened segments, it is copied to @p buf,
+ * or to a newly allocated buffer if @p buf is @c NULL.
  */
 kdump_status
 flatmap_get_chunk_flat(struct flattened_map *map, struct fcache_chunk *fch,
-		       size_t len, unsigned fidx, off_t pos)
+		       size_t len, unsigned fidx, off_t pos, void *buf)
 {
 	struct flattened_file_map *fmap = &map->fmap[fidx];
 	const addrxlat_range_t *range, *end;
@@ -311,7 +322,20 @@ flatmap_get_chunk_flat(struct flattened_map *map, struct fcache_chunk *fch,
 		off -= range->endoff + 1;
 	if (len <= range->endoff + 1 - off) {
 		pos += fmap->offs[range->meth];
-		return fcache_get_chunk(map->fcache, fch, len, fidx, pos);
+		return buf
+			? fcache_get_chunk_buf(map->fcache, fch, len,
+					       fidx, pos, buf)
+			: fcache_get_chunk(map->fcache, fch, len, fidx, pos);
+	}
+
+	if (buf) {
+		fch->data = buf;
+		fch->nent = 1;
+		fch->embed_fces->data = buf;
+		fch->embed_fces->len = len;
+		fch->embed_fces->ce = NULL;
+		fch->embed_fces->cache = NULL;
+		return flatmap_pread(map, buf, len, fidx, pos);
 	}
 
 	fch->data = malloc(len);
@@ -320,3 +344,448 @@ flatmap_get_chunk_flat(struct flattened_map *map, struct fcache_chunk *fch,
 	fch->nent = 0;
 	return flatmap_pread(map, fch->data, len, fidx, pos);
 }
+
+/** Range of received data in a flattened stream. */
+struct flat_extent {
+	off_t start;		/**< First received byte. */
+	off_t end;		/**< One past the last received byte. */
+};
+
+/** Flattened dump file which is read from a non-seekable descriptor.
+ *
+ * The stream is consumed in one pass, and segment data is written to
+ * its rearranged position in a temporary file. Only the copy buffer and
+ * the list of received ranges are kept in memory. Adjacent ranges are
+ * merged, so the list stays short, because makedumpfile writes most of
+ * the data in order.
+ */
+struct flat_stream {
+	int fd;			/**< Input stream. */
+	int spillfd;		/**< Temporary file with rearranged data. */
+
+	mutex_t lock;		/**< Guard the fields below. */
+	cond_t cond;		/**< Signalled when more data is received. */
+
+	struct flat_extent *ext; /**< Received ranges, sorted by offset. */
+	size_t next;		/**< Number of elements in @c ext. */
+	size_t allocext;	/**< Allocated elements in @c ext. */
+
+	bool done;		/**< No more data will be received. */
+	kdump_status status;	/**< Error status if the stream failed. */
+
+#if USE_PTHREAD
+	pthread_t tid;		/**< Thread which consumes the stream. */
+	bool started;		/**< Non-zero if @c tid is valid. */
+	bool cancel;		/**< Consumer may be cancelled. */
+#endif
+};
+
+/** Find the first received range which ends at or after an offset.
+ * @param fs   Flattened stream.
+ * @param pos  File offset.
+ * @returns    Index of the range, or @c fs->next if there is none.
+ */
+static size_t
+find_extent(const struct flat_stream *fs, off_t pos)
+{
+	size_t lo = 0, hi = fs->next;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (fs->ext[mid].end < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/** Add a range to the received data.
+ * @param fs     Flattened stream.
+ * @param start  First received byte.
+ * @param end    One past the last received byte.
+ * @returns      Zero on success, -1 if out of memory.
+ *
+ * The caller must hold the stream lock.
+ */
+static int
+add_extent(struct flat_stream *fs, off_t start, off_t end)
+{
+	size_t first, last;
+
+	first = find_extent(fs, start);
+	for (last = first; last < fs->next && fs->ext[last].start <= end;
+	     ++last) {
+		if (fs->ext[last].start < start)
+			start = fs->ext[last].start;
+		if (fs->ext[last].end > end)
+			end = fs->ext[last].end;
+	}
+
+	if (last == first) {
+		if (fs->next == fs->allocext) {
+			size_t newalloc = fs->allocext + ALLOC_INC;
+			struct flat_extent *newext;
+
+			newext = realloc(fs->ext, newalloc * sizeof(*newext));
+			if (!newext)
+				return -1;
+			fs->ext = newext;
+			fs->allocext = newalloc;
+		}
+		memmove(&fs->ext[first + 1], &fs->ext[first],
+			(fs->next - first) * sizeof(*fs->ext));
+		++fs->next;
+		++last;
+	} else if (last > first + 1) {
+		memmove(&fs->ext[first + 1], &fs->ext[last],
+			(fs->next - last) * sizeof(*fs->ext));
+		fs->next -= last - first - 1;
+	}
+
+	fs->ext[first].start = start;
+	fs->ext[first].end = end;
+	return 0;
+}
+
+/** Read exactly the requested number of bytes from a stream.
+ * @param fd   Input stream.
+ * @param buf  Target buffer.
+ * @param len  Number of bytes.
+ * @returns    Number of bytes read (less than @p len only at end of
+ *             stream), or -1 on error.
+ */
+static ssize_t
+read_full(int fd, void *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t rd = read(fd, buf + done, len - done);
+		if (rd < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!rd)
+			break;
+		done += rd;
+	}
+	return done;
+}
+
+/** Read input of a flattened stream.
+ * @param fs   Flattened stream.
+ * @param buf  Target buffer.
+ * @param len  Number of bytes.
+ * @returns    Same as @ref read_full.
+ *
+ * The consumer thread runs with cancellation disabled (see
+ * @ref stream_thread). It is enabled only here, so the thread can
+ * be cancelled while it is waiting for data, but not while it writes
+ * the temporary file or holds the stream lock.
+ */
+static ssize_t
+read_stream(struct flat_stream *fs, void *buf, size_t len)
+{
+#if USE_PTHREAD
+	if (fs->cancel) {
+		ssize_t rd;
+
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+		rd = read_full(fs->fd, buf, len);
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		return rd;
+	}
+#endif
+	return read_full(fs->fd, buf, len);
+}
+
+/** Copy one flattened segment to the temporary file.
+ * @param fs   Flattened stream.
+ * @param buf  Copy buffer of @ref STREAM_BUF_SIZE bytes.
+ * @param pos  Rearranged file offset.
+ * @param size Segment size.
+ * @returns    Error status.
+ */
+static kdump_status
+copy_segment(struct flat_stream *fs, void *buf, off_t pos, int64_t size)
+{
+	while (size) {
+		size_t len = size < STREAM_BUF_SIZE ? size : STREAM_BUF_SIZE;
+		ssize_t rd, wr;
+		int ret;
+
+		rd = read_stream(fs, buf, len);
+		if (rd < 0)
+			return KDUMP_ERR_SYSTEM;
+		if (rd != len)
+			return KDUMP_ERR_CORRUPT;
+
+		wr = pwrite(fs->spillfd, buf, len, pos);
+		if (wr != len)
+			return KDUMP_ERR_SYSTEM;
+
+		mutex_lock(&fs->lock);
+		ret = add_extent(fs, pos, pos + len);
+		cond_broadcast(&fs->cond);
+		mutex_unlock(&fs->lock);
+		if (ret)
+			return KDUMP_ERR_SYSTEM;
+
+		pos += len;
+		size -= len;
+	}
+	return KDUMP_OK;
+}
+
+/** Consume a flattened stream.
+ * @param arg  Flattened stream.
+ * @returns    Always @c NULL.
+ *
+ * Read segments until the end marker, and write them to the temporary
+ * file. When finished, record the result and wake up all waiters.
+ */
+static void *
+consume_stream(void *arg)
+{
+	struct flat_stream *fs = arg;
+	struct makedumpfile_data_header hdr;
+	kdump_status status;
+	int64_t pos, size;
+	void *buf;
+
+	buf = malloc(STREAM_BUF_SIZE);
+	status = buf ? KDUMP_OK : KDUMP_ERR_SYSTEM;
+#if USE_PTHREAD
+	pthread_cleanup_push(free, buf);
+#endif
+	while (status == KDUMP_OK) {
+		ssize_t rd = read_stream(fs, &hdr, sizeof hdr);
+		if (rd != sizeof hdr) {
+			status = rd < 0 ? KDUMP_ERR_SYSTEM : KDUMP_ERR_CORRUPT;
+			break;
+		}
+
+		pos = be64toh(hdr.offset);
+		if (pos == MDF_OFFSET_END_FLAG)
+			break;
+		size = be64toh(hdr.buf_size);
+		if (pos < 0 || size <= 0)
+			status = KDUMP_ERR_CORRUPT;
+		else
+			status = copy_segment(fs, buf, pos, size);
+	}
+#if USE_PTHREAD
+	pthread_cleanup_pop(0);
+#endif
+	free(buf);
+
+	mutex_lock(&fs->lock);
+	fs->status = status;
+	fs->done = true;
+	cond_broadcast(&fs->cond);
+	mutex_unlock(&fs->lock);
+	return NULL;
+}
+
+#if USE_PTHREAD
+/** Consume a flattened stream in a separate thread.
+ * @param arg  Flattened stream.
+ * @returns    Always @c NULL.
+ *
+ * The thread may be cancelled by @ref flat_stream_free, but only
+ * while it is waiting for input (see @ref read_stream).
+ */
+static void *
+stream_thread(void *arg)
+{
+	struct flat_stream *fs = arg;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	fs->cancel = true;
+	return consume_stream(fs);
+}
+#endif
+
+/** Create a temporary file for a flattened stream.
+ * @returns  Open file descriptor, or -1 on failure.
+ *
+ * The file is created in @c TMPDIR (or @c /tmp) and it is unlinked
+ * immediately, so it is removed when it is closed.
+ */
+static int
+open_spill_file(void)
+{
+	const char *dir = getenv("TMPDIR");
+	char *path;
+	int fd;
+
+	if (!dir || !*dir)
+		dir = "/tmp";
+
+#ifdef O_TMPFILE
+	fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+	if (fd >= 0)
+		return fd;
+#endif
+
+	if (asprintf(&path, "%s/kdumpfile.XXXXXX", dir) < 0)
+		return -1;
+	fd = mkstemp(path);
+	if (fd >= 0)
+		unlink(path);
+	free(path);
+	return fd;
+}
+
+/** Free a flattened stream.
+ * @param fs  Flattened stream.
+ *
+ * If the stream is still being consumed, the consumer is cancelled.
+ */
+void
+flat_stream_free(struct flat_stream *fs)
+{
+#if USE_PTHREAD
+	if (fs->started) {
+		pthread_cancel(fs->tid);
+		pthread_join(fs->tid, NULL);
+	}
+#endif
+	cond_destroy(&fs->cond);
+	mutex_destroy(&fs->lock);
+	if (fs->spillfd >= 0)
+		close(fs->spillfd);
+	free(fs->ext);
+	free(fs);
+}
+
+/** Start reading a flattened dump file from a non-seekable descriptor.
+ * @param ctx      Dump file object.
+ * @param fidx     File index (used in error messages).
+ * @param fd       Input file descriptor.
+ * @param pstream  Set to the new stream, or @c NULL if @p fd is seekable.
+ * @returns        Error status.
+ *
+ * If @p fd is seekable, do nothing. Otherwise, the input must be in the
+ * flattened format. The flattened header is checked, and the rest of the
+ * input is consumed by a separate thread (or before returning if there
+ * is no thread support). Rearranged data can then be read from
+ * @c spillfd of the stream as soon as it is received; use
+ * @ref flat_stream_wait to wait for it.
+ *
+ * A stream can be read only once, so the dump file cannot be re-opened.
+ */
+kdump_status
+flat_stream_open(kdump_ctx_t *ctx, unsigned fidx, int fd,
+		 struct flat_stream **pstream)
+{
+	static const char magic[MDF_SIG_LEN] = MDF_SIGNATURE;
+
+	struct makedumpfile_header hdr;
+	struct flat_stream *fs;
+	char buf[MDF_HEADER_SIZE];
+	kdump_status status;
+
+	*pstream = NULL;
+	if (lseek(fd, 0, SEEK_CUR) != (off_t)-1 || errno != ESPIPE)
+		return KDUMP_OK;
+
+	if (read_full(fd, buf, sizeof buf) != sizeof buf)
+		return set_error(ctx, KDUMP_ERR_SYSTEM, "Cannot read %s",
+				 err_filename(ctx, fidx));
+	memcpy(&hdr, buf, sizeof hdr);
+	if (memcmp(hdr.signature, magic, sizeof magic))
+		return set_error(ctx, KDUMP_ERR_NOTIMPL,
+				 "%s is not seekable and not flattened",
+				 err_filename(ctx, fidx));
+	if (be64toh(hdr.type) != MDF_TYPE_FLAT_HEADER)
+		return err_notimpl(ctx, "type", be64toh(hdr.type));
+	if (be64toh(hdr.version) != MDF_VERSION_FLAT_HEADER)
+		return err_notimpl(ctx, "version", be64toh(hdr.version));
+
+	fs = calloc(1, sizeof *fs);
+	if (!fs)
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate %s", "flattened stream");
+	fs->fd = fd;
+	fs->spillfd = open_spill_file();
+	if (fs->spillfd < 0) {
+		status = set_error(ctx, KDUMP_ERR_SYSTEM,
+				   "Cannot create temporary file for %s",
+				   err_filename(ctx, fidx));
+		goto err_free;
+	}
+	if (mutex_init(&fs->lock, NULL)) {
+		status = set_error(ctx, KDUMP_ERR_SYSTEM,
+				   "Cannot initialize %s", "stream lock");
+		goto err_close;
+	}
+	if (cond_init(&fs->cond, NULL)) {
+		status = set_error(ctx, KDUMP_ERR_SYSTEM,
+				   "Cannot initialize %s", "stream condition");
+		goto err_mutex;
+	}
+
+#if USE_PTHREAD
+	if (!pthread_create(&fs->tid, NULL, stream_thread, fs))
+		fs->started = true;
+	else
+#endif
+		consume_stream(fs);
+
+	*pstream = fs;
+	return KDUMP_OK;
+
+ err_mutex:
+	mutex_destroy(&fs->lock);
+ err_close:
+	close(fs->spillfd);
+ err_free:
+	free(fs);
+	return status;
+}
+
+/** Wait until a range of a flattened stream is received.
+ * @param fs   Flattened stream.
+ * @param pos  Rearranged file offset.
+ * @param len  Length of the range.
+ * @returns    Error status.
+ *
+ * Return as soon as the whole range can be read from @c spillfd. After
+ * the end marker is received, parts of the range which were not received
+ * are holes in the temporary file, so they are read as zeros. If the
+ * stream failed before the range was received, return its error status.
+ */
+kdump_status
+flat_stream_wait(struct flat_stream *fs, off_t pos, size_t len)
+{
+	kdump_status status = KDUMP_OK;
+	size_t idx;
+
+	mutex_lock(&fs->lock);
+	for (;;) {
+		idx = find_extent(fs, pos);
+		if (idx < fs->next && fs->ext[idx].start <= pos &&
+		    fs->ext[idx].end >= pos + (off_t)len)
+			break;
+		if (fs->done) {
+			status = fs->status;
+			break;
+		}
+		cond_wait(&fs->cond, &fs->lock);
+	}
+	mutex_unlock(&fs->lock);
+	return status;
+}
+
+/** Get the file descriptor of the rearranged data.
+ * @param fs  Flattened stream.
+ * @returns   File descriptor of the temporary file.
+ */
+int
+flat_stream_fd(const struct flat_stream *fs)
+{
+	return fs->spillfd;
+}
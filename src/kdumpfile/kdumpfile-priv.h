@@ -187,6 +187,18 @@ struct format_ops {
 	 */
 	void (*put_page)(struct page_io *pio);
 
+	/** Find the end of a dump file's part of memory.
+	 * @param ctx  Dump file object.
+	 * @param pfn  Page frame number.
+	 * @returns    Lowest PFN above @p pfn which may be stored in
+	 *             a different file than @p pfn.
+	 *
+	 * This method is optional. It is used to split big reads from
+	 * a dump file set, so that each file can be read by a separate
+	 * thread. If there is no such PFN, return @ref KDUMP_PFN_MAX.
+	 */
+	kdump_pfn_t (*file_end_pfn)(kdump_ctx_t *ctx, kdump_pfn_t pfn);
+
 	/** Address translation post-hook.
 	 * @param ctx  Dump file object.
 	 * @returns    Status code.
@@ -214,6 +226,8 @@ struct format_ops {
 	void (*cleanup)(struct kdump_shared *);
 };
 
+INTERNAL_DECL(kdump_status, realloc_page_cache,
+	      (kdump_ctx_t *ctx, size_t elemsize));
 INTERNAL_DECL(kdump_status, def_realloc_caches, (kdump_ctx_t *ctx));
 
 struct arch_ops {
@@ -580,9 +594,24 @@ struct kdump_shared {
 	struct fcache *fcache;	/**< File cache. */
 	mutex_t cache_lock;	/**< Cache access lock. */
 
+	/** Page cache generation.
+	 * This number changes whenever cached pages may become stale,
+	 * e.g. when the page cache is re-allocated. */
+	unsigned long cache_gen;
+
+	/** Page cache profile file name, or @c NULL. */
+	char *profile_path;
+
+	/** Read-only page filled with zeros, shared by all zero pages. */
+	void *zero_page;
+	size_t zero_page_size;	/**< Size of @c zero_page in bytes. */
+
 	/** File offset mappings for flattened files. */
 	struct flattened_map *flatmap;
 
+	/** Worker threads for parallel reads, or @c NULL. */
+	struct read_pool *read_pool;
+
 	/** Static attributes. */
 #define ATTR(dir, key, field, type, ctype, ...)	\
 	kdump_attr_value_t field;
@@ -687,6 +716,12 @@ xlat_decref(struct kdump_xlat *xlat)
 	return 0;
 }
 
+/** Number of preallocated page I/O structures for address translation.
+ * This matches the number of read cache slots in libaddrxlat, so
+ * page table reads do not need to allocate memory.
+ */
+#define XLAT_PIO_SLOTS	ADDRXLAT_READ_CACHE_SLOTS
+
 /**  Representation of a dump file.
  *
  * This structure contains state information and a pointer to @c struct
@@ -712,6 +747,25 @@ struct _kdump_ctx {
 	/** Address translation callbacks. */
 	addrxlat_cb_t *xlatcb;
 
+	/** Page I/O structures for the addrxlat get_page callback.
+	 * This is an array of @ref XLAT_PIO_SLOTS elements. */
+	struct page_io *xlat_pio;
+
+	/** Bitmap of used elements in @c xlat_pio. */
+	unsigned xlat_pio_used;
+
+	/** Private (L1) page cache, or @c NULL. */
+	struct cache *l1cache;
+
+	/** Value of @c cache_gen in @ref kdump_shared for @c l1cache. */
+	unsigned long l1gen;
+
+	/** Scratch buffer for non-contiguous file data, or @c NULL. */
+	void *scratch;
+
+	/** Size of @c scratch in bytes. */
+	size_t scratchsz;
+
 	/** Per-context data. */
 	void *data[PER_CTX_SLOTS];
 
@@ -728,6 +782,9 @@ struct _kdump_ctx {
 INTERNAL_DECL(int, per_ctx_alloc, (struct kdump_shared *shared, size_t sz));
 INTERNAL_DECL(void, per_ctx_free, (struct kdump_shared *shared, int slot));
 
+INTERNAL_DECL(kdump_ctx_t *, worker_ctx_new, (kdump_ctx_t *orig));
+INTERNAL_DECL(void, worker_ctx_free, (kdump_ctx_t *ctx));
+
 /* File formats */
 
 INTERNAL_DECL(extern const struct format_ops, elfdump_ops, );
@@ -767,9 +824,13 @@ struct timeval_64 {
 
 /* read */
 
+/** Maximum number of threads used for one read. */
+#define READ_THREADS		8
+
 INTERNAL_DECL(kdump_status, read_string_locked,
 	      (kdump_ctx_t *ctx, kdump_addrspace_t as,
 	       kdump_addr_t addr, char **pstr));
+INTERNAL_DECL(void, read_pool_free, (struct kdump_shared *shared));
 INTERNAL_DECL(kdump_status, read_locked,
 	      (kdump_ctx_t *ctx, kdump_addrspace_t as,
 	       kdump_addr_t addr, void *buffer, size_t *plength));
@@ -988,6 +1049,7 @@ INTERNAL_DECL(kdump_status, process_arch_notes,
 
 /* Virtual address space regions */
 INTERNAL_DECL(kdump_status, init_addrxlat, (kdump_ctx_t *ctx));
+INTERNAL_DECL(void, cleanup_addrxlat, (kdump_ctx_t *ctx));
 
 INTERNAL_DECL(kdump_status, create_addrxlat_attrs, (struct attr_dict *dict));
 
@@ -1215,6 +1277,14 @@ INTERNAL_DECL(extern const struct attr_ops, num_files_ops, );
 INTERNAL_DECL(extern const struct attr_ops, page_size_ops, );
 INTERNAL_DECL(extern const struct attr_ops, page_shift_ops, );
 INTERNAL_DECL(extern const struct attr_ops, cache_size_ops, );
+INTERNAL_DECL(extern const struct attr_ops, cache_arena_ops, );
+INTERNAL_DECL(extern const struct attr_ops, cache_budget_ops, );
+INTERNAL_DECL(extern const struct attr_ops, cache_l1_size_ops, );
+INTERNAL_DECL(extern const struct attr_ops, cache_reset_stats_ops, );
+INTERNAL_DECL(extern const struct attr_ops, cache_invalidate_ops, );
+INTERNAL_DECL(extern const struct attr_ops, file_access_ops, );
+INTERNAL_DECL(extern const struct attr_ops, file_read_block_size_ops, );
+INTERNAL_DECL(extern const struct attr_ops, cache_profile_ops, );
 INTERNAL_DECL(extern const struct attr_ops, arch_name_ops, );
 INTERNAL_DECL(extern const struct attr_ops, ostype_ops, );
 INTERNAL_DECL(extern const struct attr_ops, uts_machine_ops, );
@@ -1222,6 +1292,7 @@ INTERNAL_DECL(extern const struct attr_ops, vmcoreinfo_raw_ops, );
 INTERNAL_DECL(extern const struct attr_ops, dirty_xlat_ops, );
 INTERNAL_DECL(extern const struct attr_ops, linux_dirty_xlat_ops, );
 INTERNAL_DECL(extern const struct attr_ops, xen_dirty_xlat_ops, );
+INTERNAL_DECL(extern const struct attr_ops, xlat_cache_stats_ops, );
 INTERNAL_DECL(extern const struct attr_ops, linux_version_code_ops, );
 INTERNAL_DECL(extern const struct attr_ops, linux_ver_ops, );
 INTERNAL_DECL(extern const struct attr_ops, xen_version_code_ops, );
@@ -1290,7 +1361,9 @@ struct cache_entry {
 	enum cache_state state;	/**< Cache entry state. */
 	unsigned next;		/**< Index of next entry in evict list. */
 	unsigned prev;		/**< Index of previous entry in evict list. */
-	unsigned refcnt;	/**< Reference count. */
+	unsigned refcnt;	/**< Reference count (and cache flags). */
+	unsigned hits;		/**< Number of hits since the entry was loaded. */
+	unsigned char part;	/**< Cache partition (private to the cache). */
 	void *data;		/**< Pointer to data. */
 };
 
@@ -1301,22 +1374,53 @@ struct cache_entry {
  */
 typedef void cache_entry_cleanup_fn(void *data, struct cache_entry *ce);
 
+/** Cache walk callback.
+ * @param data  User-supplied data pointer.
+ * @param ce    Cached entry.
+ * @sa cache_walk
+ */
+typedef void cache_walk_fn(void *data, const struct cache_entry *ce);
+
 INTERNAL_DECL(unsigned, get_cache_size, (kdump_ctx_t *ctx));
-INTERNAL_DECL(struct cache *, cache_alloc, (unsigned n, size_t size));
+INTERNAL_DECL(unsigned, get_cache_l1_size, (kdump_ctx_t *ctx));
+INTERNAL_DECL(kdump_cache_arena_t, get_cache_arena, (kdump_ctx_t *ctx));
+INTERNAL_DECL(unsigned, get_cache_limit, (kdump_ctx_t *ctx, size_t elemsize));
+INTERNAL_DECL(bool, get_cache_adaptive, (kdump_ctx_t *ctx));
+INTERNAL_DECL(kdump_num_t, get_cache_compressed_bytes, (kdump_ctx_t *ctx));
+INTERNAL_DECL(kdump_num_t, get_cache_max_age, (kdump_ctx_t *ctx));
+INTERNAL_DECL(void *, arena_alloc, (size_t size, kdump_cache_arena_t *arena));
+INTERNAL_DECL(void, arena_free,
+	      (void *ptr, size_t size, kdump_cache_arena_t arena));
+INTERNAL_DECL(struct cache *, cache_alloc,
+	      (unsigned n, size_t size, kdump_cache_arena_t arena));
 INTERNAL_DECL(void, set_cache_entry_cleanup,
 	      (struct cache *, cache_entry_cleanup_fn *, void *));
 INTERNAL_DECL(void, cache_free, (struct cache *));
 INTERNAL_DECL(void, cache_flush, (struct cache *));
+INTERNAL_DECL(void, cache_set_limit, (struct cache *cache, unsigned limit));
+INTERNAL_DECL(unsigned, cache_idle, (const struct cache *cache));
+INTERNAL_DECL(size_t, cache_footprint,
+	      (const struct cache *cache, size_t extsize));
 INTERNAL_DECL(struct cache_entry *, cache_get_entry,
 	      (struct cache *, cache_key_t));
+INTERNAL_DECL(struct cache_entry *, cache_get_entry_fast,
+	      (struct cache *, cache_key_t));
 INTERNAL_DECL(void, cache_put_entry,
 	      (struct cache *cache, struct cache_entry *entry));
 INTERNAL_DECL(void, cache_insert, (struct cache *, struct cache_entry *));
 INTERNAL_DECL(void, cache_discard, (struct cache *, struct cache_entry *));
-
+INTERNAL_DECL(bool, cache_entry_unshared,
+	      (const struct cache_entry *entry));
+INTERNAL_DECL(void, cache_walk,
+	      (struct cache *cache, cache_walk_fn *fn, void *data));
+
+INTERNAL_DECL(void, cache_reset_stats, (struct cache *cache));
+INTERNAL_DECL(void, cache_init_attrs,
+	      (kdump_ctx_t *ctx, struct attr_data *dir));
+INTERNAL_DECL(void, cache_embed_attrs,
+	      (kdump_ctx_t *ctx, struct attr_data *dir));
 INTERNAL_DECL(kdump_status, cache_set_attrs,
-	      (struct cache *cache, kdump_ctx_t *ctx,
-	       struct attr_data *hits, struct attr_data *misses));
+	      (struct cache *cache, kdump_ctx_t *ctx, struct attr_data *dir));
 
 /**  Check if a cache entry is valid.
  *
@@ -1329,8 +1433,42 @@ cache_entry_valid(struct cache_entry *entry)
 	return entry->state == cs_valid;
 }
 
+/* Page cache profiles */
+
+INTERNAL_DECL(void, cache_profile_save, (struct kdump_shared *shared));
+INTERNAL_DECL(void, cache_profile_load, (kdump_ctx_t *ctx));
+
+/* Compressed payload cache */
+
+struct zcache;
+
+INTERNAL_DECL(struct zcache *, zcache_alloc,
+	      (size_t bytes, size_t avgsize, kdump_cache_arena_t arena));
+INTERNAL_DECL(void, zcache_free, (struct zcache *zc));
+INTERNAL_DECL(void, zcache_put,
+	      (struct zcache *zc, cache_key_t key, unsigned flags,
+	       const void *data, size_t size));
+INTERNAL_DECL(size_t, zcache_get,
+	      (struct zcache *zc, cache_key_t key,
+	       unsigned *flags, void *buf, size_t bufsz));
+
 /* File cache */
 
+/** @c O_DIRECT descriptor has not been opened yet. */
+#define FCACHE_DFD_UNKNOWN	(-1)
+
+/** @c O_DIRECT descriptor is not available. */
+#define FCACHE_DFD_NONE		(-2)
+
+/** Maximum size of file cache read blocks. */
+#define MAX_READ_BLOCK_SIZE	(16 * 1024 * 1024)
+
+/** Number of fallback cache entries reserved for concurrent readers.
+ * Each reader may hold two blocks, e.g. for a compressed page which
+ * crosses a block boundary.
+ */
+#define FCACHE_FB_RESERVE	(2 * READ_THREADS)
+
 /** File cache entry.
  */
 struct fcache_entry {
@@ -1347,14 +1485,50 @@ struct fcache_entry {
 	struct cache *cache;
 };
 
+struct flat_stream;
+
 /** Information about an open file in a file cache.
  */
 struct fcache_fileinfo {
+	/** I/O lock of this file.
+	 * Serializes cache misses for this file, so only one request is
+	 * outstanding for each file, but different files are read
+	 * concurrently. Also guards @c dfd and access tracking
+	 * (@c advice, @c seqlru and @c seq).
+	 */
+	mutex_t lock;
+
 	/** Open file descriptor. */
 	int fd;
 
+	/** Flattened stream which provides data for @c fd, or @c NULL. */
+	struct flat_stream *stream;
+
 	/** File size (if known) or maximum off_t. */
 	off_t filesz;
+
+	/** Mapping of the whole file, @c MAP_FAILED if the file cannot
+	 * be mapped at once, or @c NULL if not yet attempted. */
+	void *map;
+
+	/** Descriptor opened with @c O_DIRECT, @ref FCACHE_DFD_UNKNOWN
+	 * if not yet attempted, or @ref FCACHE_DFD_NONE if not available. */
+	int dfd;
+
+	/** Access advice in effect (@ref kdump_access_t).
+	 * Written with the file lock held, but read atomically without
+	 * the lock when a whole-file mapping is created.
+	 */
+	unsigned char advice;
+
+	/** Index of the stream to be replaced on a non-sequential access. */
+	unsigned char seqlru;
+
+	/** Streams of sequential page accesses. */
+	struct {
+		off_t lastpg;	/**< Last accessed page index. */
+		unsigned run;	/**< Number of consecutive pages. */
+	} seq[2];
 };
 
 /** File cache.
@@ -1366,36 +1540,64 @@ struct fcache_fileinfo {
  * which are normally zero, because cache entries are aligned to a page
  * boundary. As a consequence, the number of files is limited to (host)
  * page size in bytes.
+ *
+ * The file cache has its own locking, so callers need not hold any lock.
+ * The lock of each file is held while data is read from that file, and
+ * the lock of the file cache is held only while cache entries are looked
+ * up or inserted. If both are needed, the file lock must be taken first.
  */
 struct fcache {
 	/** Reference counter. */
 	unsigned long refcnt;
 
+	/** Guard @c cache and @c fbcache. */
+	mutex_t lock;
+
 	/** Policy for using mmap(2) vs. read(2).
+	 * Accessed atomically, because @ref KDUMP_MMAP_TRY_ONCE is
+	 * replaced by the first read from any file.
 	 * @sa kdump_mmap_policy_t
 	 */
 	kdump_attr_value_t mmap_policy;
 
+	/** Access pattern hint.
+	 * @sa kdump_access_t
+	 */
+	kdump_attr_value_t access;
+
+	/** Bypass the kernel page cache with @c O_DIRECT reads. */
+	kdump_attr_value_t direct_io;
+
 	/** Page size (in bytes). */
 	size_t pgsz;
 
 	/** Size of mmap'ed regions. */
 	size_t mmapsz;
 
+	/** Size of read(2) blocks. */
+	size_t rdblksz;
+
 	/** Main cache (for mmap'ed regions). */
 	struct cache *cache;
 
 	/** Fallback cache (for read regions). */
 	struct cache *fbcache;
 
+	/** Number of files. */
+	unsigned nfds;
+
 	/** Information about the files. */
 	struct fcache_fileinfo info[];
 };
 
 INTERNAL_DECL(struct fcache *, fcache_new,
-	      (unsigned nfds, const int *fd, unsigned n, unsigned order));
+	      (unsigned nfds, const int *fd, unsigned n, unsigned order,
+	       size_t rdblksz));
 INTERNAL_DECL(void, fcache_free,
 	      (struct fcache *fc));
+INTERNAL_DECL(size_t, fcache_footprint, (const struct fcache *fc));
+INTERNAL_DECL(void, fcache_set_stream,
+	      (struct fcache *fc, unsigned fidx, struct flat_stream *fs));
 
 /** Increment file cache reference counter.
  * @param fc  File cache.
@@ -1480,6 +1682,9 @@ struct fcache_chunk {
 INTERNAL_DECL(kdump_status, fcache_get_chunk,
 	      (struct fcache *fc, struct fcache_chunk *fch,
 	       size_t len, unsigned fidx, off_t pos));
+INTERNAL_DECL(kdump_status, fcache_get_chunk_buf,
+	      (struct fcache *fc, struct fcache_chunk *fch,
+	       size_t len, unsigned fidx, off_t pos, void *buf));
 INTERNAL_DECL(void, fcache_put_chunk, (struct fcache_chunk *fch));
 
 /**  Page I/O information.
@@ -1498,6 +1703,10 @@ INTERNAL_DECL(kdump_status, cache_get_page,
 	      (struct page_io *pio, read_page_fn *fn));
 INTERNAL_DECL(void, cache_put_page,
 	      (struct page_io *pio));
+INTERNAL_DECL(kdump_status, alloc_zero_page, (kdump_ctx_t *ctx));
+INTERNAL_DECL(void, free_zero_page, (struct kdump_shared *shared));
+INTERNAL_DECL(kdump_status, get_zero_page, (struct page_io *pio));
+INTERNAL_DECL(void *, get_scratch, (kdump_ctx_t *ctx, size_t size));
 
 /** Get page data.
  * @param pio  Page I/O control.
@@ -1774,7 +1983,15 @@ INTERNAL_DECL(kdump_status, flatmap_pread_flat,
 	       unsigned fidx, off_t pos));
 INTERNAL_DECL(kdump_status, flatmap_get_chunk_flat,
 	      (struct flattened_map *map, struct fcache_chunk *fch,
-	       size_t len, unsigned fidx, off_t pos));
+	       size_t len, unsigned fidx, off_t pos, void *buf));
+
+INTERNAL_DECL(kdump_status, flat_stream_open,
+	      (kdump_ctx_t *ctx, unsigned fidx, int fd,
+	       struct flat_stream **pstream));
+INTERNAL_DECL(kdump_status, flat_stream_wait,
+	      (struct flat_stream *fs, off_t pos, size_t len));
+INTERNAL_DECL(int, flat_stream_fd, (const struct flat_stream *fs));
+INTERNAL_DECL(void, flat_stream_free, (struct flat_stream *fs));
 
 /** Check whether a given file in a set is flattened.
  * @param map   Flattened offset map.
@@ -1823,10 +2040,32 @@ flatmap_get_chunk(struct flattened_map *flatmap, struct fcache_chunk *fch,
 		  size_t len, unsigned fidx, off_t pos)
 {
 	return flatmap_isflattened(flatmap, fidx)
-		? flatmap_get_chunk_flat(flatmap, fch, len, fidx, pos)
+		? flatmap_get_chunk_flat(flatmap, fch, len, fidx, pos, NULL)
 		: fcache_get_chunk(flatmap->fcache, fch, len, fidx, pos);
 }
 
+/** Get a contiguous data chunk using a bounce buffer.
+ * @param flatmap  Flattened offset map.
+ * @param fch      File cache chunk, updated on success.
+ * @param len      Length of data.
+ * @param fidx     Index of the file to read from.
+ * @param pos      File position.
+ * @param buf      Bounce buffer of at least @p len bytes.
+ * @returns        Error status.
+ *
+ * Same as @ref flatmap_get_chunk, but use @p buf instead of allocating
+ * memory if the data is not contiguous. See @ref fcache_get_chunk_buf.
+ */
+static inline kdump_status
+flatmap_get_chunk_buf(struct flattened_map *flatmap, struct fcache_chunk *fch,
+		      size_t len, unsigned fidx, off_t pos, void *buf)
+{
+	return flatmap_isflattened(flatmap, fidx)
+		? flatmap_get_chunk_flat(flatmap, fch, len, fidx, pos, buf)
+		: fcache_get_chunk_buf(flatmap->fcache, fch, len,
+				       fidx, pos, buf);
+}
+
 
 /** Check if a character is a POSIX white space.
  * @param c  Character to check.
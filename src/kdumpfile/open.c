@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 
 /** File cache size.
  * This number should be big enough to cover page table lookups with a
@@ -58,7 +59,8 @@
 #define FCACHE_ORDER	10
 
 static kdump_status open_dump(kdump_ctx_t *ctx);
-static kdump_status finish_open_dump(kdump_ctx_t *ctx);
+static kdump_status finish_open_dump(kdump_ctx_t *ctx,
+				     uint64_t setup_us, uint64_t probe_us);
 
 static const struct format_ops *formats[] = {
 	&elfdump_ops,
@@ -264,6 +266,18 @@ const struct attr_ops file_fd_ops = {
 	.post_set = file_fd_post_hook,
 };
 
+/**  Get the current monotonic time in microseconds.
+ * @returns  Current time.
+ */
+static uint64_t
+now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /**  Open the dump.
  * @param ctx   Dump file object.
  * @returns     Error status.
@@ -277,23 +291,29 @@ open_dump(kdump_ctx_t *ctx)
 	/* Attributes that point into ctx->shared->fcache */
 	static const enum global_keyidx fcache_attrs[] = {
 		GKI_file_mmap_policy,
-		GKI_mmap_cache_hits,
-		GKI_mmap_cache_misses,
-		GKI_read_cache_hits,
-		GKI_read_cache_misses,
+		GKI_file_access,
+		GKI_file_direct_io,
 	};
 
 	size_t nfiles = get_num_files(ctx);
 	struct attr_data *dir;
 	struct attr_data *mmap_attr;
+	struct attr_data *access_attr;
+	struct attr_data *direct_attr;
+	struct attr_data *rdblk_attr;
 	kdump_status ret;
+	struct flat_stream *streams[nfiles];
 	int fdset[nfiles];
+	uint64_t start, probe_start;
 	int i;
 
+	start = now_us();
 	flatmap_free(ctx->shared->flatmap);
 	if (ctx->shared->fcache) {
 		for (i = 0; i < ARRAY_SIZE(fcache_attrs); ++i)
 			attr_embed_value(gattr(ctx, fcache_attrs[i]));
+		cache_embed_attrs(ctx, gattr(ctx, GKI_dir_file_mmap_cache));
+		cache_embed_attrs(ctx, gattr(ctx, GKI_dir_file_read_cache));
 		fcache_decref(ctx->shared->fcache);
 	}
 
@@ -304,23 +324,56 @@ open_dump(kdump_ctx_t *ctx)
 			continue;
 		fdset[dir->template->fidx] = attr_value(child)->number;
 	}
-	ctx->shared->fcache = fcache_new(nfiles, fdset,
-					 FCACHE_SIZE, FCACHE_ORDER);
-	if (!ctx->shared->fcache)
-		return set_error(ctx, KDUMP_ERR_SYSTEM,
-				 "Cannot allocate file cache");
+
+	/* Non-seekable files are read through a temporary file. */
+	ret = KDUMP_OK;
+	for (i = 0; i < nfiles; ++i) {
+		streams[i] = NULL;
+		if (ret == KDUMP_OK)
+			ret = flat_stream_open(ctx, i, fdset[i], &streams[i]);
+		if (streams[i])
+			fdset[i] = flat_stream_fd(streams[i]);
+	}
+
+	rdblk_attr = gattr(ctx, GKI_file_read_block_size);
+	ctx->shared->fcache = ret == KDUMP_OK
+		? fcache_new(nfiles, fdset, FCACHE_SIZE, FCACHE_ORDER,
+			     attr_isset(rdblk_attr)
+			     ? attr_value(rdblk_attr)->number
+			     : 0)
+		: NULL;
+	if (!ctx->shared->fcache) {
+		for (i = 0; i < nfiles; ++i)
+			if (streams[i])
+				flat_stream_free(streams[i]);
+		return ret != KDUMP_OK
+			? ret
+			: set_error(ctx, KDUMP_ERR_SYSTEM,
+				    "Cannot allocate file cache");
+	}
+	for (i = 0; i < nfiles; ++i)
+		if (streams[i])
+			fcache_set_stream(ctx->shared->fcache, i, streams[i]);
 
 	mmap_attr = gattr(ctx, GKI_file_mmap_policy);
 	ctx->shared->fcache->mmap_policy = *attr_value(mmap_attr);
 	set_attr(ctx, mmap_attr, ATTR_PERSIST_INDIRECT,
 		 &ctx->shared->fcache->mmap_policy);
 
+	access_attr = gattr(ctx, GKI_file_access);
+	ctx->shared->fcache->access = *attr_value(access_attr);
+	set_attr(ctx, access_attr, ATTR_PERSIST_INDIRECT,
+		 &ctx->shared->fcache->access);
+
+	direct_attr = gattr(ctx, GKI_file_direct_io);
+	ctx->shared->fcache->direct_io = *attr_value(direct_attr);
+	set_attr(ctx, direct_attr, ATTR_PERSIST_INDIRECT,
+		 &ctx->shared->fcache->direct_io);
+
 	cache_set_attrs(ctx->shared->fcache->cache, ctx,
-			gattr(ctx, GKI_mmap_cache_hits),
-			gattr(ctx, GKI_mmap_cache_misses));
+			gattr(ctx, GKI_dir_file_mmap_cache));
 	cache_set_attrs(ctx->shared->fcache->fbcache, ctx,
-			gattr(ctx, GKI_read_cache_hits),
-			gattr(ctx, GKI_read_cache_misses));
+			gattr(ctx, GKI_dir_file_read_cache));
 
 	ctx->shared->flatmap = flatmap_alloc(nfiles);
 	if (!ctx->shared->flatmap)
@@ -333,11 +386,13 @@ open_dump(kdump_ctx_t *ctx)
 
 	ctx->xlat->dirty = true;
 
+	probe_start = now_us();
 	for (i = 0; i < ARRAY_SIZE(formats); ++i) {
 		ctx->shared->ops = formats[i];
 		ret = ctx->shared->ops->probe(ctx);
 		if (ret == KDUMP_OK)
-			return finish_open_dump(ctx);
+			return finish_open_dump(ctx, probe_start - start,
+						now_us() - probe_start);
 		if (ctx->shared->ops->cleanup)
 			ctx->shared->ops->cleanup(ctx->shared);
 		if (ret != KDUMP_NOPROBE)
@@ -345,8 +400,10 @@ open_dump(kdump_ctx_t *ctx)
 
 		ctx->shared->ops = NULL;
 		if (ctx->shared->cache) {
+			cache_embed_attrs(ctx, gattr(ctx, GKI_dir_cache));
 			cache_free(ctx->shared->cache);
 			ctx->shared->cache = NULL;
+			++ctx->shared->cache_gen;
 		}
 		clear_volatile_attrs(ctx);
 		clear_error(ctx);
@@ -356,14 +413,22 @@ open_dump(kdump_ctx_t *ctx)
 }
 
 /** Finish opening a dump file of a known file format.
- * @param ctx   Dump file object.
- * @returns     Error status.
+ * @param ctx       Dump file object.
+ * @param setup_us  Time spent before probing, in microseconds.
+ * @param probe_us  Time spent probing, in microseconds.
+ * @returns         Error status.
  */
 static kdump_status
-finish_open_dump(kdump_ctx_t *ctx)
+finish_open_dump(kdump_ctx_t *ctx, uint64_t setup_us, uint64_t probe_us)
 {
 	set_attr_static_string(ctx, gattr(ctx, GKI_file_format),
 			       ATTR_DEFAULT, ctx->shared->ops->name);
+	set_attr_number(ctx, gattr(ctx, GKI_file_open_time_setup),
+			ATTR_DEFAULT, setup_us);
+	set_attr_number(ctx, gattr(ctx, GKI_file_open_time_probe),
+			ATTR_DEFAULT, probe_us);
+
+	cache_profile_load(ctx);
 
 	return KDUMP_OK;
 }
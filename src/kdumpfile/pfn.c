@@ -224,7 +224,7 @@ skip_set_msb0(const unsigned char *bitmap, size_t size, kdump_pfn_t pfn)
 	if (bp >= endp)
 		return pfn;
 
-	val = ~(*bp << (pfn & 7));
+	val = ~*bp << (pfn & 7);
 	if (val)
 		return pfn + clz((uint32_t)val << 24);
 
@@ -243,29 +243,28 @@ skip_set_msb0(const unsigned char *bitmap, size_t size, kdump_pfn_t pfn)
 	return pfn;
 }
 
-/** Create PFN regions from a PFN bitmap.
- * @param err        Error context.
+/** Add PFN regions from a part of a PFN bitmap.
  * @param pfm        Target PFN-to-file mapping.
  * @param bitmap     Source PFN bitmap.
  * @param is_msb0    @c true means @p bitmap uses MSB 0 bit numbering,
  *                   @c false means @p bitmap uses LSB 0 bit numbering.
  * @param start_pfn  Lowest PFN to process.
  * @param end_pfn    One above the highest PFN to process.
- * @param fileoff    First target file offset.
+ * @param pos        Target file offset of the first set bit.
+ *                   Updated to the offset after the last set bit.
  * @param elemsz     Size of the mapped file object.
- * @returns          Error status.
+ * @returns          @c true on success, @c false on allocation failure.
  */
-kdump_status
-pfn_regions_from_bitmap(kdump_errmsg_t *err, struct pfn_file_map *pfm,
-			const unsigned char *bitmap, bool is_msb0,
-			kdump_pfn_t start_pfn, kdump_pfn_t end_pfn,
-			off_t fileoff, off_t elemsz)
+static bool
+add_bitmap_regions(struct pfn_file_map *pfm, const unsigned char *bitmap,
+		   bool is_msb0, kdump_pfn_t start_pfn, kdump_pfn_t end_pfn,
+		   off_t *pos, off_t elemsz)
 {
 	size_t bitmapsize = (end_pfn + 7) >> 3;
 	kdump_pfn_t pfn = start_pfn;
 	struct pfn_region rgn;
 
-	rgn.pos = fileoff;
+	rgn.pos = *pos;
 	while (pfn < end_pfn) {
 		if (is_msb0) {
 			rgn.pfn = skip_clear_msb0(bitmap, bitmapsize, pfn);
@@ -283,13 +282,205 @@ pfn_regions_from_bitmap(kdump_errmsg_t *err, struct pfn_file_map *pfm,
 			continue;
 
 		if (!add_pfn_region(pfm, &rgn))
-			return status_err(err, KDUMP_ERR_SYSTEM,
-					  "Cannot allocate more than"
-					  " %zu PFN region mappings",
-					  pfm->nregions);
+			return false;
 		rgn.pos += rgn.cnt * elemsz;
 	}
 
+	*pos = rgn.pos;
+	return true;
+}
+
+#if USE_PTHREAD
+/** Maximum number of threads used to convert a PFN bitmap. */
+#define BITMAP_THREADS		8
+#else
+#define BITMAP_THREADS		1
+#endif
+
+/** Minimum number of PFNs converted by one thread. */
+#define BITMAP_PART_PFNS	((kdump_pfn_t)1 << 22)
+
+/** Part of a PFN bitmap converted by one thread.
+ */
+struct bitmap_part {
+	const unsigned char *bitmap; /**< Source PFN bitmap. */
+	bool is_msb0;		     /**< MSB 0 bit numbering. */
+	kdump_pfn_t start_pfn;	     /**< Lowest PFN to process. */
+	kdump_pfn_t end_pfn;	     /**< One above the highest PFN. */
+	off_t elemsz;		     /**< Size of the mapped file object. */
+
+	struct pfn_file_map map;     /**< Regions found in this part. */
+	off_t size;		     /**< Total size of mapped objects. */
+	bool ok;		     /**< Conversion succeeded. */
+#if USE_PTHREAD
+	pthread_t tid;		     /**< Worker thread. */
+	bool started;		     /**< Worker thread is running. */
+#endif
+};
+
+/** Convert a part of a PFN bitmap.
+ * @param arg  Bitmap part.
+ * @returns    Always @c NULL.
+ *
+ * File positions of the resulting regions are relative to the first
+ * set bit in this part.
+ */
+static void *
+convert_bitmap_part(void *arg)
+{
+	struct bitmap_part *part = arg;
+
+	part->size = 0;
+	part->ok = add_bitmap_regions(&part->map, part->bitmap,
+				      part->is_msb0, part->start_pfn,
+				      part->end_pfn, &part->size,
+				      part->elemsz);
+	return NULL;
+}
+
+/** Append converted bitmap parts to a PFN-to-file mapping.
+ * @param pfm      Target PFN-to-file mapping.
+ * @param parts    Converted parts.
+ * @param n        Number of parts.
+ * @param fileoff  Target file offset of the first part.
+ * @returns        @c true on success, @c false on allocation failure.
+ *
+ * A region which crosses a part boundary is merged, so the result is
+ * the same as if the whole bitmap was converted at once.
+ */
+static bool
+append_bitmap_parts(struct pfn_file_map *pfm, const struct bitmap_part *parts,
+		    unsigned n, off_t fileoff)
+{
+	struct pfn_region *rgn, *prev;
+	size_t total, num, i;
+	unsigned k;
+
+	total = pfm->nregions;
+	for (k = 0; k < n; ++k)
+		total += parts[k].map.nregions;
+	if (total == pfm->nregions)
+		return true;
+
+	/* Keep the allocation a multiple of RGN_ALLOC_INC. */
+	num = (total + RGN_ALLOC_INC - 1) & ~(size_t)(RGN_ALLOC_INC - 1);
+	rgn = realloc(pfm->regions, num * sizeof(struct pfn_region));
+	if (!rgn)
+		return false;
+	pfm->regions = rgn;
+
+	prev = pfm->nregions ? &pfm->regions[pfm->nregions - 1] : NULL;
+	for (k = 0; k < n; ++k) {
+		const struct bitmap_part *part = &parts[k];
+
+		for (i = 0; i < part->map.nregions; ++i) {
+			const struct pfn_region *src = &part->map.regions[i];
+
+			if (i == 0 && k && prev &&
+			    prev->pfn + prev->cnt == src->pfn &&
+			    src->pfn == part->start_pfn) {
+				prev->cnt += src->cnt;
+				continue;
+			}
+			prev = &pfm->regions[pfm->nregions++];
+			prev->pfn = src->pfn;
+			prev->cnt = src->cnt;
+			prev->pos = fileoff + src->pos;
+		}
+		fileoff += part->size;
+	}
+	return true;
+}
+
+/** Create PFN regions from a PFN bitmap.
+ * @param err        Error context.
+ * @param pfm        Target PFN-to-file mapping.
+ * @param bitmap     Source PFN bitmap.
+ * @param is_msb0    @c true means @p bitmap uses MSB 0 bit numbering,
+ *                   @c false means @p bitmap uses LSB 0 bit numbering.
+ * @param start_pfn  Lowest PFN to process.
+ * @param end_pfn    One above the highest PFN to process.
+ * @param fileoff    First target file offset.
+ * @param elemsz     Size of the mapped file object.
+ * @returns          Error status.
+ *
+ * Big bitmaps are split into parts, which are converted by separate
+ * threads and then appended to @p pfm in order.
+ */
+kdump_status
+pfn_regions_from_bitmap(kdump_errmsg_t *err, struct pfn_file_map *pfm,
+			const unsigned char *bitmap, bool is_msb0,
+			kdump_pfn_t start_pfn, kdump_pfn_t end_pfn,
+			off_t fileoff, off_t elemsz)
+{
+	struct bitmap_part parts[BITMAP_THREADS];
+	kdump_pfn_t npfns;
+	unsigned i, n;
+	bool ok;
+
+	npfns = end_pfn > start_pfn ? end_pfn - start_pfn : 0;
+	n = npfns / BITMAP_PART_PFNS < BITMAP_THREADS
+		? npfns / BITMAP_PART_PFNS
+		: BITMAP_THREADS;
+	if (n <= 1) {
+		ok = add_bitmap_regions(pfm, bitmap, is_msb0,
+					start_pfn, end_pfn,
+					&fileoff, elemsz);
+		goto out;
+	}
+
+	for (i = 0; i < n; ++i) {
+		struct bitmap_part *part = &parts[i];
+
+		part->bitmap = bitmap;
+		part->is_msb0 = is_msb0;
+		/* Part boundaries are aligned, so parts share no bytes. */
+		part->start_pfn = i
+			? (start_pfn + i * (npfns / n)) & ~(kdump_pfn_t)63
+			: start_pfn;
+		part->end_pfn = i < n - 1
+			? (start_pfn + (i + 1) * (npfns / n)) & ~(kdump_pfn_t)63
+			: end_pfn;
+		part->elemsz = elemsz;
+		part->map.regions = NULL;
+		part->map.nregions = 0;
+
+#if USE_PTHREAD
+		part->started = i &&
+			!pthread_create(&part->tid, NULL,
+					convert_bitmap_part, part);
+#endif
+	}
+
+	for (i = 0; i < n; ++i) {
+#if USE_PTHREAD
+		if (parts[i].started)
+			continue;
+#endif
+		convert_bitmap_part(&parts[i]);
+	}
+
+	ok = true;
+	for (i = 0; i < n; ++i) {
+#if USE_PTHREAD
+		if (parts[i].started)
+			pthread_join(parts[i].tid, NULL);
+#endif
+		ok = ok && parts[i].ok;
+	}
+
+	if (ok)
+		ok = append_bitmap_parts(pfm, parts, n, fileoff);
+
+	for (i = 0; i < n; ++i)
+		free(parts[i].map.regions);
+
+ out:
+	if (!ok)
+		return status_err(err, KDUMP_ERR_SYSTEM,
+				  "Cannot allocate more than"
+				  " %zu PFN region mappings",
+				  pfm->nregions);
 	return KDUMP_OK;
 }
 
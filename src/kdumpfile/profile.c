@@ -0,0 +1,309 @@
+/** @internal @file src/kdumpfile/profile.c
+ * @brief Page cache access profiles.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#define _GNU_SOURCE
+
+#include "kdumpfile-priv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** First line of a profile file. */
+#define PROFILE_HEADER	"# libkdumpfile cache profile"
+
+/** Maximum number of threads used to prefetch pages. */
+#define PREFETCH_THREADS	8
+
+/**  Profile entry.
+ */
+struct profile_entry {
+	cache_key_t key;	/**< Page cache key. */
+	unsigned hits;		/**< Number of cache hits. */
+};
+
+/**  Page cache profile.
+ */
+struct profile {
+	struct profile_entry *ent; /**< Profile entries. */
+	size_t n;		   /**< Number of used entries. */
+	size_t alloc;		   /**< Number of allocated entries. */
+};
+
+/**  Add an entry to a profile.
+ * @param prof  Page cache profile.
+ * @param key   Page cache key.
+ * @param hits  Number of cache hits.
+ * @returns     Zero on success, -1 if out of memory.
+ */
+static int
+profile_add(struct profile *prof, cache_key_t key, unsigned hits)
+{
+	if (prof->n == prof->alloc) {
+		size_t newalloc = prof->alloc ? 2 * prof->alloc : 64;
+		struct profile_entry *ent;
+
+		ent = realloc(prof->ent, newalloc * sizeof(*ent));
+		if (!ent)
+			return -1;
+		prof->ent = ent;
+		prof->alloc = newalloc;
+	}
+	prof->ent[prof->n].key = key;
+	prof->ent[prof->n].hits = hits;
+	++prof->n;
+	return 0;
+}
+
+/**  Cache walk callback to build a profile.
+ * @param data  Page cache profile.
+ * @param ce    Cached entry.
+ */
+static void
+profile_walk(void *data, const struct cache_entry *ce)
+{
+	profile_add(data, ce->key, ce->hits);
+}
+
+/**  Compare profile entries by the number of hits (descending).
+ */
+static int
+profile_cmp(const void *a, const void *b)
+{
+	const struct profile_entry *pa = a, *pb = b;
+	return (pa->hits < pb->hits) - (pa->hits > pb->hits);
+}
+
+/**  Save the page cache profile.
+ * @param shared  Dump file shared data.
+ *
+ * If a profile file is set, write the keys of all cached pages to it,
+ * most frequently hit pages first. Errors are ignored, because nothing
+ * else depends on the profile.
+ */
+void
+cache_profile_save(struct kdump_shared *shared)
+{
+	struct profile prof = { NULL, 0, 0 };
+	FILE *f;
+	size_t i;
+
+	if (!shared->profile_path || !shared->cache)
+		return;
+
+	mutex_lock(&shared->cache_lock);
+	cache_walk(shared->cache, profile_walk, &prof);
+	mutex_unlock(&shared->cache_lock);
+	qsort(prof.ent, prof.n, sizeof(*prof.ent), profile_cmp);
+
+	f = fopen(shared->profile_path, "w");
+	if (f) {
+		fputs(PROFILE_HEADER "\n", f);
+		for (i = 0; i < prof.n; ++i)
+			fprintf(f, "%llx %u\n",
+				(unsigned long long) prof.ent[i].key,
+				prof.ent[i].hits);
+		fclose(f);
+	}
+	free(prof.ent);
+}
+
+/**  Read a profile file.
+ * @param ctx   Dump file object.
+ * @param prof  Page cache profile (filled in on success).
+ * @param max   Maximum number of entries to read.
+ * @returns     Zero on success, -1 on failure.
+ *
+ * Lines which cannot be parsed and keys which are not valid for the
+ * current page size are skipped.
+ */
+static int
+profile_read(kdump_ctx_t *ctx, struct profile *prof, size_t max)
+{
+	size_t page_mask = get_page_size(ctx) - 1;
+	unsigned long long key;
+	char line[80];
+	unsigned hits;
+	FILE *f;
+	int ret;
+
+	f = fopen(ctx->shared->profile_path, "r");
+	if (!f)
+		return -1;
+
+	ret = 0;
+	if (!fgets(line, sizeof line, f) ||
+	    strncmp(line, PROFILE_HEADER, sizeof(PROFILE_HEADER) - 1))
+		ret = -1;
+	while (!ret && prof->n < max && fgets(line, sizeof line, f)) {
+		if (sscanf(line, "%llx %u", &key, &hits) != 2 ||
+		    (key & page_mask) > ADDRXLAT_KVADDR)
+			continue;
+		ret = profile_add(prof, key, hits);
+	}
+
+	fclose(f);
+	return ret;
+}
+
+/**  Shared state of prefetch workers.
+ */
+struct prefetch_ctl {
+	const struct profile *prof; /**< Page cache profile. */
+	size_t next;		   /**< Index of the next entry. */
+};
+
+/**  Prefetch worker.
+ */
+struct prefetch_worker {
+	struct prefetch_ctl *ctl; /**< Shared state. */
+	kdump_ctx_t *ctx;	  /**< Dump file object of this worker. */
+#if USE_PTHREAD
+	pthread_t tid;		  /**< Worker thread. */
+#endif
+};
+
+/**  Prefetch pages into the page cache.
+ * @param arg  Prefetch worker.
+ * @returns    Always @c NULL.
+ *
+ * Take profile entries one by one until there are none left, and read
+ * the corresponding pages. Errors are ignored.
+ */
+static void *
+prefetch_worker(void *arg)
+{
+	struct prefetch_worker *worker = arg;
+	struct prefetch_ctl *ctl = worker->ctl;
+	kdump_ctx_t *ctx = worker->ctx;
+	size_t page_mask = get_page_size(ctx) - 1;
+	struct page_io pio;
+	cache_key_t key;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&ctl->next, 1, __ATOMIC_RELAXED))
+	       < ctl->prof->n) {
+		key = ctl->prof->ent[i].key;
+		pio.ctx = ctx;
+		pio.addr.addr = key & ~(cache_key_t)page_mask;
+		pio.addr.as = key & page_mask;
+		if (get_page(&pio) == KDUMP_OK)
+			put_page(&pio);
+	}
+	return NULL;
+}
+
+/**  Warm up the page cache from a profile.
+ * @param ctx  Dump file object.
+ *
+ * If a profile file is set, read the pages listed there into the page
+ * cache. Pages are read in parallel, using separate worker contexts.
+ * A missing or invalid profile is not an error.
+ *
+ * The caller must hold the shared lock.
+ */
+void
+cache_profile_load(kdump_ctx_t *ctx)
+{
+	struct profile prof = { NULL, 0, 0 };
+	struct prefetch_ctl ctl;
+	struct prefetch_worker self;
+	unsigned nworkers = 0;
+#if USE_PTHREAD
+	struct prefetch_worker workers[PREFETCH_THREADS - 1];
+	unsigned i;
+#endif
+
+	if (!ctx->shared->profile_path || !ctx->shared->cache ||
+	    profile_read(ctx, &prof, get_cache_size(ctx)) || !prof.n)
+		goto out;
+
+	ctl.prof = &prof;
+	ctl.next = 0;
+
+#if USE_PTHREAD
+	while (nworkers < PREFETCH_THREADS - 1 && nworkers + 1 < prof.n) {
+		struct prefetch_worker *worker = &workers[nworkers];
+		worker->ctl = &ctl;
+		worker->ctx = worker_ctx_new(ctx);
+		if (!worker->ctx)
+			break;
+		if (pthread_create(&worker->tid, NULL,
+				   prefetch_worker, worker)) {
+			worker_ctx_free(worker->ctx);
+			break;
+		}
+		++nworkers;
+	}
+#endif
+
+	self.ctl = &ctl;
+	self.ctx = worker_ctx_new(ctx);
+	if (self.ctx) {
+		prefetch_worker(&self);
+		worker_ctx_free(self.ctx);
+	}
+
+#if USE_PTHREAD
+	for (i = 0; i < nworkers; ++i) {
+		pthread_join(workers[i].tid, NULL);
+		worker_ctx_free(workers[i].ctx);
+	}
+#endif
+
+ out:
+	free(prof.ent);
+}
+
+static kdump_status
+cache_profile_post_hook(kdump_ctx_t *ctx, struct attr_data *attr)
+{
+	char *path = strdup(attr_value(attr)->string);
+
+	if (!path)
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate profile path");
+	free(ctx->shared->profile_path);
+	ctx->shared->profile_path = path;
+	return KDUMP_OK;
+}
+
+static void
+cache_profile_clear_hook(kdump_ctx_t *ctx, struct attr_data *attr)
+{
+	free(ctx->shared->profile_path);
+	ctx->shared->profile_path = NULL;
+}
+
+const struct attr_ops cache_profile_ops = {
+	.post_set = cache_profile_post_hook,
+	.pre_clear = cache_profile_clear_hook,
+};
@@ -34,8 +34,107 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 
-/** Get a page from the default cache.
+/**  Allocate the shared zero page.
+ * @param ctx  Dump file object.
+ * @returns    Error status.
+ *
+ * The zero page is (re-)allocated to match the current page size. It is
+ * mapped read-only from anonymous memory, so it does not take up any
+ * physical memory.
+ */
+kdump_status
+alloc_zero_page(kdump_ctx_t *ctx)
+{
+	size_t size = get_page_size(ctx);
+	void *page;
+
+	if (ctx->shared->zero_page && ctx->shared->zero_page_size == size)
+		return KDUMP_OK;
+
+	page = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (page == MAP_FAILED)
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate zero page");
+
+	free_zero_page(ctx->shared);
+	ctx->shared->zero_page = page;
+	ctx->shared->zero_page_size = size;
+	return KDUMP_OK;
+}
+
+/**  Free the shared zero page.
+ * @param shared  Shared data of a dump file object.
+ */
+void
+free_zero_page(struct kdump_shared *shared)
+{
+	if (shared->zero_page) {
+		munmap(shared->zero_page, shared->zero_page_size);
+		shared->zero_page = NULL;
+	}
+}
+
+/**  Get the shared zero page.
+ * @param pio  Page I/O control.
+ * @returns    Always @ref KDUMP_OK.
+ *
+ * Format-specific @c get_page methods may call this function to return
+ * a page filled with zeros without using a page cache slot.
+ *
+ * Read functions called by @ref cache_get_page may also call it instead
+ * of filling the page with zeros. The cache slot is then released.
+ */
+kdump_status
+get_zero_page(struct page_io *pio)
+{
+	pio->chunk.data = pio->ctx->shared->zero_page;
+	pio->chunk.nent = 1;
+	pio->chunk.embed_fces->cache = NULL;
+	pio->chunk.embed_fces->ce = NULL;
+	return KDUMP_OK;
+}
+
+/**  Get the scratch buffer of a dump file object.
+ * @param ctx   Dump file object.
+ * @param size  Minimum buffer size.
+ * @returns     Scratch buffer, or @c NULL if allocation fails.
+ *
+ * The buffer is grown as needed, but it is never smaller than a page,
+ * so decompressing pages does not allocate memory after the first call.
+ * Contents of the buffer are not preserved when it grows.
+ */
+void *
+get_scratch(kdump_ctx_t *ctx, size_t size)
+{
+	size_t pagesz = get_page_size(ctx);
+
+	if (size <= ctx->scratchsz)
+		return ctx->scratch;
+
+	if (size < pagesz)
+		size = pagesz;
+	free(ctx->scratch);
+	ctx->scratch = malloc(size);
+	ctx->scratchsz = ctx->scratch ? size : 0;
+	return ctx->scratch;
+}
+
+/**  Check whether a page is the shared zero page.
+ * @param ctx   Dump file object.
+ * @param data  Page data.
+ * @returns     @c true if @p data is the shared zero page, or if the
+ *              page contains only zeros.
+ */
+static inline bool
+is_zero_page(kdump_ctx_t *ctx, const void *data)
+{
+	return data == ctx->shared->zero_page ||
+		!memcmp(data, ctx->shared->zero_page, get_page_size(ctx));
+}
+
+/** Get a page from the shared page cache.
  *
  * @param pio  Page I/O control.
  * @param fn   Read function.
@@ -44,18 +143,27 @@
  * If the page is not currently found in the cache, read it using
  * the read function.
  */
-kdump_status
-cache_get_page(struct page_io *pio, read_page_fn *fn)
+static kdump_status
+get_shared_page(struct page_io *pio, read_page_fn *fn)
 {
 	kdump_ctx_t *ctx = pio->ctx;
 	struct cache_entry *entry;
+	cache_key_t key = pio->addr.addr | pio->addr.as;
 	kdump_status ret;
 
-	mutex_lock(&ctx->shared->cache_lock);
 	pio->chunk.nent = 1;
 	pio->chunk.embed_fces->cache = ctx->shared->cache;
-	entry = cache_get_entry(pio->chunk.embed_fces->cache,
-				pio->addr.addr | pio->addr.as);
+
+	/* Cache hits do not need the lock. */
+	entry = cache_get_entry_fast(ctx->shared->cache, key);
+	if (entry) {
+		pio->chunk.data = entry->data;
+		pio->chunk.embed_fces->ce = entry;
+		return KDUMP_OK;
+	}
+
+	mutex_lock(&ctx->shared->cache_lock);
+	entry = cache_get_entry(ctx->shared->cache, key);
 	mutex_unlock(&ctx->shared->cache_lock);
 	if (!entry)
 		return set_error(ctx, KDUMP_ERR_BUSY,
@@ -67,15 +175,105 @@ cache_get_page(struct page_io *pio, read_page_fn *fn)
 		return KDUMP_OK;
 
 	ret = fn(pio);
+	if (ret == KDUMP_OK && is_zero_page(ctx, pio->chunk.data)) {
+		/* Do not waste a cache slot on a zero page. */
+		mutex_lock(&ctx->shared->cache_lock);
+		cache_discard(ctx->shared->cache, entry);
+		mutex_unlock(&ctx->shared->cache_lock);
+		return get_zero_page(pio);
+	}
+
 	mutex_lock(&ctx->shared->cache_lock);
 	if (ret == KDUMP_OK)
-		cache_insert(pio->chunk.embed_fces->cache, entry);
+		cache_insert(ctx->shared->cache, entry);
 	else
-		cache_discard(pio->chunk.embed_fces->cache, entry);
+		cache_discard(ctx->shared->cache, entry);
 	mutex_unlock(&ctx->shared->cache_lock);
 	return ret;
 }
 
+/** Get the private page cache of a dump file object.
+ *
+ * @param ctx  Dump file object.
+ * @returns    Private cache, or @c NULL if not used.
+ *
+ * The private cache is (re-)allocated lazily if the shared page cache
+ * has changed since the last call, so it never contains stale pages.
+ * Failure to allocate the private cache is not an error.
+ */
+static struct cache *
+get_l1_cache(kdump_ctx_t *ctx)
+{
+	unsigned size;
+
+	if (ctx->l1gen == ctx->shared->cache_gen)
+		return ctx->l1cache;
+
+	if (ctx->l1cache) {
+		cache_free(ctx->l1cache);
+		ctx->l1cache = NULL;
+	}
+	ctx->l1gen = ctx->shared->cache_gen;
+
+	size = get_cache_l1_size(ctx);
+	if (size && ctx->shared->cache)
+		ctx->l1cache = cache_alloc(size, get_page_size(ctx),
+					   KDUMP_ARENA_MALLOC);
+	return ctx->l1cache;
+}
+
+/** Get a page from the default cache.
+ *
+ * @param pio  Page I/O control.
+ * @param fn   Read function.
+ * @returns    Error status.
+ *
+ * If the dump file object has a private cache, look up the page there
+ * first. On a miss, the page is copied from the shared page cache (or
+ * read using the read function) into the private cache.
+ *
+ * Pages which contain only zeros are not cached. The shared zero page
+ * is returned instead.
+ */
+kdump_status
+cache_get_page(struct page_io *pio, read_page_fn *fn)
+{
+	struct cache *l1 = get_l1_cache(pio->ctx);
+	struct cache_entry *entry;
+	struct page_io spio;
+	kdump_status ret;
+
+	if (!l1)
+		return get_shared_page(pio, fn);
+
+	entry = cache_get_entry(l1, pio->addr.addr | pio->addr.as);
+	if (!entry)
+		return get_shared_page(pio, fn);
+
+	if (!cache_entry_valid(entry)) {
+		spio.ctx = pio->ctx;
+		spio.addr = pio->addr;
+		ret = get_shared_page(&spio, fn);
+		if (ret != KDUMP_OK) {
+			cache_discard(l1, entry);
+			return ret;
+		}
+		if (spio.chunk.data == pio->ctx->shared->zero_page) {
+			cache_discard(l1, entry);
+			return get_zero_page(pio);
+		}
+		memcpy(entry->data, spio.chunk.data, get_page_size(pio->ctx));
+		fcache_put_chunk(&spio.chunk);
+		cache_insert(l1, entry);
+	}
+
+	pio->chunk.data = entry->data;
+	pio->chunk.nent = 1;
+	pio->chunk.embed_fces->cache = l1;
+	pio->chunk.embed_fces->ce = entry;
+	return KDUMP_OK;
+}
+
 /**  Drop a reference to an I/O page from the default cache.
  * @param pio  Page I/O control.
  */
@@ -137,21 +335,16 @@ get_page_maybe_xlat(struct page_io *pio)
 		: get_page_xlat(pio);
 }
 
-/**  Internal version of @ref kdump_read
+/**  Read a range of addresses page by page.
  * @param         ctx      Dump file object.
  * @param[in]     as       Address space of @p addr.
  * @param[in]     addr     Any type of address.
  * @param[out]    buffer   Buffer to receive data.
  * @param[in,out] plength  Length of the buffer.
  * @returns                Error status.
- *
- * Use this function internally if the shared lock is already held
- * (for reading or writing).
- *
- * @sa kdump_read
  */
-kdump_status
-read_locked(kdump_ctx_t *ctx, kdump_addrspace_t as, kdump_addr_t addr,
+static kdump_status
+read_serial(kdump_ctx_t *ctx, kdump_addrspace_t as, kdump_addr_t addr,
 	    void *buffer, size_t *plength)
 {
 	struct page_io pio;
@@ -185,6 +378,388 @@ read_locked(kdump_ctx_t *ctx, kdump_addrspace_t as, kdump_addr_t addr,
 	return ret;
 }
 
+#if USE_PTHREAD
+
+/** Minimum number of pages read by one thread. */
+#define READ_STRIPE_PAGES	16
+
+/**  Part of a range read by one thread.
+ */
+struct read_stripe {
+	kdump_ctx_t *ctx;	 /**< Dump file object of the caller. */
+	kdump_addrspace_t as;	 /**< Address space. */
+	kdump_addr_t addr;	 /**< First address of the stripe. */
+	char *buffer;		 /**< Target buffer. */
+	size_t length;		 /**< Length on input, bytes read on output. */
+	kdump_status status;	 /**< Result of the read. */
+	char *err;		 /**< Error message, or @c NULL. */
+	bool done;		 /**< Set after the stripe has been read. */
+
+	/** Next stripe in the queue of a @ref read_pool. */
+	struct read_stripe *next;
+};
+
+/**  Worker thread of a @ref read_pool.
+ */
+struct read_worker {
+	struct read_pool *pool;	 /**< Pool of this worker. */
+	kdump_ctx_t *ctx;	 /**< Worker context. */
+	pthread_t tid;		 /**< Worker thread. */
+};
+
+/**  Worker threads for parallel reads.
+ *
+ * The pool is allocated on first use and kept until the shared data
+ * is freed or per-context data is changed, so threads and worker
+ * contexts are not created for every read.
+ */
+struct read_pool {
+	mutex_t lock;		 /**< Guard the queue and stripe state. */
+	cond_t work;		 /**< Signalled when stripes are queued. */
+	cond_t done;		 /**< Signalled when a stripe is done. */
+
+	struct read_stripe *head;  /**< First queued stripe. */
+	struct read_stripe **tail; /**< Link to the next queued stripe. */
+
+	bool stop;		 /**< Set to terminate worker threads. */
+	unsigned nworkers;	 /**< Number of worker threads. */
+	struct read_worker workers[READ_THREADS - 1];
+};
+
+/**  Read one stripe.
+ * @param ctx     Dump file object used for reading.
+ * @param stripe  Stripe to be read.
+ *
+ * If the read fails, the error message is saved in the stripe, and
+ * the error message of @p ctx is cleared.
+ */
+static void
+read_stripe(kdump_ctx_t *ctx, struct read_stripe *stripe)
+{
+	stripe->status = read_serial(ctx, stripe->as, stripe->addr,
+				     stripe->buffer, &stripe->length);
+	if (stripe->status != KDUMP_OK) {
+		stripe->err = strdup(kdump_get_err(ctx));
+		clear_error(ctx);
+	}
+}
+
+/**  Read pool worker thread.
+ * @param arg  Worker (@ref read_worker).
+ * @returns    Always @c NULL.
+ *
+ * The worker context borrows the dictionary and translation of the
+ * dump file object which queued the stripe, and drops them when the
+ * stripe is done. That dump file object holds the shared lock until
+ * all its stripes are done, so the worker context is used only under
+ * the shared lock, as required by @ref worker_ctx_new.
+ */
+static void *
+read_worker(void *arg)
+{
+	struct read_worker *worker = arg;
+	struct read_pool *pool = worker->pool;
+	kdump_ctx_t *ctx = worker->ctx;
+	struct read_stripe *stripe;
+
+	mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->head && !pool->stop)
+			cond_wait(&pool->work, &pool->lock);
+		if (!pool->head)
+			break;
+		stripe = pool->head;
+		pool->head = stripe->next;
+		if (!pool->head)
+			pool->tail = &pool->head;
+		mutex_unlock(&pool->lock);
+
+		ctx->dict = stripe->ctx->dict;
+		ctx->xlat = stripe->ctx->xlat;
+		ctx->l1gen = ctx->shared->cache_gen;
+		clear_error(ctx);
+		read_stripe(ctx, stripe);
+		ctx->dict = NULL;
+		ctx->xlat = NULL;
+
+		mutex_lock(&pool->lock);
+		stripe->done = true;
+		cond_broadcast(&pool->done);
+	}
+	mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/**  Stop all worker threads and free a read pool.
+ * @param pool  Read pool.
+ */
+static void
+destroy_read_pool(struct read_pool *pool)
+{
+	unsigned i;
+
+	mutex_lock(&pool->lock);
+	pool->stop = true;
+	cond_broadcast(&pool->work);
+	mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->nworkers; ++i) {
+		pthread_join(pool->workers[i].tid, NULL);
+		worker_ctx_free(pool->workers[i].ctx);
+	}
+	cond_destroy(&pool->done);
+	cond_destroy(&pool->work);
+	mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+/**  Allocate a read pool.
+ * @param ctx  Dump file object.
+ * @returns    Read pool, or @c NULL if no worker can be started.
+ */
+static struct read_pool *
+read_pool_new(kdump_ctx_t *ctx)
+{
+	struct read_pool *pool;
+
+	pool = calloc(1, sizeof *pool);
+	if (!pool)
+		return NULL;
+	if (mutex_init(&pool->lock, NULL))
+		goto err_free;
+	if (cond_init(&pool->work, NULL))
+		goto err_lock;
+	if (cond_init(&pool->done, NULL))
+		goto err_work;
+	pool->tail = &pool->head;
+
+	while (pool->nworkers < READ_THREADS - 1) {
+		struct read_worker *worker = &pool->workers[pool->nworkers];
+		worker->pool = pool;
+		worker->ctx = worker_ctx_new(ctx);
+		if (!worker->ctx)
+			break;
+		/* Borrowed for each stripe, because @p ctx may go away. */
+		worker->ctx->dict = NULL;
+		worker->ctx->xlat = NULL;
+		if (pthread_create(&worker->tid, NULL, read_worker, worker)) {
+			worker_ctx_free(worker->ctx);
+			break;
+		}
+		++pool->nworkers;
+	}
+	if (pool->nworkers)
+		return pool;
+
+	cond_destroy(&pool->done);
+ err_work:
+	cond_destroy(&pool->work);
+ err_lock:
+	mutex_destroy(&pool->lock);
+ err_free:
+	free(pool);
+	return NULL;
+}
+
+/**  Get the read pool of a dump file object.
+ * @param ctx  Dump file object.
+ * @returns    Read pool, or @c NULL if it cannot be allocated.
+ *
+ * The read pool is allocated on first use. Since the caller holds the
+ * shared lock only for reading, a concurrent reader may allocate the
+ * pool at the same time. The loser of the race frees its own pool.
+ */
+static struct read_pool *
+get_read_pool(kdump_ctx_t *ctx)
+{
+	struct read_pool *pool, *old;
+
+	pool = __atomic_load_n(&ctx->shared->read_pool, __ATOMIC_ACQUIRE);
+	if (pool)
+		return pool;
+
+	pool = read_pool_new(ctx);
+	if (!pool)
+		return NULL;
+	old = NULL;
+	if (!__atomic_compare_exchange_n(&ctx->shared->read_pool, &old, pool,
+					 false, __ATOMIC_ACQ_REL,
+					 __ATOMIC_ACQUIRE)) {
+		destroy_read_pool(pool);
+		pool = old;
+	}
+	return pool;
+}
+
+/**  Split a range of addresses at dump file boundaries.
+ * @param         ctx      Dump file object.
+ * @param[in]     as       Address space of @p addr.
+ * @param[in]     addr     First address of the range.
+ * @param[out]    buffer   Buffer to receive data.
+ * @param[in]     length   Length of the range.
+ * @param[out]    stripes  Array of @ref READ_THREADS stripes.
+ * @returns                Number of used stripes.
+ *
+ * A new stripe is started at every boundary reported by the
+ * @c file_end_pfn format method, unless the current stripe is shorter
+ * than @ref READ_STRIPE_PAGES, or all stripes are already used.
+ */
+static unsigned
+split_read(kdump_ctx_t *ctx, kdump_addrspace_t as, kdump_addr_t addr,
+	   char *buffer, size_t length, struct read_stripe *stripes)
+{
+	unsigned shift = get_page_shift(ctx);
+	size_t minlen = (size_t)READ_STRIPE_PAGES << shift;
+	unsigned n = 0;
+
+	while (length) {
+		kdump_pfn_t end =
+			ctx->shared->ops->file_end_pfn(ctx, addr >> shift);
+		size_t len = length;
+
+		if (end <= (addr + length - 1) >> shift)
+			len = (end << shift) - addr;
+
+		if (!n || (stripes[n - 1].length >= minlen &&
+			   n < READ_THREADS)) {
+			struct read_stripe *stripe = &stripes[n++];
+			stripe->ctx = ctx;
+			stripe->as = as;
+			stripe->addr = addr;
+			stripe->buffer = buffer;
+			stripe->length = 0;
+			stripe->err = NULL;
+			stripe->done = false;
+		}
+		stripes[n - 1].length += len;
+
+		addr += len;
+		buffer += len;
+		length -= len;
+	}
+
+	return n;
+}
+
+/**  Read stripes concurrently.
+ * @param      ctx      Dump file object.
+ * @param      pool     Read pool.
+ * @param      stripes  Stripes to be read.
+ * @param[in]  n        Number of stripes.
+ * @param[out] plength  Set to the number of bytes read.
+ * @returns             Error status.
+ *
+ * The first stripe is read by the calling thread, all other stripes
+ * are queued for the pool workers. The file cache does not serialize
+ * reads from different files, so this is faster if the stripes are
+ * stored in different files.
+ *
+ * The result is the same as if the range was read sequentially, i.e.
+ * on failure, @p plength is set to the number of bytes before the first
+ * error, and the error of the first failed stripe is returned.
+ */
+static kdump_status
+read_parallel(kdump_ctx_t *ctx, struct read_pool *pool,
+	      struct read_stripe *stripes, unsigned n, size_t *plength)
+{
+	struct read_stripe *stripe;
+	size_t done;
+	kdump_status ret;
+	unsigned i;
+
+	mutex_lock(&pool->lock);
+	for (i = 1; i < n; ++i) {
+		stripes[i].next = NULL;
+		*pool->tail = &stripes[i];
+		pool->tail = &stripes[i].next;
+	}
+	cond_broadcast(&pool->work);
+	mutex_unlock(&pool->lock);
+
+	read_stripe(ctx, &stripes[0]);
+
+	mutex_lock(&pool->lock);
+	for (i = 1; i < n; ++i)
+		while (!stripes[i].done)
+			cond_wait(&pool->done, &pool->lock);
+	mutex_unlock(&pool->lock);
+
+	ret = KDUMP_OK;
+	done = 0;
+	for (i = 0; i < n; ++i) {
+		stripe = &stripes[i];
+		if (ret == KDUMP_OK) {
+			done += stripe->length;
+			ret = stripe->status;
+			if (ret != KDUMP_OK)
+				status_err(&ctx->err, ret, "%s", stripe->err
+					   ? stripe->err
+					   : kdump_strerror(ret));
+		}
+		free(stripe->err);
+	}
+
+	*plength = done;
+	return ret;
+}
+
+#endif	/* USE_PTHREAD */
+
+/**  Free the read pool.
+ * @param shared  Dump file shared data.
+ *
+ * This function stops all worker threads for parallel reads. The
+ * caller must ensure that no read is in progress, e.g. by holding
+ * the shared lock for writing.
+ */
+void
+read_pool_free(struct kdump_shared *shared)
+{
+#if USE_PTHREAD
+	if (shared->read_pool) {
+		destroy_read_pool(shared->read_pool);
+		shared->read_pool = NULL;
+	}
+#endif
+}
+
+/**  Internal version of @ref kdump_read
+ * @param         ctx      Dump file object.
+ * @param[in]     as       Address space of @p addr.
+ * @param[in]     addr     Any type of address.
+ * @param[out]    buffer   Buffer to receive data.
+ * @param[in,out] plength  Length of the buffer.
+ * @returns                Error status.
+ *
+ * Use this function internally if the shared lock is already held
+ * (for reading or writing).
+ *
+ * @sa kdump_read
+ */
+kdump_status
+read_locked(kdump_ctx_t *ctx, kdump_addrspace_t as, kdump_addr_t addr,
+	    void *buffer, size_t *plength)
+{
+#if USE_PTHREAD
+	/* Worker contexts cannot translate addresses. */
+	if (get_num_files(ctx) > 1 &&
+	    ctx->shared->ops && ctx->shared->ops->file_end_pfn &&
+	    (ctx->xlat->xlat_caps & ADDRXLAT_CAPS(as)) &&
+	    *plength >> get_page_shift(ctx) >= 2 * READ_STRIPE_PAGES) {
+		struct read_stripe stripes[READ_THREADS];
+		struct read_pool *pool;
+		unsigned n;
+
+		n = split_read(ctx, as, addr, buffer, *plength, stripes);
+		if (n > 1 && (pool = get_read_pool(ctx)))
+			return read_parallel(ctx, pool, stripes, n, plength);
+	}
+#endif
+
+	return read_serial(ctx, as, addr, buffer, plength);
+}
+
 kdump_status
 kdump_read(kdump_ctx_t *ctx, kdump_addrspace_t as, kdump_addr_t addr,
 	    void *buffer, size_t *plength)
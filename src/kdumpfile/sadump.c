@@ -310,6 +310,11 @@ struct sadump_disk_extents {
 	/** Length of page data (in bytes). */
 	off_t data_len;
 
+	/** Offset of the first page data byte in the whole disk set,
+	 * i.e. sum of @c data_len of all preceding disks.
+	 */
+	off_t data_start;
+
 	/** File index in file cache. */
 	unsigned fidx;
 };
@@ -576,6 +581,76 @@ read_bitmap(kdump_ctx_t *ctx, struct pfn_file_map *pfm,
 	return ret;
 }
 
+/** Find the disk which holds a given page data offset.
+ * @param sp   SADUMP private data.
+ * @param pos  Offset in the page data of the whole disk set.
+ * @returns    Extents of the disk, or @c NULL if @p pos is out of bounds.
+ */
+static const struct sadump_disk_extents *
+find_disk(const struct sadump_priv *sp, off_t pos)
+{
+	unsigned left = 0, right = sp->num_files;
+	while (left != right) {
+		unsigned mid = (left + right) / 2;
+		const struct sadump_disk_extents *ext = sp->ext + mid;
+		if (pos < ext->data_start)
+			right = mid;
+		else if (pos >= ext->data_start + ext->data_len)
+			left = mid + 1;
+		else
+			return ext;
+	}
+	return NULL;
+}
+
+/** Find the end of a disk's PFN range.
+ * @param ctx  Dump file object.
+ * @param pfn  Page frame number.
+ * @returns    First PFN above @p pfn which is stored on another disk.
+ *
+ * Page data is stored in PFN order, so all pages between @p pfn and
+ * the returned PFN are either excluded or stored on the same disk.
+ */
+static kdump_pfn_t
+sadump_file_end_pfn(kdump_ctx_t *ctx, kdump_pfn_t pfn)
+{
+	struct sadump_priv *sp = ctx->shared->fmtdata;
+	size_t page_size = get_page_size(ctx);
+	const struct sadump_disk_extents *ext;
+	const struct pfn_region *rgn;
+	size_t left, right;
+	off_t end;
+
+	rgn = find_pfn_region(&sp->pfm, pfn);
+	if (!rgn)
+		return KDUMP_PFN_MAX;
+	if (pfn < rgn->pfn)
+		pfn = rgn->pfn;
+	ext = find_disk(sp, rgn->pos + (pfn - rgn->pfn) * page_size);
+	if (!ext)
+		return KDUMP_PFN_MAX;
+	end = ext->data_start + ext->data_len;
+
+	/* Find the first region which does not end on this disk. */
+	left = rgn - sp->pfm.regions;
+	right = sp->pfm.nregions;
+	while (left != right) {
+		size_t mid = (left + right) / 2;
+		rgn = sp->pfm.regions + mid;
+		if (rgn->pos + rgn->cnt * page_size <= end)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	if (right >= sp->pfm.nregions)
+		return KDUMP_PFN_MAX;
+
+	rgn = sp->pfm.regions + right;
+	return rgn->pos < end
+		? rgn->pfn + (end - rgn->pos + page_size - 1) / page_size
+		: rgn->pfn;
+}
+
 static kdump_status
 sadump_read_page(struct page_io *pio)
 {
@@ -583,7 +658,7 @@ sadump_read_page(struct page_io *pio)
 	struct sadump_priv *sp = ctx->shared->fmtdata;
 	kdump_pfn_t pfn = pio->addr.addr >> get_page_shift(ctx);
 	const struct pfn_region *rgn;
-	unsigned disknum;
+	const struct sadump_disk_extents *ext;
 	off_t pos;
 	kdump_status ret;
 
@@ -592,31 +667,23 @@ sadump_read_page(struct page_io *pio)
 
 	if (!(rgn = find_pfn_region(&sp->pfm, pfn)) ||
 	    pfn < rgn->pfn) {
-		if (get_zero_excluded(ctx)) {
-			memset(pio->chunk.data, 0, get_page_size(ctx));
-			return KDUMP_OK;
-		}
+		if (get_zero_excluded(ctx))
+			return get_zero_page(pio);
 		return set_error(ctx, KDUMP_ERR_NODATA, "Excluded page");
 	}
 
-	disknum = 0;
-	pos = rgn->pos;
-	while (pos >= sp->ext[disknum].data_len) {
-		pos -= sp->ext[disknum].data_len;
-		if (++disknum >= sp->num_files)
-			return set_error(ctx, KDUMP_ERR_NODATA,
-					 "Out-of-bounds PFN");
-	}
-	pos += sp->ext[disknum].data_pos;
+	pos = rgn->pos + (pfn - rgn->pfn) * get_page_size(ctx);
+	ext = find_disk(sp, pos);
+	if (!ext)
+		return set_error(ctx, KDUMP_ERR_NODATA, "Out-of-bounds PFN");
 
-	mutex_lock(&ctx->shared->cache_lock);
 	ret = fcache_pread(ctx->shared->fcache, pio->chunk.data,
-			   get_page_size(ctx), sp->ext[disknum].fidx, pos);
-	mutex_unlock(&ctx->shared->cache_lock);
+			   get_page_size(ctx), ext->fidx,
+			   ext->data_pos + (pos - ext->data_start));
 	if (ret != KDUMP_OK)
 		return set_error(ctx, ret,
 				 "Cannot read page data at %llu",
-				 (unsigned long long) rgn->pos);
+				 (unsigned long long) pos);
 
 	return KDUMP_OK;
 }
@@ -624,6 +691,16 @@ sadump_read_page(struct page_io *pio)
 static kdump_status
 sadump_get_page(struct page_io *pio)
 {
+	kdump_ctx_t *ctx = pio->ctx;
+	struct sadump_priv *sp = ctx->shared->fmtdata;
+	kdump_pfn_t pfn = pio->addr.addr >> get_page_shift(ctx);
+	const struct pfn_region *rgn;
+
+	/* Excluded pages need not go through the cache. */
+	if (get_zero_excluded(ctx) && pfn < get_max_pfn(ctx) &&
+	    (!(rgn = find_pfn_region(&sp->pfm, pfn)) || pfn < rgn->pfn))
+		return get_zero_page(pio);
+
 	return cache_get_page(pio, sadump_read_page);
 }
 
@@ -1121,6 +1198,9 @@ sadump_probe(kdump_ctx_t *ctx)
 		}
 	}
 	sp = ctx->shared->fmtdata;
+	for (fidx = 1; fidx < sp->num_files; ++fidx)
+		sp->ext[fidx].data_start = sp->ext[fidx - 1].data_start +
+			sp->ext[fidx - 1].data_len;
 
 	status = read_bitmap(ctx, &sp->pfm, sp->ext[0].fidx,
 			     dsi.bmp_pos, sp->ext[0].data_pos - dsi.bmp_pos);
@@ -1174,6 +1254,7 @@ const struct format_ops sadump_ops = {
 	.probe = sadump_probe,
 	.get_page = sadump_get_page,
 	.put_page = cache_put_page,
+	.file_end_pfn = sadump_file_end_pfn,
 	.realloc_caches = def_realloc_caches,
 	.attr_cleanup = sadump_attr_cleanup,
 	.cleanup = sadump_cleanup,
@@ -40,6 +40,40 @@
 
 #define CACHE_SIZE  8
 
+/** Cache size for the random access test. */
+#define RND_CACHE_SIZE	64
+/** Number of distinct keys in the random access test. */
+#define RND_KEYS	256
+/** Number of references held during the random access test. */
+#define RND_HELD	8
+/** Number of lookups in the random access test. */
+#define RND_ROUNDS	100000
+
+/** Cache size for the large cache test.
+ * This is big enough to make a linear search prohibitively slow.
+ */
+#define LARGE_CACHE_SIZE	(1U << 18)
+
+/** Initial size for the adaptive sizing test. */
+#define ADAPT_CACHE_SIZE	8
+/** Size limit for the adaptive sizing test. */
+#define ADAPT_LIMIT		32
+
+/** Size of the arena test allocations. */
+#define ARENA_SIZE	(8UL << 20)
+
+/** Cache size for the lock-free lookup test. */
+#define FAST_CACHE_SIZE	4
+
+/** Number of threads in the concurrent lookup test. */
+#define STRESS_THREADS		4
+/** Cache size for the concurrent lookup test. */
+#define STRESS_CACHE_SIZE	64
+/** Number of distinct keys in the concurrent lookup test. */
+#define STRESS_KEYS		96
+/** Number of lookups per thread in the concurrent lookup test. */
+#define STRESS_ROUNDS		200000
+
 static void
 poison_stack(void)
 {
@@ -51,14 +85,502 @@ poison_stack(void)
 	__asm__ volatile("" :: "g" (largearray) : "memory");
 }
 
+static unsigned long rnd_state = 1;
+
+static unsigned
+rnd(void)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return (rnd_state >> 16) & 0x7fff;
+}
+
+/* Check that cached data matches keys under a random access pattern,
+ * and that referenced entries are never evicted.
+ */
+static int
+check_random(void)
+{
+	struct cache *cache;
+	struct cache_entry *entry;
+	struct cache_entry *held[RND_HELD];
+	cache_key_t key;
+	unsigned i, j;
+	int rc = TEST_OK;
+
+	cache = cache_alloc(RND_CACHE_SIZE, sizeof(cache_key_t),
+			    KDUMP_ARENA_MALLOC);
+	if (!cache) {
+		perror("Cannot allocate cache");
+		return TEST_ERR;
+	}
+
+	for (i = 0; i < RND_HELD; ++i)
+		held[i] = NULL;
+
+	for (i = 0; i < RND_ROUNDS && rc == TEST_OK; ++i) {
+		key = rnd() % RND_KEYS;
+		entry = cache_get_entry(cache, key);
+		if (!entry) {
+			fprintf(stderr, "Cannot get entry %u\n",
+				(unsigned) key);
+			rc = TEST_FAIL;
+			break;
+		}
+		if (entry->key != key) {
+			fprintf(stderr, "Wrong key 0x%llx for 0x%llx\n",
+				(unsigned long long) entry->key,
+				(unsigned long long) key);
+			rc = TEST_FAIL;
+		}
+		if (!cache_entry_valid(entry)) {
+			if (rnd() % 8 == 0) {
+				cache_discard(cache, entry);
+				continue;
+			}
+			*(cache_key_t *)entry->data = key;
+			cache_insert(cache, entry);
+		}
+
+		j = i % RND_HELD;
+		if (held[j])
+			cache_put_entry(cache, held[j]);
+		held[j] = entry;
+
+		for (j = 0; j < RND_HELD; ++j)
+			if (held[j] &&
+			    *(cache_key_t *)held[j]->data != held[j]->key) {
+				fprintf(stderr, "Data mismatch for 0x%llx\n",
+					(unsigned long long) held[j]->key);
+				rc = TEST_FAIL;
+			}
+	}
+
+	for (j = 0; j < RND_HELD; ++j)
+		if (held[j])
+			cache_put_entry(cache, held[j]);
+	cache_free(cache);
+	return rc;
+}
+
+/* Fill a large cache and look up every entry again. */
+static int
+check_large(void)
+{
+	struct cache *cache;
+	struct cache_entry *entry;
+	unsigned i;
+
+	cache = cache_alloc(LARGE_CACHE_SIZE, 0, KDUMP_ARENA_MALLOC);
+	if (!cache) {
+		perror("Cannot allocate large cache");
+		return TEST_ERR;
+	}
+
+	for (i = 0; i < LARGE_CACHE_SIZE; ++i) {
+		entry = cache_get_entry(cache, (cache_key_t)i << 12);
+		if (!entry || cache_entry_valid(entry)) {
+			fprintf(stderr, "Unexpected lookup result for %u\n",
+				i);
+			return TEST_FAIL;
+		}
+		cache_insert(cache, entry);
+		cache_put_entry(cache, entry);
+	}
+
+	for (i = 0; i < LARGE_CACHE_SIZE; ++i) {
+		entry = cache_get_entry(cache, (cache_key_t)i << 12);
+		if (!entry || !cache_entry_valid(entry)) {
+			fprintf(stderr, "Cached entry %u not found\n", i);
+			return TEST_FAIL;
+		}
+		cache_put_entry(cache, entry);
+	}
+
+	cache_free(cache);
+	return TEST_OK;
+}
+
+/* Access keys 0 to @p nkeys - 1 in a loop. If @p fit is set, check
+ * that all keys are cached afterwards.
+ */
+static int
+cycle_keys(struct cache *cache, unsigned nkeys, bool fit)
+{
+	struct cache_entry *entry;
+	unsigned i, round;
+
+	for (round = 0; round < 64; ++round) {
+		for (i = 0; i < nkeys; ++i) {
+			entry = cache_get_entry(cache, i);
+			if (!entry) {
+				fprintf(stderr, "Cannot get entry %u\n", i);
+				return TEST_FAIL;
+			}
+			if (!cache_entry_valid(entry)) {
+				*(cache_key_t *)entry->data = i;
+				cache_insert(cache, entry);
+			} else if (*(cache_key_t *)entry->data != i) {
+				fprintf(stderr, "Data mismatch for %u\n", i);
+				return TEST_FAIL;
+			}
+			cache_put_entry(cache, entry);
+		}
+	}
+
+	/* The whole working set should fit now. */
+	for (i = 0; fit && i < nkeys; ++i) {
+		entry = cache_get_entry(cache, i);
+		if (!entry)
+			return TEST_FAIL;
+		if (!cache_entry_valid(entry)) {
+			fprintf(stderr, "Entry %u not cached after growth\n",
+				i);
+			cache_discard(cache, entry);
+			return TEST_FAIL;
+		}
+		cache_put_entry(cache, entry);
+	}
+
+	return TEST_OK;
+}
+
+/* Count the number of entries that can be referenced at the same time. */
+static unsigned
+count_capacity(struct cache *cache)
+{
+	struct cache_entry *held[ADAPT_LIMIT + 1];
+	unsigned i, n;
+
+	for (n = 0; n <= ADAPT_LIMIT; ++n) {
+		held[n] = cache_get_entry(cache, 1000 + n);
+		if (!held[n])
+			break;
+		cache_insert(cache, held[n]);
+	}
+	for (i = 0; i < n; ++i)
+		cache_put_entry(cache, held[i]);
+	return n;
+}
+
+/* Check that a thrashing cache grows up to its limit. */
+static int
+check_adaptive(void)
+{
+	static const struct {
+		unsigned nkeys, cap;
+	} steps[] = {
+		{ ADAPT_CACHE_SIZE / 2, ADAPT_CACHE_SIZE },
+		{ ADAPT_CACHE_SIZE * 3 / 2, ADAPT_CACHE_SIZE * 2 },
+		{ ADAPT_CACHE_SIZE * 3, ADAPT_LIMIT },
+		{ ADAPT_LIMIT * 2, ADAPT_LIMIT },
+	};
+	struct cache *cache;
+	unsigned i, n;
+	int rc = TEST_OK;
+
+	cache = cache_alloc(ADAPT_CACHE_SIZE, sizeof(cache_key_t),
+			    KDUMP_ARENA_MALLOC);
+	if (!cache) {
+		perror("Cannot allocate cache");
+		return TEST_ERR;
+	}
+	cache_set_limit(cache, ADAPT_LIMIT);
+
+	for (i = 0; i < ARRAY_SIZE(steps) && rc == TEST_OK; ++i) {
+		rc = cycle_keys(cache, steps[i].nkeys,
+				steps[i].nkeys <= steps[i].cap);
+		n = count_capacity(cache);
+		if (n != steps[i].cap) {
+			fprintf(stderr, "Capacity with %u keys: %u"
+				" (expect %u)\n", steps[i].nkeys,
+				n, steps[i].cap);
+			rc = TEST_FAIL;
+		}
+	}
+
+	cache_free(cache);
+	return rc;
+}
+
+/* Fill a cache with keys @p first to @p first + @p n - 1. */
+static int
+fill_keys(struct cache *cache, unsigned first, unsigned n)
+{
+	struct cache_entry *entry;
+	unsigned i;
+
+	for (i = first; i < first + n; ++i) {
+		entry = cache_get_entry(cache, i);
+		if (!entry) {
+			fprintf(stderr, "Cannot get entry %u\n", i);
+			return TEST_FAIL;
+		}
+		if (!cache_entry_valid(entry)) {
+			*(cache_key_t *)entry->data = i;
+			cache_insert(cache, entry);
+		}
+		cache_put_entry(cache, entry);
+	}
+	return TEST_OK;
+}
+
+/* Check whether a key can be found without the lock. */
+static bool
+fast_cached(struct cache *cache, cache_key_t key)
+{
+	struct cache_entry *entry;
+
+	entry = cache_get_entry_fast(cache, key);
+	if (!entry)
+		return false;
+	if (*(cache_key_t *)entry->data != key) {
+		fprintf(stderr, "Data mismatch for 0x%llx\n",
+			(unsigned long long) key);
+		cache_put_entry(cache, entry);
+		return false;
+	}
+	cache_put_entry(cache, entry);
+	return true;
+}
+
+/* Check lock-free lookups and deferred promotion of hot entries. */
+static int
+check_fast(void)
+{
+	struct cache *cache;
+	struct cache_entry *entry, *held;
+	unsigned i;
+	int rc = TEST_OK;
+
+	cache = cache_alloc(FAST_CACHE_SIZE, sizeof(cache_key_t),
+			    KDUMP_ARENA_MALLOC);
+	if (!cache) {
+		perror("Cannot allocate cache");
+		return TEST_ERR;
+	}
+
+	/* Misses and in-flight entries are not handled. */
+	if (cache_get_entry_fast(cache, 0)) {
+		fprintf(stderr, "Lock-free lookup in an empty cache\n");
+		rc = TEST_FAIL;
+	}
+	entry = cache_get_entry(cache, 0);
+	if (entry && cache_get_entry_fast(cache, 0)) {
+		fprintf(stderr, "Lock-free lookup of an in-flight entry\n");
+		rc = TEST_FAIL;
+	}
+	if (entry)
+		cache_discard(cache, entry);
+
+	/* Key 0 is hit without the lock, so key 1 must be evicted. */
+	if (rc == TEST_OK)
+		rc = fill_keys(cache, 0, FAST_CACHE_SIZE);
+	if (rc == TEST_OK && !fast_cached(cache, 0)) {
+		fprintf(stderr, "Entry 0 not found without lock\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK)
+		rc = fill_keys(cache, FAST_CACHE_SIZE, 1);
+	for (i = 0; i <= FAST_CACHE_SIZE && rc == TEST_OK; ++i)
+		if (fast_cached(cache, i) != (i != 1)) {
+			fprintf(stderr, "Entry %u %s\n", i,
+				i == 1 ? "not evicted" : "not cached");
+			rc = TEST_FAIL;
+		}
+
+	/* Referenced entries stay in the cache. */
+	held = cache_get_entry_fast(cache, 3);
+	if (rc == TEST_OK && !held) {
+		fprintf(stderr, "Cannot reference entry 3\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK)
+		rc = fill_keys(cache, 100, 4 * FAST_CACHE_SIZE);
+	if (held) {
+		if (held->key != 3 || *(cache_key_t *)held->data != 3) {
+			fprintf(stderr, "Referenced entry was reused\n");
+			rc = TEST_FAIL;
+		}
+		cache_put_entry(cache, held);
+	}
+	cache_free(cache);
+	if (rc != TEST_OK)
+		return rc;
+
+	/* No lock-free lookups while a cache can grow. */
+	cache = cache_alloc(ADAPT_CACHE_SIZE, sizeof(cache_key_t),
+			    KDUMP_ARENA_MALLOC);
+	if (!cache) {
+		perror("Cannot allocate cache");
+		return TEST_ERR;
+	}
+	cache_set_limit(cache, ADAPT_LIMIT);
+	rc = fill_keys(cache, 0, 1);
+	if (rc == TEST_OK && fast_cached(cache, 0)) {
+		fprintf(stderr, "Lock-free lookup in a growing cache\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK)
+		rc = cycle_keys(cache, ADAPT_CACHE_SIZE * 3 / 2, true);
+	if (rc == TEST_OK)
+		rc = cycle_keys(cache, ADAPT_CACHE_SIZE * 3, true);
+	if (rc == TEST_OK && !fast_cached(cache, 0)) {
+		fprintf(stderr, "No lock-free lookup after growth\n");
+		rc = TEST_FAIL;
+	}
+	cache_free(cache);
+	return rc;
+}
+
+#if USE_PTHREAD
+
+struct stress_data {
+	struct cache *cache;
+	mutex_t *lock;
+	unsigned long seed;
+	unsigned long fast;
+	int rc;
+};
+
+/* Look up random keys, taking the lock only on a miss. */
+static void *
+stress_thread(void *arg)
+{
+	struct stress_data *data = arg;
+	struct cache_entry *entry;
+	cache_key_t key;
+	unsigned i;
+
+	for (i = 0; i < STRESS_ROUNDS; ++i) {
+		data->seed = data->seed * 1103515245 + 12345;
+		key = (data->seed >> 16) % STRESS_KEYS;
+
+		entry = cache_get_entry_fast(data->cache, key);
+		if (entry)
+			++data->fast;
+		else {
+			mutex_lock(data->lock);
+			entry = cache_get_entry(data->cache, key);
+			mutex_unlock(data->lock);
+			if (!entry) {
+				fprintf(stderr, "Cannot get entry %u\n",
+					(unsigned) key);
+				data->rc = TEST_FAIL;
+				break;
+			}
+			if (!cache_entry_valid(entry)) {
+				*(cache_key_t *)entry->data = key;
+				mutex_lock(data->lock);
+				cache_insert(data->cache, entry);
+				mutex_unlock(data->lock);
+			}
+		}
+
+		if (*(cache_key_t *)entry->data != key) {
+			fprintf(stderr, "Data mismatch for %u\n",
+				(unsigned) key);
+			data->rc = TEST_FAIL;
+		}
+		cache_put_entry(data->cache, entry);
+		if (data->rc != TEST_OK)
+			break;
+	}
+	return NULL;
+}
+
+/* Run concurrent lookups with lock-free hits. */
+static int
+check_threads(void)
+{
+	struct stress_data data[STRESS_THREADS];
+	pthread_t tid[STRESS_THREADS];
+	struct cache *cache;
+	mutex_t lock;
+	unsigned i, n;
+	int rc = TEST_OK;
+
+	cache = cache_alloc(STRESS_CACHE_SIZE, sizeof(cache_key_t),
+			    KDUMP_ARENA_MALLOC);
+	if (!cache) {
+		perror("Cannot allocate cache");
+		return TEST_ERR;
+	}
+	mutex_init(&lock, NULL);
+
+	for (n = 0; n < STRESS_THREADS; ++n) {
+		data[n].cache = cache;
+		data[n].lock = &lock;
+		data[n].seed = n + 1;
+		data[n].fast = 0;
+		data[n].rc = TEST_OK;
+		if (pthread_create(&tid[n], NULL, stress_thread, &data[n])) {
+			perror("Cannot create thread");
+			rc = TEST_ERR;
+			break;
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		pthread_join(tid[i], NULL);
+		if (data[i].rc != TEST_OK)
+			rc = data[i].rc;
+		else if (!data[i].fast) {
+			fprintf(stderr, "No lock-free hits in thread %u\n",
+				i);
+			rc = TEST_FAIL;
+		}
+	}
+
+	mutex_destroy(&lock);
+	cache_free(cache);
+	return rc;
+}
+
+#endif	/* USE_PTHREAD */
+
+/* Allocate, touch and free memory from each arena type. */
+static int
+check_arena(void)
+{
+	static const kdump_cache_arena_t types[] = {
+		KDUMP_ARENA_MALLOC,
+		KDUMP_ARENA_THP,
+		KDUMP_ARENA_HUGETLB,
+	};
+	kdump_cache_arena_t arena;
+	unsigned char *p;
+	size_t off;
+	unsigned i;
+
+	for (i = 0; i < ARRAY_SIZE(types); ++i) {
+		arena = types[i];
+		p = arena_alloc(ARENA_SIZE, &arena);
+		if (!p) {
+			fprintf(stderr, "Cannot allocate arena type %u\n",
+				(unsigned) types[i]);
+			return TEST_FAIL;
+		}
+		if (arena > types[i]) {
+			fprintf(stderr, "Arena type %u upgraded to %u\n",
+				(unsigned) types[i], (unsigned) arena);
+			return TEST_FAIL;
+		}
+		for (off = 0; off < ARENA_SIZE; off += 4096)
+			p[off] = off >> 12;
+		arena_free(p, ARENA_SIZE, arena);
+	}
+
+	return TEST_OK;
+}
+
 int
 main(int argc, char **argv)
 {
 	struct cache *cache;
 	struct cache_entry *entry;
 	unsigned i;
+	int rc;
 
-	cache = cache_alloc(CACHE_SIZE, 0);
+	cache = cache_alloc(CACHE_SIZE, 0, KDUMP_ARENA_MALLOC);
 	if (!cache) {
 		perror("Cannot allocate cache");
 		return TEST_ERR;
@@ -201,5 +723,28 @@ main(int argc, char **argv)
 	cache_put_entry(cache, entry);
 
 	cache_free(cache);
-	return TEST_OK;
+
+	rc = check_random();
+	if (rc != TEST_OK)
+		return rc;
+
+	rc = check_large();
+	if (rc != TEST_OK)
+		return rc;
+
+	rc = check_adaptive();
+	if (rc != TEST_OK)
+		return rc;
+
+	rc = check_fast();
+	if (rc != TEST_OK)
+		return rc;
+
+#if USE_PTHREAD
+	rc = check_threads();
+	if (rc != TEST_OK)
+		return rc;
+#endif
+
+	return check_arena();
 }
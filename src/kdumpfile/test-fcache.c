@@ -64,6 +64,9 @@ static char *mmapbuf;
 
 static int failmmap;
 
+/** Expected size of mmap(2) calls on the dump files. */
+static size_t mmapsize;
+
 #ifdef HAVE_MMAP64
 
 #define STR_MMAP	XSTRINGIFY(mmap64)
@@ -85,7 +88,7 @@ mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 		if (failmmap)
 			return MAP_FAILED;
 
-		if (length != pagesize * (1UL << CACHE_ORDER)) {
+		if (length != mmapsize) {
 			fprintf(stderr, "Incorrect mmap size: %zu\n",
 				length);
 			exitcode = TEST_FAIL;
@@ -96,6 +99,28 @@ mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 	return orig_mmap(addr, length, prot, flags, fd, offset);
 }
 
+#ifdef __GLIBC__
+
+/** Count calls to malloc(3) if non-zero. */
+static int countallocs;
+
+/** Number of counted calls to malloc(3). */
+static unsigned long nallocs;
+
+extern void *__libc_malloc(size_t size);
+
+void *
+malloc(size_t size)
+{
+	if (countallocs)
+		++nallocs;
+	return __libc_malloc(size);
+}
+
+#define HAVE_MALLOC_COUNTER	1
+
+#endif	/* __GLIBC__ */
+
 static void
 prepare_buf(unsigned startpg, unsigned numpg)
 {
@@ -393,6 +418,94 @@ test_chunks(struct fcache *fc)
 	return exitcode;
 }
 
+/* Get chunks with a bounce buffer. Return the number of mismatches. */
+static unsigned
+get_buf_chunks(struct fcache *fc, void *buf)
+{
+	static const struct {
+		unsigned long pgoff;
+		long off;
+		size_t pglen, len;
+	} chunks[] = {
+		{ 0, 8, 0, 16 },
+		{ 1UL << CACHE_ORDER, -8, 0, 16 },
+		{ (1UL << CACHE_ORDER) + 1, -8, 0, 16 },
+		{ (1UL << CACHE_ORDER) + 1, -8, 1, 16 },
+	};
+	struct fcache_chunk fch;
+	unsigned i, bad = 0;
+	kdump_status status;
+
+	for (i = 0; i < ARRAY_SIZE(chunks); ++i) {
+		off_t pos = chunks[i].pgoff * pagesize + chunks[i].off;
+		size_t len = chunks[i].pglen * pagesize + chunks[i].len;
+
+		status = fcache_get_chunk_buf(fc, &fch, len, 0, pos, buf);
+		if (status != KDUMP_OK) {
+			fprintf(stderr, "Cannot get %zd-byte chunk at %ld: %s\n",
+				len, (long)pos, kdump_strerror(status));
+			++bad;
+			continue;
+		}
+		prepare_buf(pos / pagesize, (pos + len - 1) / pagesize
+			    - pos / pagesize + 1);
+		if (memcmp(fch.data, mmapbuf + pos % pagesize, len)) {
+			printf("data mismatch at %ld\n", (long)pos);
+			++bad;
+		}
+		fcache_put_chunk(&fch);
+	}
+	return bad;
+}
+
+static int
+test_chunks_buf(struct fcache *fc)
+{
+#ifdef HAVE_MALLOC_COUNTER
+	struct fcache_chunk fch;
+#endif
+	void *buf;
+
+	buf = malloc(2 * pagesize);
+	if (!buf) {
+		perror("Cannot allocate bounce buffer");
+		return TEST_ERR;
+	}
+
+	/* Populate the cache. */
+	if (get_buf_chunks(fc, buf))
+		exitcode = TEST_FAIL;
+
+#ifdef HAVE_MALLOC_COUNTER
+	nallocs = 0;
+	countallocs = 1;
+#endif
+	if (get_buf_chunks(fc, buf))
+		exitcode = TEST_FAIL;
+#ifdef HAVE_MALLOC_COUNTER
+	countallocs = 0;
+	if (nallocs) {
+		fprintf(stderr, "Bounce buffer reads called malloc %lu times\n",
+			nallocs);
+		exitcode = TEST_FAIL;
+	}
+
+	/* Make sure that the counter works. */
+	countallocs = 1;
+	if (fcache_get_chunk(fc, &fch, 16, 0, (pagesize << CACHE_ORDER) - 8)
+	    == KDUMP_OK)
+		fcache_put_chunk(&fch);
+	countallocs = 0;
+	if (!nallocs) {
+		fprintf(stderr, "Allocation counter does not work\n");
+		exitcode = TEST_FAIL;
+	}
+#endif
+
+	free(buf);
+	return exitcode;
+}
+
 static int
 test_fcache(struct fcache *fc)
 {
@@ -400,11 +513,120 @@ test_fcache(struct fcache *fc)
 
 	ret = test_basic(fc);
 	ret2 = test_chunks(fc);
+	if (ret < ret2)
+		ret = ret2;
+	ret2 = test_chunks_buf(fc);
 	if (ret < ret2)
 		ret = ret2;
 	return ret;
 }
 
+static int
+test_whole(struct fcache *fc)
+{
+	off_t filesz = (pagesize << CACHE_ORDER) + 2 * pagesize +
+		(pagesize >> 1);
+	struct fcache_chunk fch;
+	struct fcache_entry ent;
+	kdump_status status;
+	int ret;
+
+	fc->mmap_policy.number = KDUMP_MMAP_WHOLE;
+	mmapsize = filesz;
+
+	ret = test_chunks(fc);
+	if (ret != TEST_OK)
+		return ret;
+
+	/* A chunk which spans several windows needs no cache entries. */
+	status = fcache_get_chunk(fc, &fch, 2 * pagesize, 0,
+				  (pagesize << CACHE_ORDER) - pagesize);
+	if (status != KDUMP_OK) {
+		fprintf(stderr, "Cannot get whole-file chunk: %s\n",
+			kdump_strerror(status));
+		return TEST_ERR;
+	}
+	if (fch.nent != 1 || fch.embed_fces->cache ||
+	    fch.data != fc->info[0].map + (pagesize << CACHE_ORDER) -
+	    pagesize) {
+		fprintf(stderr, "Whole-file chunk not mapped directly\n");
+		exitcode = TEST_FAIL;
+	}
+	fcache_put_chunk(&fch);
+
+	/* Partial reads at EOF. */
+	status = fcache_get(fc, &ent, 1, filesz - 8);
+	if (status != KDUMP_OK) {
+		fprintf(stderr, "Cannot read at EOF: %s\n",
+			kdump_strerror(status));
+		return TEST_ERR;
+	}
+	if (ent.len != 8 || ent.cache) {
+		fprintf(stderr, "Wrong whole-file entry at EOF\n");
+		exitcode = TEST_FAIL;
+	}
+	fcache_put(&ent);
+
+	return exitcode;
+}
+
+static int
+read_pages(struct fcache *fc, const unsigned *pages, unsigned n)
+{
+	struct fcache_entry ent;
+	kdump_status status;
+	unsigned i;
+
+	for (i = 0; i < n; ++i) {
+		status = fcache_get(fc, &ent, 0, (off_t)pages[i] * pagesize);
+		if (status != KDUMP_OK) {
+			fprintf(stderr, "Cannot read page %u: %s\n",
+				pages[i], kdump_strerror(status));
+			return TEST_ERR;
+		}
+		fcache_put(&ent);
+	}
+	return TEST_OK;
+}
+
+static int
+test_advice(struct fcache *fc)
+{
+	static const unsigned linear[] = { 0, 1, 2, 3, 4, 5, 6 };
+	static const unsigned scattered[] = { 3, 0 };
+	int ret;
+
+	/* A linear scan switches to sequential access. */
+	ret = read_pages(fc, linear, ARRAY_SIZE(linear));
+	if (ret != TEST_OK)
+		return ret;
+	if (fc->info[0].advice != KDUMP_ACCESS_SEQUENTIAL) {
+		fprintf(stderr, "Linear scan not detected\n");
+		exitcode = TEST_FAIL;
+	}
+
+	/* Random reads end the linear scan. */
+	ret = read_pages(fc, scattered, ARRAY_SIZE(scattered));
+	if (ret != TEST_OK)
+		return ret;
+	if (fc->info[0].advice != KDUMP_ACCESS_NORMAL) {
+		fprintf(stderr, "End of linear scan not detected\n");
+		exitcode = TEST_FAIL;
+	}
+
+	/* Explicit access pattern overrides detection. */
+	fc->access.number = KDUMP_ACCESS_RANDOM;
+	ret = read_pages(fc, linear, ARRAY_SIZE(linear));
+	if (ret != TEST_OK)
+		return ret;
+	if (fc->info[0].advice != KDUMP_ACCESS_RANDOM) {
+		fprintf(stderr, "Explicit access pattern not applied\n");
+		exitcode = TEST_FAIL;
+	}
+
+	return exitcode;
+}
+
 static int
 write_dump(int fd, unsigned fidx)
 {
@@ -449,6 +671,7 @@ main(int argc, char **argv)
 	int ret;
 
 	pagesize = sysconf(_SC_PAGESIZE);
+	mmapsize = pagesize << CACHE_ORDER;
 
 	mmapbuf = malloc(pagesize << CACHE_ORDER);
 	if (!mmapbuf) {
@@ -486,7 +709,7 @@ main(int argc, char **argv)
 		return ret;
 	}
 
-	fc = fcache_new(2, dumpfd, CACHE_SIZE, CACHE_ORDER);
+	fc = fcache_new(2, dumpfd, CACHE_SIZE, CACHE_ORDER, 0);
 	if (!fc) {
 		perror("Allocation failure");
 		close(dumpfd[1]);
@@ -496,6 +719,65 @@ main(int argc, char **argv)
 
 	ret = test_fcache(fc);
 	fcache_free(fc);
+
+	if (ret == TEST_OK) {
+		fc = fcache_new(2, dumpfd, CACHE_SIZE, CACHE_ORDER, 0);
+		if (!fc) {
+			perror("Allocation failure");
+			close(dumpfd[1]);
+			close(dumpfd[0]);
+			return TEST_ERR;
+		}
+		ret = test_advice(fc);
+		fcache_free(fc);
+	}
+
+	if (ret == TEST_OK) {
+		fc = fcache_new(2, dumpfd, CACHE_SIZE, CACHE_ORDER, 0);
+		if (!fc) {
+			perror("Allocation failure");
+			close(dumpfd[1]);
+			close(dumpfd[0]);
+			return TEST_ERR;
+		}
+		ret = test_whole(fc);
+		fcache_free(fc);
+	}
+
+	/* Read(2) with blocks bigger than a page. */
+	if (ret == TEST_OK) {
+		fc = fcache_new(2, dumpfd, CACHE_SIZE, CACHE_ORDER,
+				2 * pagesize);
+		if (!fc) {
+			perror("Allocation failure");
+			close(dumpfd[1]);
+			close(dumpfd[0]);
+			return TEST_ERR;
+		}
+		fc->mmap_policy.number = KDUMP_MMAP_NEVER;
+		ret = test_chunks(fc);
+		fcache_free(fc);
+	}
+
+	/* Direct I/O (if supported by the file system). */
+	if (ret == TEST_OK) {
+		fc = fcache_new(2, dumpfd, CACHE_SIZE, CACHE_ORDER, 0);
+		if (!fc) {
+			perror("Allocation failure");
+			close(dumpfd[1]);
+			close(dumpfd[0]);
+			return TEST_ERR;
+		}
+		fc->direct_io.number = 1;
+		ret = test_chunks(fc);
+		if (ret == TEST_OK &&
+		    fc->info[0].dfd == FCACHE_DFD_UNKNOWN) {
+			fprintf(stderr, "Direct I/O not attempted\n");
+			ret = TEST_FAIL;
+		}
+		fcache_free(fc);
+	}
+
 	close(dumpfd[1]);
 	close(dumpfd[0]);
 	return ret;
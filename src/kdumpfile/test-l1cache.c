@@ -0,0 +1,161 @@
+/** @internal @file src/kdumpfile/test-l1cache.c
+ * @brief Test the private (L1) page cache.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "fakedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Size of the private cache. */
+#define L1_SIZE		4
+
+/** Number of pages in the fake dump. */
+#define NPAGES		16
+
+/* Get the number of shared page cache hits. */
+static kdump_num_t
+shared_hits(kdump_ctx_t *ctx)
+{
+	return attr_value(gattr(ctx, GKI_cache_hits))->number;
+}
+
+int
+main(int argc, char **argv)
+{
+	kdump_ctx_t *ctx, *clone;
+	kdump_num_t hits;
+	int rc;
+
+	ctx = fake_dump(&fake_ops, NPAGES);
+	if (!ctx)
+		return TEST_ERR;
+	if (kdump_set_number_attr(ctx, KDUMP_ATTR_CACHE_L1_SIZE, L1_SIZE)
+	    != KDUMP_OK) {
+		fprintf(stderr, "Cannot set up cache: %s\n",
+			kdump_get_err(ctx));
+		return TEST_ERR;
+	}
+
+	clone = kdump_clone(ctx, 0);
+	if (!clone) {
+		perror("Cannot clone kdump context");
+		return TEST_ERR;
+	}
+
+	rc = fake_check_reads(ctx, "Initial read", 0, L1_SIZE, 1, L1_SIZE);
+
+	/* Repeated reads are served by the private cache. */
+	hits = shared_hits(ctx);
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Private hits", 0, L1_SIZE, 1, 0);
+	if (rc == TEST_OK && shared_hits(ctx) != hits) {
+		fprintf(stderr, "Private hits reached the shared cache\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK && !ctx->l1cache) {
+		fprintf(stderr, "No private cache\n");
+		rc = TEST_FAIL;
+	}
+
+	/* The clone has its own private cache. */
+	if (rc == TEST_OK)
+		rc = fake_check_reads(clone, "Clone read", 0, L1_SIZE, 1, 0);
+	if (rc == TEST_OK && shared_hits(ctx) != hits + L1_SIZE) {
+		fprintf(stderr, "Clone did not hit the shared cache\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK && clone->l1cache == ctx->l1cache) {
+		fprintf(stderr, "Private cache is shared with the clone\n");
+		rc = TEST_FAIL;
+	}
+
+	/* More pages than fit into the private cache. */
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Private cache overflow",
+				      0, NPAGES, 1, NPAGES - L1_SIZE);
+
+	/* Re-allocating the shared cache must flush private caches. */
+	fake_version = 0x55;
+	if (rc == TEST_OK &&
+	    set_page_size(ctx, 2 * FAKE_PAGE_SIZE) != KDUMP_OK) {
+		fprintf(stderr, "Cannot change page size: %s\n",
+			kdump_get_err(ctx));
+		rc = TEST_ERR;
+	}
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "After page size change",
+				      0, L1_SIZE, 1, L1_SIZE);
+	if (rc == TEST_OK)
+		rc = fake_check_reads(clone, "Clone after page size change",
+				      0, L1_SIZE, 1, 0);
+
+	/* Check occupancy and reset the statistics. */
+	if (rc == TEST_OK &&
+	    attr_value(gattr(ctx, GKI_cache_precious))->number +
+	    attr_value(gattr(ctx, GKI_cache_probed))->number != L1_SIZE) {
+		fprintf(stderr, "Wrong shared cache occupancy\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK &&
+	    kdump_set_number_attr(ctx, KDUMP_ATTR_CACHE_RESET_STATS, 1)
+	    != KDUMP_OK) {
+		fprintf(stderr, "Cannot reset statistics: %s\n",
+			kdump_get_err(ctx));
+		rc = TEST_ERR;
+	}
+	if (rc == TEST_OK && shared_hits(ctx) != 0) {
+		fprintf(stderr, "Cache hits not reset\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Disable the private cache. */
+	if (rc == TEST_OK &&
+	    kdump_set_number_attr(ctx, KDUMP_ATTR_CACHE_L1_SIZE, 0)
+	    != KDUMP_OK) {
+		fprintf(stderr, "Cannot disable private cache: %s\n",
+			kdump_get_err(ctx));
+		rc = TEST_ERR;
+	}
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Private cache disabled",
+				      0, 1, 1, 0);
+	if (rc == TEST_OK && ctx->l1cache) {
+		fprintf(stderr, "Private cache not freed\n");
+		rc = TEST_FAIL;
+	}
+
+	kdump_free(clone);
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+
+	return rc;
+}
@@ -0,0 +1,346 @@
+/** @internal @file src/kdumpfile/test-parallel-read.c
+ * @brief Test reading a range from multiple files in parallel.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "fakedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Number of pages in the fake dump. */
+#define NPAGES		128
+
+/** Number of dump files. */
+#define NFILES		4
+
+/** Number of pages in each dump file. */
+#define FILEPAGES	(NPAGES / NFILES)
+
+/** Number of repeated reads. */
+#define NREPEAT		50
+
+/** Number of file cache elements (as in open.c). */
+#define FCACHE_SIZE	16
+
+/** PFN of a page which cannot be read. */
+static unsigned long badpfn = ~0UL;
+
+/** Read counter, incremented before each checked read. */
+static unsigned readgen;
+
+/** Number of threads which have read a page in this read. */
+static unsigned nthreads;
+
+/** Number of threads which have ever read a page. */
+static unsigned allthreads;
+
+/** Last read in which this thread has read a page. */
+static __thread unsigned seen;
+
+/** Non-zero if this thread has ever read a page. */
+static __thread int seen_ever;
+
+/** Count the current thread as a reader. */
+static void
+add_reader(void)
+{
+	if (seen != readgen) {
+		seen = readgen;
+		__atomic_add_fetch(&nthreads, 1, __ATOMIC_RELAXED);
+	}
+	if (!seen_ever) {
+		seen_ever = 1;
+		__atomic_add_fetch(&allthreads, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/** Get a page, or fail if it is the bad page. */
+static kdump_status
+split_get_page(struct page_io *pio)
+{
+	unsigned long pfn = pio->addr.addr / FAKE_PAGE_SIZE;
+
+	add_reader();
+	if (pfn == badpfn)
+		return set_error(pio->ctx, KDUMP_ERR_CORRUPT,
+				 "Bad page %lu", pfn);
+	return fake_get_page(pio);
+}
+
+static kdump_pfn_t
+split_file_end_pfn(kdump_ctx_t *ctx, kdump_pfn_t pfn)
+{
+	return (pfn / FILEPAGES + 1) * FILEPAGES;
+}
+
+static const struct format_ops split_ops = {
+	.name = "split",
+	.get_page = split_get_page,
+	.put_page = cache_put_page,
+	.file_end_pfn = split_file_end_pfn,
+	.realloc_caches = def_realloc_caches,
+};
+
+/** Read a page from a dump file through the file cache. */
+static kdump_status
+file_read(struct page_io *pio)
+{
+	unsigned long pfn = pio->addr.addr / FAKE_PAGE_SIZE;
+	kdump_status status;
+
+	status = fcache_pread(pio->ctx->shared->fcache, pio->chunk.data,
+			      FAKE_PAGE_SIZE, pfn / FILEPAGES,
+			      (off_t)(pfn % FILEPAGES) * FAKE_PAGE_SIZE);
+	if (status != KDUMP_OK)
+		return set_error(pio->ctx, status,
+				 "Cannot read page %lu", pfn);
+	return KDUMP_OK;
+}
+
+static kdump_status
+file_get_page(struct page_io *pio)
+{
+	add_reader();
+	return cache_get_page(pio, file_read);
+}
+
+static const struct format_ops file_ops = {
+	.name = "file",
+	.get_page = file_get_page,
+	.put_page = cache_put_page,
+	.file_end_pfn = split_file_end_pfn,
+	.realloc_caches = def_realloc_caches,
+};
+
+/* Read a range and check its content. */
+static int
+check_range(kdump_ctx_t *ctx, kdump_addr_t addr, size_t len,
+	    kdump_status expstatus, size_t explen)
+{
+	unsigned char *buf;
+	size_t i, rd;
+	kdump_status status;
+	int rc = TEST_OK;
+
+	buf = malloc(len);
+	if (!buf) {
+		perror("Cannot allocate read buffer");
+		return TEST_ERR;
+	}
+
+	++readgen;
+	nthreads = 0;
+	rd = len;
+	status = kdump_read(ctx, KDUMP_MACHPHYSADDR, addr, buf, &rd);
+	if (status != expstatus) {
+		fprintf(stderr, "Read at 0x%llx: %s (expect %s)\n",
+			(unsigned long long) addr, kdump_strerror(status),
+			kdump_strerror(expstatus));
+		rc = TEST_FAIL;
+	}
+	if (rd != explen) {
+		fprintf(stderr, "Read at 0x%llx: %zu bytes (expect %zu)\n",
+			(unsigned long long) addr, rd, explen);
+		rc = TEST_FAIL;
+	}
+	if (status != KDUMP_OK && !strstr(kdump_get_err(ctx), "Bad page")) {
+		fprintf(stderr, "Wrong error message: %s\n",
+			kdump_get_err(ctx));
+		rc = TEST_FAIL;
+	}
+
+	for (i = 0; i < rd && rc == TEST_OK; ++i) {
+		kdump_addr_t cur = addr + i;
+		if (buf[i] != fake_byte(cur / FAKE_PAGE_SIZE,
+					cur % FAKE_PAGE_SIZE)) {
+			fprintf(stderr, "Wrong data at 0x%llx\n",
+				(unsigned long long) cur);
+			rc = TEST_FAIL;
+		}
+	}
+
+	free(buf);
+	return rc;
+}
+
+/* Set up a fake dump which is split into multiple files. */
+static kdump_ctx_t *
+split_dump(const struct format_ops *ops)
+{
+	kdump_ctx_t *ctx;
+
+	ctx = fake_dump(ops, NPAGES);
+	if (!ctx)
+		return NULL;
+	ctx->xlat->xlat_caps = ADDRXLAT_CAPS(ADDRXLAT_MACHPHYSADDR);
+	if (kdump_set_number_attr(ctx, KDUMP_ATTR_FILE_SET ".number", NFILES)
+	    != KDUMP_OK) {
+		fprintf(stderr, "Cannot set up fake dump: %s\n",
+			kdump_get_err(ctx));
+		ctx->shared->ops = NULL;
+		kdump_free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+/* Read pages with read(2) while other readers hold file cache blocks. */
+static int
+check_files(void)
+{
+	unsigned char page[FAKE_PAGE_SIZE];
+	struct fcache_entry held[FCACHE_FB_RESERVE];
+	int fd[NFILES];
+	struct fcache *fc;
+	kdump_ctx_t *ctx;
+	unsigned i, j;
+	int rc;
+
+	for (i = 0; i < NFILES; ++i) {
+		FILE *f = tmpfile();
+		if (!f) {
+			perror("Cannot create dump file");
+			return TEST_ERR;
+		}
+		fd[i] = dup(fileno(f));
+		fclose(f);
+		for (j = 0; j < FILEPAGES; ++j) {
+			unsigned long pfn = i * FILEPAGES + j;
+			size_t k;
+			for (k = 0; k < FAKE_PAGE_SIZE; ++k)
+				page[k] = fake_byte(pfn, k);
+			if (write(fd[i], page, sizeof page) != sizeof page) {
+				perror("Cannot write dump file");
+				return TEST_ERR;
+			}
+		}
+	}
+
+	ctx = split_dump(&file_ops);
+	if (!ctx)
+		return TEST_ERR;
+	fc = fcache_new(NFILES, fd, FCACHE_SIZE, 0, 0);
+	if (!fc) {
+		perror("Cannot allocate file cache");
+		kdump_free(ctx);
+		return TEST_ERR;
+	}
+	fc->mmap_policy.number = KDUMP_MMAP_NEVER;
+	ctx->shared->fcache = fc;
+
+	/* Other readers may hold up to two blocks each. */
+	rc = TEST_OK;
+	for (i = 0; i < FCACHE_FB_RESERVE; ++i)
+		if (fcache_get(fc, &held[i], i % NFILES,
+			       (off_t)(i / NFILES) * fc->rdblksz)
+		    != KDUMP_OK) {
+			fprintf(stderr, "Cannot get file cache block %u\n",
+				i);
+			rc = TEST_ERR;
+			break;
+		}
+
+	if (rc == TEST_OK)
+		rc = check_range(ctx, 0, NPAGES * FAKE_PAGE_SIZE,
+				 KDUMP_OK, NPAGES * FAKE_PAGE_SIZE);
+
+	while (i--)
+		fcache_put(&held[i]);
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+	for (i = 0; i < NFILES; ++i)
+		close(fd[i]);
+
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	kdump_ctx_t *ctx;
+	unsigned i;
+	int rc;
+
+	ctx = split_dump(&split_ops);
+	if (!ctx)
+		return TEST_ERR;
+
+	/* An unaligned range over all pages. */
+	rc = check_range(ctx, 100, NPAGES * FAKE_PAGE_SIZE - 200,
+			 KDUMP_OK, NPAGES * FAKE_PAGE_SIZE - 200);
+#if USE_PTHREAD
+	if (rc == TEST_OK && nthreads < 2) {
+		fprintf(stderr, "Range was read by %u thread(s)\n", nthreads);
+		rc = TEST_FAIL;
+	}
+#endif
+
+	/* A range inside one file is read by the calling thread. */
+	if (rc == TEST_OK)
+		rc = check_range(ctx, FILEPAGES * FAKE_PAGE_SIZE + 100,
+				 FILEPAGES * FAKE_PAGE_SIZE - 200,
+				 KDUMP_OK, FILEPAGES * FAKE_PAGE_SIZE - 200);
+	if (rc == TEST_OK && nthreads != 1) {
+		fprintf(stderr, "One file was read by %u threads\n", nthreads);
+		rc = TEST_FAIL;
+	}
+
+	/* Worker threads are reused. */
+	for (i = 0; i < NREPEAT && rc == TEST_OK; ++i)
+		rc = check_range(ctx, 0, NPAGES * FAKE_PAGE_SIZE,
+				 KDUMP_OK, NPAGES * FAKE_PAGE_SIZE);
+	if (rc == TEST_OK && allthreads > READ_THREADS) {
+		fprintf(stderr, "%u reads used %u threads\n",
+			NREPEAT, allthreads);
+		rc = TEST_FAIL;
+	}
+
+	/* Errors must be reported as if the range was read in order. */
+	badpfn = NPAGES - 10;
+	if (rc == TEST_OK)
+		rc = check_range(ctx, 0, NPAGES * FAKE_PAGE_SIZE,
+				 KDUMP_ERR_CORRUPT, badpfn * FAKE_PAGE_SIZE);
+	badpfn = 10;
+	if (rc == TEST_OK)
+		rc = check_range(ctx, 0, NPAGES * FAKE_PAGE_SIZE,
+				 KDUMP_ERR_CORRUPT, badpfn * FAKE_PAGE_SIZE);
+
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+
+	/* Real files read with read(2). */
+	if (rc == TEST_OK)
+		rc = check_files();
+
+	return rc;
+}
@@ -0,0 +1,282 @@
+/** @internal @file src/kdumpfile/test-pfn-bitmap.c
+ * @brief Test conversion of PFN bitmaps to PFN regions.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "kdumpfile-priv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_OK     0
+#define TEST_FAIL   1
+#define TEST_ERR   99
+
+/** Number of PFNs in the test bitmap.
+ * This is big enough to be converted in multiple parts.
+ */
+#define NPFNS		((kdump_pfn_t)9 << 22)
+
+/** Size of a mapped object. */
+#define ELEMSZ		24
+
+/** File offset of the first mapped object. */
+#define FILEOFF		0x1000
+
+/** Check whether a bit is set in a bitmap. */
+static int
+test_bit(const unsigned char *bitmap, bool is_msb0, kdump_pfn_t pfn)
+{
+	unsigned shift = is_msb0 ? 7 - (pfn & 7) : pfn & 7;
+	return (bitmap[pfn >> 3] >> shift) & 1;
+}
+
+/** Set or clear a range of bits in a bitmap. */
+static void
+fill_bits(unsigned char *bitmap, bool is_msb0,
+	  kdump_pfn_t first, kdump_pfn_t end, int val)
+{
+	kdump_pfn_t pfn;
+	for (pfn = first; pfn < end; ++pfn) {
+		unsigned shift = is_msb0 ? 7 - (pfn & 7) : pfn & 7;
+		if (val)
+			bitmap[pfn >> 3] |= 1U << shift;
+		else
+			bitmap[pfn >> 3] &= ~(1U << shift);
+	}
+}
+
+/** Make a test bitmap.
+ * The bitmap contains random bits, long runs of set and clear bits,
+ * and set bits around the boundaries of conversion parts.
+ */
+static void
+make_bitmap(unsigned char *bitmap, bool is_msb0)
+{
+	kdump_pfn_t pfn;
+	unsigned i;
+
+	srandom(1);
+	for (pfn = 0; pfn < NPFNS / 8; ++pfn)
+		bitmap[pfn] = random();
+
+	fill_bits(bitmap, is_msb0, 1000000, 3000000, 1);
+	fill_bits(bitmap, is_msb0, 5000000, 9000000, 0);
+	for (i = 1; i < 9; ++i)
+		fill_bits(bitmap, is_msb0,
+			  ((kdump_pfn_t)i << 22) - 1000,
+			  ((kdump_pfn_t)i << 22) + 1000, 1);
+	fill_bits(bitmap, is_msb0, NPFNS - 3000, NPFNS, 1);
+}
+
+/** Convert a bitmap one bit at a time. */
+static int
+ref_regions(struct pfn_file_map *pfm, const unsigned char *bitmap,
+	    bool is_msb0, kdump_pfn_t start_pfn, kdump_pfn_t end_pfn)
+{
+	struct pfn_region rgn;
+	kdump_pfn_t pfn;
+
+	rgn.pos = FILEOFF;
+	rgn.cnt = 0;
+	for (pfn = start_pfn; pfn <= end_pfn; ++pfn) {
+		if (pfn < end_pfn && test_bit(bitmap, is_msb0, pfn)) {
+			if (!rgn.cnt)
+				rgn.pfn = pfn;
+			++rgn.cnt;
+		} else if (rgn.cnt) {
+			if (!add_pfn_region(pfm, &rgn))
+				return TEST_ERR;
+			rgn.pos += rgn.cnt * ELEMSZ;
+			rgn.cnt = 0;
+		}
+	}
+	return TEST_OK;
+}
+
+static int
+check_bitmap(const unsigned char *bitmap, bool is_msb0,
+	     kdump_pfn_t start_pfn, kdump_pfn_t end_pfn)
+{
+	static const struct pfn_region first = { 1, 2, 3 };
+	struct pfn_file_map ref, pfm;
+	kdump_errmsg_t err;
+	kdump_status status;
+	size_t i;
+	int rc;
+
+	memset(&ref, 0, sizeof ref);
+	memset(&pfm, 0, sizeof pfm);
+	rc = TEST_OK;
+
+	/* Regions must be appended to existing regions. */
+	if (!add_pfn_region(&ref, &first) || !add_pfn_region(&pfm, &first) ||
+	    ref_regions(&ref, bitmap, is_msb0, start_pfn, end_pfn)) {
+		fprintf(stderr, "Cannot allocate reference regions\n");
+		rc = TEST_ERR;
+		goto out;
+	}
+
+	err_init(&err, 64);
+	status = pfn_regions_from_bitmap(&err, &pfm, bitmap, is_msb0,
+					 start_pfn, end_pfn, FILEOFF, ELEMSZ);
+	if (status != KDUMP_OK) {
+		fprintf(stderr, "Conversion failed: %s\n", err_str(&err));
+		rc = TEST_ERR;
+		goto out_err;
+	}
+
+	if (pfm.nregions != ref.nregions) {
+		fprintf(stderr, "%s 0x%llx-0x%llx: %zu regions (expect %zu)\n",
+			is_msb0 ? "MSB0" : "LSB0",
+			(unsigned long long) start_pfn,
+			(unsigned long long) end_pfn,
+			pfm.nregions, ref.nregions);
+		rc = TEST_FAIL;
+		goto out_err;
+	}
+	for (i = 0; i < ref.nregions; ++i) {
+		const struct pfn_region *a = &pfm.regions[i];
+		const struct pfn_region *b = &ref.regions[i];
+		if (a->pfn != b->pfn || a->cnt != b->cnt || a->pos != b->pos) {
+			fprintf(stderr, "%s region #%zu:"
+				" 0x%llx+0x%llx@0x%llx (expect"
+				" 0x%llx+0x%llx@0x%llx)\n",
+				is_msb0 ? "MSB0" : "LSB0", i,
+				(unsigned long long) a->pfn,
+				(unsigned long long) a->cnt,
+				(unsigned long long) a->pos,
+				(unsigned long long) b->pfn,
+				(unsigned long long) b->cnt,
+				(unsigned long long) b->pos);
+			rc = TEST_FAIL;
+			break;
+		}
+	}
+
+	/* The allocation must remain usable by add_pfn_region(). */
+	if (rc == TEST_OK && !add_pfn_region(&pfm, &first)) {
+		fprintf(stderr, "Cannot add a region after conversion\n");
+		rc = TEST_ERR;
+	}
+
+ out_err:
+	err_cleanup(&err);
+ out:
+	free(ref.regions);
+	free(pfm.regions);
+	return rc;
+}
+
+/** Check that runs of set bits are not split at byte boundaries.
+ * @returns  Test result.
+ *
+ * The MSB0 bitmap has two runs of set bits, each of them spanning
+ * several bytes, so it must be converted to exactly two regions.
+ */
+static int
+check_msb0_runs(void)
+{
+	unsigned char bitmap[32];
+	struct pfn_file_map pfm;
+	kdump_errmsg_t err;
+	kdump_status status;
+	int rc = TEST_OK;
+
+	memset(bitmap, 0, sizeof bitmap);
+	fill_bits(bitmap, true, 3, 50, 1);
+	fill_bits(bitmap, true, 61, 200, 1);
+
+	memset(&pfm, 0, sizeof pfm);
+	err_init(&err, 64);
+	status = pfn_regions_from_bitmap(&err, &pfm, bitmap, true,
+					 0, sizeof bitmap * 8, FILEOFF, ELEMSZ);
+	if (status != KDUMP_OK) {
+		fprintf(stderr, "Conversion failed: %s\n", err_str(&err));
+		rc = TEST_ERR;
+	} else if (pfm.nregions != 2) {
+		fprintf(stderr, "MSB0 runs: %zu regions (expect 2)\n",
+			pfm.nregions);
+		rc = TEST_FAIL;
+	} else if (pfm.regions[0].pfn != 3 || pfm.regions[0].cnt != 47 ||
+		   pfm.regions[1].pfn != 61 || pfm.regions[1].cnt != 139) {
+		fprintf(stderr, "MSB0 runs: 0x%llx+0x%llx, 0x%llx+0x%llx"
+			" (expect 0x3+0x2f, 0x3d+0x8b)\n",
+			(unsigned long long) pfm.regions[0].pfn,
+			(unsigned long long) pfm.regions[0].cnt,
+			(unsigned long long) pfm.regions[1].pfn,
+			(unsigned long long) pfm.regions[1].cnt);
+		rc = TEST_FAIL;
+	}
+
+	err_cleanup(&err);
+	free(pfm.regions);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned char *bitmap;
+	int rc, res;
+
+	bitmap = malloc(NPFNS / 8);
+	if (!bitmap) {
+		perror("Cannot allocate bitmap");
+		return TEST_ERR;
+	}
+
+	rc = check_msb0_runs();
+
+	make_bitmap(bitmap, false);
+	res = check_bitmap(bitmap, false, 0, NPFNS);
+	if (res > rc)
+		rc = res;
+	res = check_bitmap(bitmap, false, 12345, NPFNS - 17);
+	if (res > rc)
+		rc = res;
+
+	make_bitmap(bitmap, true);
+	res = check_bitmap(bitmap, true, 0, NPFNS);
+	if (res > rc)
+		rc = res;
+	res = check_bitmap(bitmap, true, 777, NPFNS - 5);
+	if (res > rc)
+		rc = res;
+
+	/* A small bitmap is converted in one part. */
+	res = check_bitmap(bitmap, true, 100, 100000);
+	if (res > rc)
+		rc = res;
+
+	free(bitmap);
+	return rc;
+}
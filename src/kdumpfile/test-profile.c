@@ -0,0 +1,172 @@
+/** @internal @file src/kdumpfile/test-profile.c
+ * @brief Test page cache profiles.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "fakedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Number of pages in the fake dump. */
+#define NPAGES		64
+
+/** Name of the profile file. */
+#define PROFILE		"tmp.profile"
+
+/* Create a dump file object with a profile. */
+static kdump_ctx_t *
+new_ctx(void)
+{
+	kdump_ctx_t *ctx;
+
+	ctx = fake_dump(&fake_ops, NPAGES);
+	if (!ctx)
+		return NULL;
+	if (kdump_set_string_attr(ctx, KDUMP_ATTR_CACHE_PROFILE, PROFILE)
+	    != KDUMP_OK) {
+		fprintf(stderr, "Cannot set up cache: %s\n",
+			kdump_get_err(ctx));
+		ctx->shared->ops = NULL;
+		kdump_free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+/* Read a page @p n times. */
+static int
+read_page(kdump_ctx_t *ctx, unsigned pfn, unsigned n)
+{
+	int rc = TEST_OK;
+
+	while (n-- && rc == TEST_OK)
+		rc = fake_check_page(ctx, pfn);
+	return rc;
+}
+
+/* Check the first key in the profile file. */
+static int
+check_first_key(unsigned pfn)
+{
+	unsigned long long key;
+	char line[80];
+	FILE *f;
+	int rc;
+
+	f = fopen(PROFILE, "r");
+	if (!f) {
+		perror("Cannot open profile");
+		return TEST_FAIL;
+	}
+	rc = TEST_FAIL;
+	if (fgets(line, sizeof line, f) && fgets(line, sizeof line, f) &&
+	    sscanf(line, "%llx", &key) == 1 &&
+	    key == ((unsigned long long)pfn * FAKE_PAGE_SIZE |
+		    ADDRXLAT_MACHPHYSADDR))
+		rc = TEST_OK;
+	else
+		fprintf(stderr, "Wrong first profile line: %s", line);
+	fclose(f);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const unsigned pfns[] = { 3, 17, 42, 5, 63 };
+	kdump_ctx_t *ctx;
+	unsigned long start;
+	unsigned i;
+	int rc;
+
+	unlink(PROFILE);
+
+	/* Record a profile. */
+	ctx = new_ctx();
+	if (!ctx)
+		return TEST_ERR;
+	rc = TEST_OK;
+	for (i = 0; i < ARRAY_SIZE(pfns) && rc == TEST_OK; ++i)
+		rc = read_page(ctx, pfns[i], i == 2 ? 5 : 1);
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+	if (rc != TEST_OK)
+		return rc;
+
+	rc = check_first_key(pfns[2]);
+	if (rc != TEST_OK)
+		return rc;
+
+	/* Warm up a new cache from the profile. */
+	ctx = new_ctx();
+	if (!ctx)
+		return TEST_ERR;
+	start = fake_nreads;
+	cache_profile_load(ctx);
+	if (fake_nreads - start != ARRAY_SIZE(pfns)) {
+		fprintf(stderr, "Prefetched %lu pages (expect %zu)\n",
+			fake_nreads - start, ARRAY_SIZE(pfns));
+		rc = TEST_FAIL;
+	}
+
+	/* All profiled pages are now cached. */
+	start = fake_nreads;
+	for (i = 0; i < ARRAY_SIZE(pfns) && rc == TEST_OK; ++i)
+		rc = read_page(ctx, pfns[i], 1);
+	if (rc == TEST_OK && fake_nreads != start) {
+		fprintf(stderr, "%lu profiled pages were not cached\n",
+			fake_nreads - start);
+		rc = TEST_FAIL;
+	}
+
+	/* A corrupted profile is ignored. */
+	if (rc == TEST_OK) {
+		FILE *f = fopen(PROFILE, "w");
+		if (f) {
+			fputs("garbage\n1000 1\n", f);
+			fclose(f);
+		}
+		start = fake_nreads;
+		cache_profile_load(ctx);
+		if (fake_nreads != start) {
+			fprintf(stderr, "Corrupted profile was loaded\n");
+			rc = TEST_FAIL;
+		}
+	}
+
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+	unlink(PROFILE);
+
+	return rc;
+}
@@ -0,0 +1,195 @@
+/** @internal @file src/kdumpfile/test-xlat-pio.c
+ * @brief Test allocations in the addrxlat get_page callback.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "kdumpfile-priv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_OK     0
+#define TEST_FAIL   1
+#define TEST_SKIP  77
+#define TEST_ERR   99
+
+/** Number of get/put rounds. */
+#define ROUNDS	1000
+
+/** Page size of the fake dump. */
+#define PAGE_SIZE	4096
+
+/** Number of pages held at the same time. */
+#define NBUFS	(XLAT_PIO_SLOTS + 1)
+
+static unsigned char page[PAGE_SIZE];
+
+/** Set to count calls to malloc(). */
+static int counting;
+
+/** Number of malloc() calls while @c counting is set. */
+static unsigned long nmalloc;
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+
+void *
+malloc(size_t size)
+{
+	if (counting)
+		++nmalloc;
+	return __libc_malloc(size);
+}
+
+#endif
+
+static kdump_status
+fake_get_page(struct page_io *pio)
+{
+	if (pio->addr.addr >= NBUFS * PAGE_SIZE)
+		return set_error(pio->ctx, KDUMP_ERR_NODATA,
+				 "Page not found");
+	pio->chunk.data = page;
+	pio->chunk.nent = 0;
+	return KDUMP_OK;
+}
+
+static void
+fake_put_page(struct page_io *pio)
+{
+}
+
+static const struct format_ops fake_ops = {
+	.name = "fake",
+	.get_page = fake_get_page,
+	.put_page = fake_put_page,
+};
+
+static int
+get_bufs(const addrxlat_cb_t *cb, addrxlat_buffer_t *bufs, unsigned n)
+{
+	addrxlat_status status;
+	unsigned i;
+
+	for (i = 0; i < n; ++i) {
+		bufs[i].addr.addr = i * PAGE_SIZE;
+		bufs[i].addr.as = ADDRXLAT_MACHPHYSADDR;
+		status = cb->get_page(cb, &bufs[i]);
+		if (status != ADDRXLAT_OK) {
+			fprintf(stderr, "Cannot get page %u: %s\n",
+				i, addrxlat_strerror(status));
+			return TEST_FAIL;
+		}
+		if (bufs[i].ptr != page) {
+			fprintf(stderr, "Wrong data for page %u\n", i);
+			return TEST_FAIL;
+		}
+	}
+	return TEST_OK;
+}
+
+static void
+put_bufs(addrxlat_buffer_t *bufs, unsigned n)
+{
+	unsigned i;
+
+	for (i = 0; i < n; ++i)
+		bufs[i].put_page(&bufs[i]);
+}
+
+int
+main(int argc, char **argv)
+{
+	addrxlat_buffer_t bufs[NBUFS];
+	const addrxlat_cb_t *cb;
+	kdump_ctx_t *ctx;
+	unsigned i;
+	int rc;
+
+#ifndef __GLIBC__
+	return TEST_SKIP;
+#endif
+
+	ctx = kdump_new();
+	if (!ctx) {
+		perror("Cannot allocate kdump context");
+		return TEST_ERR;
+	}
+	ctx->shared->ops = &fake_ops;
+	if (set_page_size(ctx, PAGE_SIZE) != KDUMP_OK) {
+		fprintf(stderr, "Cannot set page size: %s\n",
+			kdump_get_err(ctx));
+		return TEST_ERR;
+	}
+	cb = ctx->xlatcb;
+
+	rc = TEST_OK;
+
+	/* Page table walks hold at most XLAT_PIO_SLOTS pages. */
+	counting = 1;
+	for (i = 0; i < ROUNDS && rc == TEST_OK; ++i) {
+		rc = get_bufs(cb, bufs, XLAT_PIO_SLOTS);
+		if (rc == TEST_OK)
+			put_bufs(bufs, XLAT_PIO_SLOTS);
+	}
+	counting = 0;
+	if (nmalloc) {
+		fprintf(stderr, "%lu allocations in %u rounds\n",
+			nmalloc, ROUNDS);
+		rc = TEST_FAIL;
+	}
+
+	/* More pages must still work. */
+	if (rc == TEST_OK)
+		rc = get_bufs(cb, bufs, NBUFS);
+	if (rc == TEST_OK)
+		put_bufs(bufs, NBUFS);
+
+	/* Failed reads must not leak pool elements. */
+	for (i = 0; i < XLAT_PIO_SLOTS + 1 && rc == TEST_OK; ++i) {
+		bufs[0].addr.addr = NBUFS * PAGE_SIZE;
+		bufs[0].addr.as = ADDRXLAT_MACHPHYSADDR;
+		if (cb->get_page(cb, &bufs[0]) == ADDRXLAT_OK) {
+			fprintf(stderr, "Reading a missing page succeeded\n");
+			rc = TEST_FAIL;
+		}
+	}
+	if (rc == TEST_OK && ctx->xlat_pio_used) {
+		fprintf(stderr, "Pool elements leaked: 0x%x\n",
+			ctx->xlat_pio_used);
+		rc = TEST_FAIL;
+	}
+
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+
+	return rc;
+}
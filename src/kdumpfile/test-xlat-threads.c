@@ -0,0 +1,308 @@
+/** @internal @file src/kdumpfile/test-xlat-threads.c
+ * @brief Test parallel page table walks with a dump file object.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "kdumpfile-priv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_OK     0
+#define TEST_FAIL   1
+#define TEST_SKIP  77
+#define TEST_ERR   99
+
+/** Page size of the fake dump. */
+#define PAGE_SIZE	4096
+
+/** Size of the simulated physical memory. */
+#define MEMSZ		(4 << 20)
+
+/** Number of mapped top-level page table entries. */
+#define NTOP		64
+
+/** Number of mapped pages under each top-level entry. */
+#define NPAGES		8
+
+/** Number of threads for the parallel walk. */
+#define NTHREADS	4
+
+/** Maximum number of extents collected by one walk. */
+#define MAXEXT		(NTOP * NPAGES)
+
+/** Maximum number of recorded page readers. */
+#define MAXREADERS	64
+
+#define PTE_PRESENT	0x001
+#define PTE_FLAGS	0x063	/* present, writable, accessed, dirty */
+
+static unsigned char mem[MEMSZ];
+static uint64_t memtop;
+static uint64_t root;
+
+/** Dump file object and thread of a page reader. */
+struct reader {
+	kdump_ctx_t *ctx;
+	pthread_t tid;
+};
+
+/** Guard access to @c readers. */
+static pthread_mutex_t readers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Page readers seen by @ref fake_get_page. */
+static struct reader readers[MAXREADERS];
+
+/** Number of elements in @c readers. */
+static unsigned nreaders;
+
+/** Set if a dump file object was used by more than one thread. */
+static int shared_ctx;
+
+/** Collected extents. */
+struct collect {
+	addrxlat_extent_t ext[MAXEXT];
+	unsigned n;
+};
+
+static uint64_t
+alloc_table(void)
+{
+	uint64_t ret = memtop;
+
+	memtop += PAGE_SIZE;
+	return ret;
+}
+
+static uint64_t *
+entry(uint64_t table, addrxlat_addr_t va, unsigned shift)
+{
+	return (uint64_t *)(mem + table) + ((va >> shift) & 0x1ff);
+}
+
+/* Map @c va to @c pa with a 4K page. */
+static void
+map_page(addrxlat_addr_t va, uint64_t pa)
+{
+	uint64_t table = root;
+	unsigned shift;
+
+	for (shift = 39; shift > 12; shift -= 9) {
+		uint64_t *pte = entry(table, va, shift);
+		if (!(le64toh(*pte) & PTE_PRESENT))
+			*pte = htole64(alloc_table() | PTE_FLAGS);
+		table = le64toh(*pte) & ~(uint64_t)(PAGE_SIZE - 1);
+	}
+	*entry(table, va, 12) = htole64(pa | PTE_FLAGS);
+}
+
+/** Remember which thread reads pages through which object. */
+static void
+add_reader(kdump_ctx_t *ctx)
+{
+	pthread_t self = pthread_self();
+	unsigned i;
+
+	pthread_mutex_lock(&readers_lock);
+	for (i = 0; i < nreaders; ++i)
+		if (readers[i].ctx == ctx)
+			break;
+	if (i == nreaders && nreaders < MAXREADERS) {
+		readers[i].ctx = ctx;
+		readers[i].tid = self;
+		++nreaders;
+	} else if (i < nreaders && !pthread_equal(readers[i].tid, self))
+		shared_ctx = 1;
+	pthread_mutex_unlock(&readers_lock);
+}
+
+static kdump_status
+fake_get_page(struct page_io *pio)
+{
+	add_reader(pio->ctx);
+	if (pio->addr.addr >= MEMSZ)
+		return set_error(pio->ctx, KDUMP_ERR_NODATA,
+				 "Page not found");
+	pio->chunk.data = mem + pio->addr.addr;
+	pio->chunk.nent = 0;
+	return KDUMP_OK;
+}
+
+static void
+fake_put_page(struct page_io *pio)
+{
+}
+
+static const struct format_ops fake_ops = {
+	.name = "fake",
+	.get_page = fake_get_page,
+	.put_page = fake_put_page,
+};
+
+static addrxlat_status
+collect_extent(void *data, const addrxlat_extent_t *ext)
+{
+	struct collect *coll = data;
+
+	if (coll->n >= MAXEXT)
+		return ADDRXLAT_ERR_NOMEM;
+	coll->ext[coll->n++] = *ext;
+	return ADDRXLAT_OK;
+}
+
+static int
+walk(addrxlat_ctx_t *xctx, addrxlat_sys_t *sys, const addrxlat_meth_t *meth,
+     unsigned nthreads, struct collect *coll)
+{
+	addrxlat_status status;
+
+	coll->n = 0;
+	status = addrxlat_enum_pgt(xctx, sys, meth, 0, 0x00007fffffffffffULL,
+				   nthreads, collect_extent, coll);
+	if (status != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot enumerate page tables (%u threads):"
+			" %s\n", nthreads, addrxlat_ctx_get_err(xctx));
+		return TEST_FAIL;
+	}
+	return TEST_OK;
+}
+
+static int
+same_extents(const struct collect *a, const struct collect *b)
+{
+	unsigned i;
+
+	if (a->n != b->n)
+		return 0;
+	for (i = 0; i < a->n; ++i)
+		if (a->ext[i].vaddr != b->ext[i].vaddr ||
+		    a->ext[i].endoff != b->ext[i].endoff ||
+		    a->ext[i].paddr.addr != b->ext[i].paddr.addr ||
+		    a->ext[i].paddr.as != b->ext[i].paddr.as)
+			return 0;
+	return 1;
+}
+
+static unsigned
+count_objects(kdump_ctx_t *ctx)
+{
+	kdump_ctx_t *p;
+	unsigned n = 0;
+
+	list_for_each_entry(p, &ctx->shared->ctx, list)
+		++n;
+	return n;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct collect serial, parallel;
+	addrxlat_sys_t *sys;
+	addrxlat_meth_t meth;
+	kdump_ctx_t *ctx;
+	unsigned i, j;
+	int rc;
+
+#if !USE_PTHREAD
+	return TEST_SKIP;
+#endif
+
+	root = alloc_table();
+	for (i = 0; i < NTOP; ++i)
+		for (j = 0; j < NPAGES; ++j)
+			map_page(((addrxlat_addr_t)i << 39) + j * PAGE_SIZE,
+				 0x10000000 + (i * NPAGES + j) * PAGE_SIZE);
+
+	ctx = kdump_new();
+	if (!ctx) {
+		perror("Cannot allocate kdump context");
+		return TEST_ERR;
+	}
+	ctx->shared->ops = &fake_ops;
+	if (set_page_size(ctx, PAGE_SIZE) != KDUMP_OK ||
+	    set_byte_order(ctx, KDUMP_LITTLE_ENDIAN) != KDUMP_OK) {
+		fprintf(stderr, "Cannot set up fake dump: %s\n",
+			kdump_get_err(ctx));
+		return TEST_ERR;
+	}
+	ctx->xlat->xlat_caps = ADDRXLAT_CAPS(ADDRXLAT_MACHPHYSADDR);
+
+	sys = addrxlat_sys_new();
+	if (!sys) {
+		perror("Cannot allocate translation system");
+		return TEST_ERR;
+	}
+	meth.kind = ADDRXLAT_PGT;
+	meth.target_as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.pgt.root.as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.pgt.root.addr = root;
+	meth.param.pgt.pte_mask = 0;
+	meth.param.pgt.pf.pte_format = ADDRXLAT_PTE_X86_64;
+	meth.param.pgt.pf.nfields = 5;
+	meth.param.pgt.pf.fieldsz[0] = 12;
+	meth.param.pgt.pf.fieldsz[1] = 9;
+	meth.param.pgt.pf.fieldsz[2] = 9;
+	meth.param.pgt.pf.fieldsz[3] = 9;
+	meth.param.pgt.pf.fieldsz[4] = 9;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_PGT, &meth);
+
+	rc = walk(ctx->xlatctx, sys, &meth, 1, &serial);
+	if (rc == TEST_OK && serial.n != NTOP) {
+		fprintf(stderr, "Serial walk found %u extents (expect %u)\n",
+			serial.n, NTOP);
+		rc = TEST_FAIL;
+	}
+
+	/* Worker threads must not share the caller's dump file object. */
+	if (rc == TEST_OK)
+		rc = walk(ctx->xlatctx, sys, &meth, NTHREADS, &parallel);
+	if (rc == TEST_OK && shared_ctx) {
+		fprintf(stderr, "A dump file object was used by"
+			" multiple threads\n");
+		rc = TEST_FAIL;
+	}
+	if (rc == TEST_OK && !same_extents(&serial, &parallel)) {
+		fprintf(stderr, "Parallel walk differs from serial walk\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Per-thread clones must be released. */
+	if (rc == TEST_OK && count_objects(ctx) != 1) {
+		fprintf(stderr, "Leaked %u per-thread objects\n",
+			count_objects(ctx) - 1);
+		rc = TEST_FAIL;
+	}
+
+	addrxlat_sys_decref(sys);
+	kdump_free(ctx);
+
+	return rc;
+}
@@ -0,0 +1,170 @@
+/** @internal @file src/kdumpfile/test-zcache.c
+ * @brief Test the compressed payload cache.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "kdumpfile-priv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_OK     0
+#define TEST_FAIL   1
+#define TEST_ERR   99
+
+/** Memory budget of the test cache. */
+#define BUDGET		(64 * 1024)
+
+/** Average payload size of the test cache. */
+#define AVGSIZE		256
+
+/** Maximum payload size used in the test. */
+#define MAXSIZE		1024
+
+/** Fill a buffer with a pattern derived from a key. */
+static size_t
+make_payload(unsigned char *buf, cache_key_t key)
+{
+	size_t i, size = 1 + (key * 37) % MAXSIZE;
+
+	for (i = 0; i < size; ++i)
+		buf[i] = key + i;
+	return size;
+}
+
+/* Look up a key. Return 1 if found with correct data, 0 if not found. */
+static int
+lookup(struct zcache *zc, cache_key_t key)
+{
+	unsigned char expect[MAXSIZE];
+	unsigned char data[MAXSIZE];
+	unsigned flags;
+	size_t size, expsize;
+	int ret;
+
+	size = zcache_get(zc, key, &flags, data, sizeof data);
+	if (!size)
+		return 0;
+
+	expsize = make_payload(expect, key);
+	ret = 1;
+	if (flags != (unsigned)key || size != expsize ||
+	    memcmp(data, expect, size)) {
+		fprintf(stderr, "Wrong payload for key %llu\n",
+			(unsigned long long) key);
+		ret = -1;
+	}
+	return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned char buf[MAXSIZE];
+	struct zcache *zc;
+	unsigned found;
+	cache_key_t key;
+	size_t size;
+	int rc, res;
+
+	if (zcache_alloc(AVGSIZE, AVGSIZE, KDUMP_ARENA_MALLOC)) {
+		fprintf(stderr, "Allocated a cache with a tiny budget\n");
+		return TEST_FAIL;
+	}
+
+	zc = zcache_alloc(BUDGET, AVGSIZE, KDUMP_ARENA_MALLOC);
+	if (!zc) {
+		perror("Cannot allocate cache");
+		return TEST_ERR;
+	}
+	rc = TEST_OK;
+
+	/* Store a few payloads and read them back. */
+	for (key = 0; key < 16; ++key) {
+		size = make_payload(buf, key);
+		zcache_put(zc, key, key, buf, size);
+	}
+	for (key = 0; key < 16; ++key)
+		if (lookup(zc, key) != 1) {
+			fprintf(stderr, "Key %llu not found\n",
+				(unsigned long long) key);
+			rc = TEST_FAIL;
+		}
+	if (lookup(zc, 16) != 0) {
+		fprintf(stderr, "Found a key that was never stored\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Oversized payloads are not stored. */
+	zcache_put(zc, 1000, 0, zc, BUDGET);
+	if (zcache_get(zc, 1000, &found, buf, sizeof buf)) {
+		fprintf(stderr, "Oversized payload was stored\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Payloads are not copied to a buffer which is too small. */
+	if (zcache_get(zc, 15, &found, buf, make_payload(buf, 15) - 1)) {
+		fprintf(stderr, "Payload copied to a short buffer\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Wrap around the ring many times. Old payloads must disappear,
+	 * and no payload may ever be corrupted.
+	 */
+	for (key = 100; key < 100 + 16 * BUDGET / AVGSIZE; ++key) {
+		size = make_payload(buf, key);
+		zcache_put(zc, key, key, buf, size);
+	}
+	found = 0;
+	for (key = 0; key < 100 + 16 * BUDGET / AVGSIZE; ++key) {
+		res = lookup(zc, key);
+		if (res < 0)
+			rc = TEST_FAIL;
+		else
+			found += res;
+	}
+	if (found == 0 || found * AVGSIZE > 2 * BUDGET) {
+		fprintf(stderr, "Unexpected number of cached payloads: %u\n",
+			found);
+		rc = TEST_FAIL;
+	}
+	if (lookup(zc, 0) != 0) {
+		fprintf(stderr, "Oldest payload was not replaced\n");
+		rc = TEST_FAIL;
+	}
+	if (lookup(zc, 99 + 16 * BUDGET / AVGSIZE) != 1) {
+		fprintf(stderr, "Newest payload not found\n");
+		rc = TEST_FAIL;
+	}
+
+	zcache_free(zc);
+	return rc;
+}
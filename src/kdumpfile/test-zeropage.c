@@ -0,0 +1,130 @@
+/** @internal @file src/kdumpfile/test-zeropage.c
+ * @brief Test the shared zero page.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "fakedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Number of page cache elements. */
+#define CACHE_SIZE	4
+
+/** Number of pages in the fake dump. Pages above are excluded. */
+#define NPAGES		32
+
+/** Size of the private cache. */
+#define L1_SIZE		4
+
+/** Get a page. Excluded pages are mapped to the zero page. */
+static kdump_status
+excl_get_page(struct page_io *pio)
+{
+	if (pio->addr.addr >= 2 * NPAGES * FAKE_PAGE_SIZE)
+		return set_error(pio->ctx, KDUMP_ERR_NODATA,
+				 "Page not found");
+	if (pio->addr.addr >= NPAGES * FAKE_PAGE_SIZE)
+		return get_zero_page(pio);
+	return fake_get_page(pio);
+}
+
+static const struct format_ops excl_ops = {
+	.name = "excl",
+	.get_page = excl_get_page,
+	.put_page = cache_put_page,
+	.realloc_caches = def_realloc_caches,
+};
+
+int
+main(int argc, char **argv)
+{
+	kdump_ctx_t *ctx;
+	int rc;
+
+	/* Pages with an even PFN contain only zeros. */
+	fake_zero_even = true;
+	ctx = fake_dump(&excl_ops, NPAGES);
+	if (!ctx)
+		return TEST_ERR;
+	if (kdump_set_number_attr(ctx, "cache.size", CACHE_SIZE) != KDUMP_OK) {
+		fprintf(stderr, "Cannot set up cache: %s\n",
+			kdump_get_err(ctx));
+		return TEST_ERR;
+	}
+
+	/* Fill the cache with non-zero pages. */
+	rc = fake_check_reads(ctx, "Initial read",
+			      1, CACHE_SIZE, 2, CACHE_SIZE);
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Cached read", 1, CACHE_SIZE, 2, 0);
+
+	/* Excluded pages are not read at all. */
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Excluded pages",
+				      NPAGES, NPAGES, 1, 0);
+
+	/* Zero pages must not evict more than one cached page. */
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Zero pages",
+				      0, NPAGES / 2, 2, NPAGES / 2);
+	if (rc == TEST_OK) {
+		unsigned long start = fake_nreads;
+		unsigned pfn;
+
+		for (pfn = 1; pfn < 2 * CACHE_SIZE && rc == TEST_OK; pfn += 2)
+			rc = fake_check_page(ctx, pfn);
+		if (rc == TEST_OK && fake_nreads - start > 1) {
+			fprintf(stderr, "Zero pages evicted %lu pages\n",
+				fake_nreads - start);
+			rc = TEST_FAIL;
+		}
+	}
+
+	/* Zero pages are not stored in the private cache either. */
+	if (rc == TEST_OK &&
+	    kdump_set_number_attr(ctx, KDUMP_ATTR_CACHE_L1_SIZE, L1_SIZE)
+	    != KDUMP_OK) {
+		fprintf(stderr, "Cannot set private cache size: %s\n",
+			kdump_get_err(ctx));
+		rc = TEST_ERR;
+	}
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Zero pages with private cache",
+				      0, 2, 2, 2);
+	if (rc == TEST_OK)
+		rc = fake_check_reads(ctx, "Excluded pages with private cache",
+				      NPAGES, 2, 1, 0);
+
+	ctx->shared->ops = NULL;
+	kdump_free(ctx);
+
+	return rc;
+}
@@ -548,30 +548,41 @@ const struct attr_ops xen_ver_ops = {
 	.post_set = xen_ver_post_hook,
 };
 
-/**  Re-allocate a cache with default parameters.
- * @param ctx  Dump file object.
- * @returns    Error status.
+/**  Re-allocate the page cache.
+ * @param ctx       Dump file object.
+ * @param elemsize  Size of each cache element in bytes.
+ * @returns         Error status.
  *
- * This function can be used as the @c realloc_caches method if
- * the cache is organized as @c cache.size elements of @c arch.page_size
- * bytes each.
+ * Allocate a new page cache with @c cache.size elements of @p elemsize
+ * bytes each and replace the current page cache with it.
+ *
+ * If @c cache.max_bytes is set, the number of elements is capped to fit
+ * the budget. If @c cache.adaptive is also set, the cache may later grow
+ * up to the budget.
  */
 kdump_status
-def_realloc_caches(kdump_ctx_t *ctx)
+realloc_page_cache(kdump_ctx_t *ctx, size_t elemsize)
 {
 	unsigned cache_size = get_cache_size(ctx);
+	unsigned limit = get_cache_limit(ctx, elemsize);
 	struct cache *cache;
 	kdump_status status;
 
-	cache = cache_alloc(cache_size, get_page_size(ctx));
+	if (!limit)
+		return set_error(ctx, KDUMP_ERR_INVALID,
+				 "Cache budget too small");
+	if (cache_size > limit)
+		cache_size = limit;
+
+	cache = cache_alloc(cache_size, elemsize, get_cache_arena(ctx));
 	if (!cache)
 		return set_error(ctx, KDUMP_ERR_SYSTEM,
 				 "Cannot allocate cache (%u * %zu bytes)",
-				 cache_size, get_page_size(ctx));
+				 cache_size, elemsize);
+	if (limit != UINT_MAX && get_cache_adaptive(ctx))
+		cache_set_limit(cache, limit);
 
-	status = cache_set_attrs(cache, ctx,
-				 gattr(ctx, GKI_cache_hits),
-				 gattr(ctx, GKI_cache_misses));
+	status = cache_set_attrs(cache, ctx, gattr(ctx, GKI_dir_cache));
 	if (status != KDUMP_OK) {
 		cache_free(cache);
 		return status;
@@ -580,10 +591,25 @@ def_realloc_caches(kdump_ctx_t *ctx)
 	if (ctx->shared->cache)
 		cache_free(ctx->shared->cache);
 	ctx->shared->cache = cache;
+	++ctx->shared->cache_gen;
 
 	return KDUMP_OK;
 }
 
+/**  Re-allocate a cache with default parameters.
+ * @param ctx  Dump file object.
+ * @returns    Error status.
+ *
+ * This function can be used as the @c realloc_caches method if
+ * the cache is organized as @c cache.size elements of @c arch.page_size
+ * bytes each.
+ */
+kdump_status
+def_realloc_caches(kdump_ctx_t *ctx)
+{
+	return realloc_page_cache(ctx, get_page_size(ctx));
+}
+
 static kdump_status
 cache_size_pre_hook(kdump_ctx_t *ctx, struct attr_data *attr,
 		    kdump_attr_value_t *val)
@@ -607,6 +633,104 @@ const struct attr_ops cache_size_ops = {
 	.post_set = cache_size_post_hook,
 };
 
+static kdump_status
+cache_arena_pre_hook(kdump_ctx_t *ctx, struct attr_data *attr,
+		     kdump_attr_value_t *val)
+{
+	if (val->number > KDUMP_ARENA_HUGETLB)
+		return set_error(ctx, KDUMP_ERR_INVALID,
+				 "Invalid cache arena: %" KDUMP_PRIuNUM,
+				 val->number);
+	return KDUMP_OK;
+}
+
+const struct attr_ops cache_arena_ops = {
+	.pre_set = cache_arena_pre_hook,
+	.post_set = cache_size_post_hook,
+};
+
+static kdump_status
+file_access_pre_hook(kdump_ctx_t *ctx, struct attr_data *attr,
+		     kdump_attr_value_t *val)
+{
+	if (val->number > KDUMP_ACCESS_WILLNEED)
+		return set_error(ctx, KDUMP_ERR_INVALID,
+				 "Invalid access pattern: %" KDUMP_PRIuNUM,
+				 val->number);
+	return KDUMP_OK;
+}
+
+const struct attr_ops file_access_ops = {
+	.pre_set = file_access_pre_hook,
+};
+
+static kdump_status
+file_read_block_size_pre_hook(kdump_ctx_t *ctx, struct attr_data *attr,
+			      kdump_attr_value_t *val)
+{
+	kdump_num_t size = val->number;
+
+	if (size & (size - 1) || size > MAX_READ_BLOCK_SIZE)
+		return set_error(ctx, KDUMP_ERR_INVALID,
+				 "Invalid read block size: %" KDUMP_PRIuNUM,
+				 size);
+	return KDUMP_OK;
+}
+
+const struct attr_ops file_read_block_size_ops = {
+	.pre_set = file_read_block_size_pre_hook,
+};
+
+const struct attr_ops cache_budget_ops = {
+	.post_set = cache_size_post_hook,
+};
+
+static kdump_status
+cache_l1_size_post_hook(kdump_ctx_t *ctx, struct attr_data *attr)
+{
+	/* Private caches are re-allocated on next use. */
+	++ctx->shared->cache_gen;
+	return KDUMP_OK;
+}
+
+const struct attr_ops cache_l1_size_ops = {
+	.pre_set = cache_size_pre_hook,
+	.post_set = cache_l1_size_post_hook,
+};
+
+static kdump_status
+cache_reset_stats_post_hook(kdump_ctx_t *ctx, struct attr_data *attr)
+{
+	struct kdump_shared *shared = ctx->shared;
+	kdump_ctx_t *other;
+
+	if (shared->cache)
+		cache_reset_stats(shared->cache);
+	if (shared->fcache) {
+		cache_reset_stats(shared->fcache->cache);
+		cache_reset_stats(shared->fcache->fbcache);
+	}
+	list_for_each_entry(other, &shared->ctx, list)
+		addrxlat_ctx_reset_cache_stats(other->xlatctx);
+	return KDUMP_OK;
+}
+
+const struct attr_ops cache_reset_stats_ops = {
+	.post_set = cache_reset_stats_post_hook,
+};
+
+static kdump_status
+cache_invalidate_post_hook(kdump_ctx_t *ctx, struct attr_data *attr)
+{
+	/* Cached pages of live sources are re-read on next access. */
+	++ctx->shared->cache_gen;
+	return KDUMP_OK;
+}
+
+const struct attr_ops cache_invalidate_ops = {
+	.post_set = cache_invalidate_post_hook,
+};
+
 static kdump_status
 page_size_pre_hook(kdump_ctx_t *ctx, struct attr_data *attr,
 		   kdump_attr_value_t *newval)
@@ -626,6 +750,10 @@ page_size_post_hook(kdump_ctx_t *ctx, struct attr_data *attr)
 {
 	kdump_status res;
 
+	res = alloc_zero_page(ctx);
+	if (res != KDUMP_OK)
+		return res;
+
 	if (ctx->shared->ops && ctx->shared->ops->realloc_caches) {
 		res = ctx->shared->ops->realloc_caches(ctx);
 		if (res != KDUMP_OK)
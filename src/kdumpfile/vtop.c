@@ -440,12 +440,220 @@ set_xen_opts(kdump_ctx_t *ctx, addrxlat_opt_t *opts)
 	return KDUMP_OK;
 }
 
+/** FNV-1a 64-bit offset basis. */
+#define FNV64_OFFSET	0xcbf29ce484222325ULL
+
+/** FNV-1a 64-bit prime. */
+#define FNV64_PRIME	0x100000001b3ULL
+
+/** Update a FNV-1a hash with a memory area.
+ * @param hash  Current hash value.
+ * @param data  Data to be hashed.
+ * @param len   Length of @p data.
+ * @returns     Updated hash value.
+ */
+static uint64_t
+fnv64(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= FNV64_PRIME;
+	}
+	return hash;
+}
+
+/** Update a FNV-1a hash with a number.
+ * @param hash  Current hash value.
+ * @param val   Number to be hashed.
+ * @returns     Updated hash value.
+ *
+ * The number is hashed in little-endian byte order, so the result does
+ * not depend on the host.
+ */
+static uint64_t
+fnv64_num(uint64_t hash, uint64_t val)
+{
+	unsigned i;
+
+	for (i = 0; i < sizeof(val); ++i) {
+		hash ^= val & 0xff;
+		hash *= FNV64_PRIME;
+		val >>= 8;
+	}
+	return hash;
+}
+
+/** Update a FNV-1a hash with a string.
+ * @param hash  Current hash value.
+ * @param str   String to be hashed (may be @c NULL).
+ * @returns     Updated hash value.
+ */
+static uint64_t
+fnv64_str(uint64_t hash, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+	hash = fnv64_num(hash, len);
+	return fnv64(hash, str, len);
+}
+
+/** Update a FNV-1a hash with a blob attribute.
+ * @param ctx   Dump file object.
+ * @param hash  Current hash value.
+ * @param idx   Global attribute key index.
+ * @returns     Updated hash value.
+ */
+static uint64_t
+fnv64_blob_attr(kdump_ctx_t *ctx, uint64_t hash, enum global_keyidx idx)
+{
+	struct attr_data *attr = gattr(ctx, idx);
+	kdump_blob_t *blob;
+	void *data;
+
+	if (!attr_isset(attr))
+		return fnv64_num(hash, 0);
+
+	blob = attr_value(attr)->blob;
+	data = internal_blob_pin(blob);
+	hash = fnv64_num(hash, blob->size);
+	hash = fnv64(hash, data, blob->size);
+	internal_blob_unpin(blob);
+	return hash;
+}
+
+/** Compute the address translation fingerprint of a dump file.
+ * @param ctx        Dump file object.
+ * @param opts       Options for @ref addrxlat_sys_os_init.
+ * @param optc       Number of elements in @p opts.
+ * @param[out] pfp   Fingerprint (set on successful return).
+ * @returns          @c true if the dump file can be identified.
+ *
+ * The fingerprint identifies the dump file by its format and VMCOREINFO
+ * data, which contains a unique build ID and usually also the crash time
+ * and kernel offset. All translation options are included as well,
+ * so any change in the options also changes the fingerprint.
+ *
+ * If there is no VMCOREINFO, the dump file cannot be identified reliably,
+ * and this function returns @c false.
+ */
+static bool
+xlat_fingerprint(kdump_ctx_t *ctx, const addrxlat_opt_t *opts,
+		 unsigned optc, uint64_t *pfp)
+{
+	const addrxlat_opt_t *opt;
+	uint64_t hash;
+
+	if (!attr_isset(gattr(ctx, GKI_linux_vmcoreinfo_raw)) &&
+	    !attr_isset(gattr(ctx, GKI_xen_vmcoreinfo_raw)))
+		return false;
+
+	hash = FNV64_OFFSET;
+	hash = fnv64_str(hash, ctx->shared->ops->name);
+	hash = fnv64_blob_attr(ctx, hash, GKI_linux_vmcoreinfo_raw);
+	hash = fnv64_blob_attr(ctx, hash, GKI_xen_vmcoreinfo_raw);
+
+	for (opt = opts; opt < &opts[optc]; ++opt) {
+		hash = fnv64_num(hash, opt->idx);
+		switch (opt->idx) {
+		case ADDRXLAT_OPT_NULL:
+			break;
+
+		case ADDRXLAT_OPT_arch:
+		case ADDRXLAT_OPT_os_type:
+			hash = fnv64_str(hash, opt->val.str);
+			break;
+
+		case ADDRXLAT_OPT_phys_base:
+			hash = fnv64_num(hash, opt->val.addr);
+			break;
+
+		case ADDRXLAT_OPT_rootpgt:
+			hash = fnv64_num(hash, opt->val.fulladdr.as);
+			hash = fnv64_num(hash, opt->val.fulladdr.addr);
+			break;
+
+		default:
+			hash = fnv64_num(hash, opt->val.num);
+		}
+	}
+
+	*pfp = hash;
+	return true;
+}
+
+/** Try to load the translation system from a snapshot.
+ * @param ctx  Dump file object.
+ * @param fp   Fingerprint of the dump file.
+ * @returns    @c true if the translation system was loaded.
+ */
+static bool
+load_xlat_snapshot(kdump_ctx_t *ctx, uint64_t fp)
+{
+	struct attr_data *attr = gattr(ctx, GKI_xlat_snapshot);
+	kdump_blob_t *blob;
+	addrxlat_status axres;
+	void *data;
+
+	if (!attr_isset(attr))
+		return false;
+
+	blob = attr_value(attr)->blob;
+	data = internal_blob_pin(blob);
+	axres = addrxlat_sys_load(ctx->xlatctx, ctx->xlat->xlatsys, fp,
+				  data, blob->size);
+	internal_blob_unpin(blob);
+	if (axres != ADDRXLAT_OK) {
+		addrxlat_ctx_clear_err(ctx->xlatctx);
+		return false;
+	}
+	return true;
+}
+
+/** Save the translation system into the snapshot attribute.
+ * @param ctx  Dump file object.
+ * @param fp   Fingerprint of the dump file.
+ *
+ * Failures are not fatal; the snapshot attribute is cleared.
+ */
+static void
+save_xlat_snapshot(kdump_ctx_t *ctx, uint64_t fp)
+{
+	struct attr_data *attr = gattr(ctx, GKI_xlat_snapshot);
+	kdump_attr_value_t val;
+	addrxlat_status axres;
+	void *data;
+	size_t size;
+
+	axres = addrxlat_sys_save(ctx->xlatctx, ctx->xlat->xlatsys, fp,
+				  &data, &size);
+	if (axres != ADDRXLAT_OK) {
+		addrxlat_ctx_clear_err(ctx->xlatctx);
+		clear_attr(ctx, attr);
+		return;
+	}
+
+	val.blob = internal_blob_new(data, size);
+	if (!val.blob) {
+		free(data);
+		clear_attr(ctx, attr);
+		return;
+	}
+	if (set_attr(ctx, attr, ATTR_DEFAULT, &val) != KDUMP_OK) {
+		clear_error(ctx);
+		clear_attr(ctx, attr);
+	}
+}
+
 kdump_status
 vtop_init(kdump_ctx_t *ctx)
 {
 	kdump_status status;
 	addrxlat_status axres;
 	addrxlat_opt_t opts[ADDRXLAT_OPT_NUM];
+	struct attr_data *fpattr;
+	uint64_t fp;
+	bool have_fp;
 	unsigned i;
 
 	if (!isset_arch_name(ctx))
@@ -476,14 +684,29 @@ vtop_init(kdump_ctx_t *ctx)
 
 	ctx->xlat->dirty = false;
 
-	rwlock_unlock(&ctx->shared->lock);
+	fpattr = gattr(ctx, GKI_xlat_fingerprint);
+	have_fp = xlat_fingerprint(ctx, opts, ARRAY_SIZE(opts), &fp);
+	if (have_fp) {
+		status = set_attr_number(ctx, fpattr, ATTR_DEFAULT, fp);
+		if (status != KDUMP_OK)
+			return set_error(ctx, status,
+					 "Cannot set address translation fingerprint");
+	} else
+		clear_attr(ctx, fpattr);
 
-	axres = addrxlat_sys_os_init(ctx->xlat->xlatsys, ctx->xlatctx,
-				     ARRAY_SIZE(opts), opts);
+	if (!have_fp || !load_xlat_snapshot(ctx, fp)) {
+		rwlock_unlock(&ctx->shared->lock);
 
-	rwlock_rdlock(&ctx->shared->lock);
-	if (axres != ADDRXLAT_OK)
-		return addrxlat2kdump(ctx, axres);
+		axres = addrxlat_sys_os_init(ctx->xlat->xlatsys, ctx->xlatctx,
+					     ARRAY_SIZE(opts), opts);
+
+		rwlock_rdlock(&ctx->shared->lock);
+		if (axres != ADDRXLAT_OK)
+			return addrxlat2kdump(ctx, axres);
+
+		if (have_fp)
+			save_xlat_snapshot(ctx, fp);
+	}
 
 	if (!attr_isset(gattr(ctx, GKI_pteval_size)))
 		set_pteval_size(ctx);
@@ -540,6 +763,80 @@ const struct attr_ops xen_dirty_xlat_ops = {
 	.pre_clear = (attr_pre_clear_fn*)xen_dirty_xlat_hook,
 };
 
+/**  Revalidate an address translation read cache statistic.
+ * @param ctx   Dump file object.
+ * @param attr  "addrxlat.read_cache.hits" or "addrxlat.read_cache.misses".
+ * @returns     Error status (always @ref KDUMP_OK).
+ *
+ * Each address translation context has its own read cache, so the
+ * counters of all contexts which share the dump are summed up. The
+ * attribute stays invalid, so the sum is updated on every access.
+ */
+static kdump_status
+xlat_cache_stats_revalidate(kdump_ctx_t *ctx, struct attr_data *attr)
+{
+	bool want_hits = (attr == gattr(ctx, GKI_xlat_read_cache_hits));
+	unsigned long hits, misses, sum;
+	kdump_ctx_t *other;
+
+	sum = 0;
+	list_for_each_entry(other, &ctx->shared->ctx, list) {
+		addrxlat_ctx_get_cache_stats(other->xlatctx, &hits, &misses);
+		sum += want_hits ? hits : misses;
+	}
+	__atomic_store_n(&attr->val.number, sum, __ATOMIC_RELAXED);
+	return KDUMP_OK;
+}
+
+const struct attr_ops xlat_cache_stats_ops = {
+	.revalidate = xlat_cache_stats_revalidate,
+};
+
+/**  Allocate a page I/O structure for address translation.
+ * @param ctx  Dump file object.
+ * @returns    Page I/O structure, or @c NULL on allocation failure.
+ *
+ * Take an unused element from the per-context pool. The pool has as
+ * many elements as there are slots in the libaddrxlat read cache, so
+ * page table reads normally never fall back to @c malloc.
+ */
+static struct page_io *
+alloc_xlat_pio(kdump_ctx_t *ctx)
+{
+	unsigned used, i;
+
+	used = __atomic_load_n(&ctx->xlat_pio_used, __ATOMIC_RELAXED);
+	for (i = 0; i < XLAT_PIO_SLOTS; ++i) {
+		if (used & (1U << i))
+			continue;
+		if (__atomic_compare_exchange_n(&ctx->xlat_pio_used, &used,
+						used | (1U << i), false,
+						__ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			return &ctx->xlat_pio[i];
+		/* The bitmap has changed; start over. */
+		i = -1;
+	}
+
+	return malloc(sizeof(struct page_io));
+}
+
+/**  Free a page I/O structure allocated by @ref alloc_xlat_pio.
+ * @param pio  Page I/O structure.
+ */
+static void
+free_xlat_pio(struct page_io *pio)
+{
+	kdump_ctx_t *ctx = pio->ctx;
+
+	if (pio >= ctx->xlat_pio && pio < &ctx->xlat_pio[XLAT_PIO_SLOTS])
+		__atomic_fetch_and(&ctx->xlat_pio_used,
+				   ~(1U << (pio - ctx->xlat_pio)),
+				   __ATOMIC_RELEASE);
+	else
+		free(pio);
+}
+
 /**  Addrxlat put_page callback.
  * @param buf   Page buffer metadata.
  * @returns     Error status.
@@ -549,7 +846,7 @@ addrxlat_put_page(const addrxlat_buffer_t *buf)
 {
 	struct page_io *pio = buf->priv;
 	put_page(pio);
-	free(pio);
+	free_xlat_pio(pio);
 }
 
 /**  Addrxlat read_caps callback.
@@ -563,6 +860,36 @@ addrxlat_read_caps(const addrxlat_cb_t *cb)
 	return ctx->xlat->xlat_caps;
 }
 
+/**  Addrxlat get_thread_ctx callback.
+ * @param cb  This callback definition.
+ * @returns   Address translation context of a new dump file object,
+ *            or @c NULL on allocation failure.
+ *
+ * A dump file object must not be used by multiple threads at the same
+ * time, so every thread gets its own clone of the dump file object,
+ * and the clone's address translation context is used by the thread.
+ */
+static addrxlat_ctx_t *
+addrxlat_get_thread_ctx(const addrxlat_cb_t *cb)
+{
+	kdump_ctx_t *ctx = (kdump_ctx_t*) cb->priv;
+	kdump_ctx_t *clone;
+
+	clone = kdump_clone(ctx, 0);
+	return clone ? clone->xlatctx : NULL;
+}
+
+/**  Addrxlat put_thread_ctx callback.
+ * @param cb       This callback definition.
+ * @param xlatctx  Context returned by @ref addrxlat_get_thread_ctx.
+ */
+static void
+addrxlat_put_thread_ctx(const addrxlat_cb_t *cb, addrxlat_ctx_t *xlatctx)
+{
+	const addrxlat_cb_t *clonecb = addrxlat_ctx_get_cb(xlatctx);
+	kdump_free((kdump_ctx_t*) clonecb->priv);
+}
+
 /**  Addrxlat get_page callback.
  * @param cb    This callback definition.
  * @param buf   Page buffer metadata.
@@ -575,7 +902,7 @@ addrxlat_get_page(const addrxlat_cb_t *cb, addrxlat_buffer_t *buf)
 	struct page_io *pio;
 	kdump_status status;
 
-	pio = malloc(sizeof *pio);
+	pio = alloc_xlat_pio(ctx);
 	if (!pio)
 		return addrxlat_ctx_err(ctx->xlatctx, ADDRXLAT_ERR_NOMEM,
 					"Cannot allocate pio structure");
@@ -591,8 +918,10 @@ addrxlat_get_page(const addrxlat_cb_t *cb, addrxlat_buffer_t *buf)
 	pio->addr.addr = buf->addr.addr;
 	pio->addr.as = buf->addr.as;
 	status = get_page(pio);
-	if (status != KDUMP_OK)
+	if (status != KDUMP_OK) {
+		free_xlat_pio(pio);
 		return kdump2addrxlat(ctx, status);
+	}
 
 	buf->ptr = pio->chunk.data;
 	return ADDRXLAT_OK;
@@ -812,15 +1141,24 @@ init_addrxlat(kdump_ctx_t *ctx)
 	addrxlat_ctx_t *addrxlat;
 	addrxlat_cb_t *cb;
 
+	ctx->xlat_pio = calloc(XLAT_PIO_SLOTS, sizeof(struct page_io));
+	if (!ctx->xlat_pio)
+		return set_error(ctx, KDUMP_ERR_SYSTEM,
+				 "Cannot allocate %s",
+				 "page I/O structures");
+
 	addrxlat = addrxlat_ctx_new();
-	if (!addrxlat)
+	if (!addrxlat) {
+		free(ctx->xlat_pio);
 		return set_error(ctx, KDUMP_ERR_SYSTEM,
 				 "Cannot allocate %s",
 				 "address translation context");
+	}
 
 	cb = addrxlat_ctx_add_cb(addrxlat);
 	if (!cb) {
 		addrxlat_ctx_decref(addrxlat);
+		free(ctx->xlat_pio);
 		return set_error(ctx, KDUMP_ERR_SYSTEM,
 				 "Cannot allocate %s",
 				 "address translation callbacks");
@@ -834,12 +1172,27 @@ init_addrxlat(kdump_ctx_t *ctx)
 	cb->sym_sizeof = sym_sizeof;
 	cb->sym_offsetof = sym_offsetof;
 	cb->num_value = num_value;
+	cb->get_thread_ctx = addrxlat_get_thread_ctx;
+	cb->put_thread_ctx = addrxlat_put_thread_ctx;
 
 	ctx->xlatctx = addrxlat;
 	ctx->xlatcb = cb;
 	return KDUMP_OK;
 }
 
+/**  Release the address translation context of a dump file object.
+ * @param ctx  Dump file object.
+ *
+ * Pages held by the translation context are released before the
+ * page I/O structures are freed.
+ */
+void
+cleanup_addrxlat(kdump_ctx_t *ctx)
+{
+	addrxlat_ctx_decref(ctx->xlatctx);
+	free(ctx->xlat_pio);
+}
+
 /**  Allocate a new translation definition.
  * @returns       Address translation, or @c NULL on allocation failure.
  */
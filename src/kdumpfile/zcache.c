@@ -0,0 +1,221 @@
+/** @internal @file src/kdumpfile/zcache.c
+ * @brief Cache of compressed page payloads.
+ */
+/* Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "kdumpfile-priv.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/** Multiplier for Fibonacci hashing of keys. */
+#define HASH_MULT	0x9e3779b97f4a7c15ULL
+
+/**  Index slot of a compressed payload.
+ */
+struct zcache_slot {
+	cache_key_t key;	/**< Key of the payload. */
+	uint64_t pos;		/**< Ring position of the payload. */
+	uint32_t size;		/**< Payload size; zero if unused. */
+	uint32_t flags;		/**< User-defined flags. */
+};
+
+/**  Compressed payload cache.
+ *
+ * Payloads are stored one after another in a ring buffer, so memory is
+ * used only for the actual payload bytes, and the oldest payloads are
+ * overwritten first (FIFO replacement). A payload never wraps around
+ * the end of the ring; if it does not fit, the rest of the ring is
+ * skipped.
+ *
+ * Ring positions grow monotonically. A payload at position @c pos is
+ * still intact as long as no more than the ring size has been written
+ * since, i.e. if <tt>head - pos <= size</tt>.
+ *
+ * Payloads are found through a direct-mapped index. A new payload simply
+ * replaces any other payload in the same index slot.
+ */
+struct zcache {
+	mutex_t lock;		 /**< Guard access to the cache. */
+
+	size_t size;		 /**< Ring size in bytes. */
+	unsigned char *ring;	 /**< Ring buffer. */
+	kdump_cache_arena_t arena; /**< Arena type of @c ring. */
+	uint64_t head;		 /**< Total number of bytes written. */
+
+	unsigned hashbits;	 /**< Log2 of the number of index slots. */
+	struct zcache_slot *slots; /**< Payload index. */
+};
+
+/**  Get the index slot for a key.
+ * @param zc   Compressed payload cache.
+ * @param key  Payload key.
+ * @returns    Index slot.
+ */
+static inline struct zcache_slot *
+zcache_slot(const struct zcache *zc, cache_key_t key)
+{
+	return &zc->slots[((uint64_t)key * HASH_MULT) >> (64 - zc->hashbits)];
+}
+
+/**  Allocate a compressed payload cache.
+ * @param bytes    Memory budget in bytes.
+ * @param avgsize  Expected average payload size.
+ * @param arena    Arena type for the ring buffer.
+ * @returns        New cache, or @c NULL if out of memory or if the
+ *                 budget is too small.
+ *
+ * The budget covers both the ring buffer and the index.
+ */
+struct zcache *
+zcache_alloc(size_t bytes, size_t avgsize, kdump_cache_arena_t arena)
+{
+	struct zcache *zc;
+	size_t nslots, idxsize;
+	unsigned hashbits;
+
+	/* Make the index twice as big as the expected payload count. */
+	nslots = 2 * bytes / (avgsize + 2 * sizeof(struct zcache_slot));
+	hashbits = 1;
+	while ((2UL << hashbits) <= nslots && hashbits < 31)
+		++hashbits;
+	idxsize = sizeof(struct zcache_slot) << hashbits;
+	if (bytes <= idxsize + avgsize)
+		return NULL;
+
+	zc = malloc(sizeof(struct zcache));
+	if (!zc)
+		return NULL;
+
+	zc->hashbits = hashbits;
+	zc->slots = calloc(1UL << hashbits, sizeof(struct zcache_slot));
+	if (!zc->slots)
+		goto err_zc;
+
+	zc->size = bytes - idxsize;
+	zc->arena = arena;
+	zc->ring = arena_alloc(zc->size, &zc->arena);
+	if (!zc->ring)
+		goto err_slots;
+	zc->head = 0;
+
+	if (mutex_init(&zc->lock, NULL))
+		goto err_ring;
+
+	return zc;
+
+ err_ring:
+	arena_free(zc->ring, zc->size, zc->arena);
+ err_slots:
+	free(zc->slots);
+ err_zc:
+	free(zc);
+	return NULL;
+}
+
+/**  Free a compressed payload cache.
+ * @param zc  Compressed payload cache.
+ */
+void
+zcache_free(struct zcache *zc)
+{
+	mutex_destroy(&zc->lock);
+	arena_free(zc->ring, zc->size, zc->arena);
+	free(zc->slots);
+	free(zc);
+}
+
+/**  Store a payload.
+ * @param zc     Compressed payload cache.
+ * @param key    Payload key.
+ * @param flags  User-defined flags, returned by @ref zcache_get.
+ * @param data   Payload data.
+ * @param size   Payload size in bytes.
+ *
+ * Payloads which are bigger than a quarter of the ring are not stored.
+ */
+void
+zcache_put(struct zcache *zc, cache_key_t key, unsigned flags,
+	   const void *data, size_t size)
+{
+	struct zcache_slot *slot;
+	size_t off;
+
+	if (!size || size > zc->size / 4)
+		return;
+
+	mutex_lock(&zc->lock);
+	off = zc->head % zc->size;
+	if (off + size > zc->size) {
+		zc->head += zc->size - off;
+		off = 0;
+	}
+	memcpy(zc->ring + off, data, size);
+
+	slot = zcache_slot(zc, key);
+	slot->key = key;
+	slot->pos = zc->head;
+	slot->size = size;
+	slot->flags = flags;
+	zc->head += size;
+	mutex_unlock(&zc->lock);
+}
+
+/**  Look up a payload.
+ * @param zc     Compressed payload cache.
+ * @param key    Payload key.
+ * @param flags  Set to the flags of the payload on success.
+ * @param buf    Buffer for a copy of the payload.
+ * @param bufsz  Size of @p buf in bytes.
+ * @returns      Payload size, or zero if not found.
+ *
+ * The payload is copied to the caller's buffer, so the lock can be
+ * released before the payload is processed. Payloads which do not fit
+ * into @p buf are treated as not found.
+ */
+size_t
+zcache_get(struct zcache *zc, cache_key_t key, unsigned *flags,
+	   void *buf, size_t bufsz)
+{
+	struct zcache_slot *slot;
+	size_t ret = 0;
+
+	mutex_lock(&zc->lock);
+	slot = zcache_slot(zc, key);
+	if (slot->size && slot->size <= bufsz && slot->key == key &&
+	    zc->head - slot->pos <= zc->size) {
+		memcpy(buf, zc->ring + slot->pos % zc->size, slot->size);
+		*flags = slot->flags;
+		ret = slot->size;
+	}
+	mutex_unlock(&zc->lock);
+	return ret;
+}
@@ -69,6 +69,33 @@ mutex_unlock(mutex_t *mutex)
 	return pthread_mutex_unlock(mutex);
 }
 
+typedef pthread_cond_t cond_t;
+typedef pthread_condattr_t condattr_t;
+
+static inline int
+cond_init(cond_t *cond, const condattr_t *attr)
+{
+	return pthread_cond_init(cond, attr);
+}
+
+static inline int
+cond_destroy(cond_t *cond)
+{
+	return pthread_cond_destroy(cond);
+}
+
+static inline int
+cond_wait(cond_t *cond, mutex_t *mutex)
+{
+	return pthread_cond_wait(cond, mutex);
+}
+
+static inline int
+cond_broadcast(cond_t *cond)
+{
+	return pthread_cond_broadcast(cond);
+}
+
 typedef pthread_rwlock_t rwlock_t;
 typedef pthread_rwlockattr_t rwlockattr_t;
 
@@ -137,6 +164,33 @@ mutex_unlock(mutex_t *mutex)
 	return 0;
 }
 
+typedef struct { } cond_t;
+typedef struct { } condattr_t;
+
+static inline int
+cond_init(cond_t *cond, const condattr_t *attr)
+{
+	return 0;
+}
+
+static inline int
+cond_destroy(cond_t *cond)
+{
+	return 0;
+}
+
+static inline int
+cond_wait(cond_t *cond, mutex_t *mutex)
+{
+	return 0;
+}
+
+static inline int
+cond_broadcast(cond_t *cond)
+{
+	return 0;
+}
+
 typedef struct { } rwlock_t;
 typedef struct { } rwlockattr_t;
 
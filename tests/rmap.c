@@ -0,0 +1,445 @@
+/* Reverse address translation index.
+   Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libkdumpfile/addrxlat.h>
+
+#include "testutil.h"
+
+/** Size of the simulated physical memory. */
+#define MEMSZ		(4 << 20)
+
+/** Size of the buffers returned by the get-page callback. */
+#define BUFSZ		4096
+
+/** Number of mapped 4K pages. */
+#define NPAGES		512
+
+/** Virtual address of the first page. */
+#define VMALLOC_START	0xffffc90000000000ULL
+
+/** Virtual address of the 2M huge page. */
+#define HUGE_VADDR	0xffffffffa0000000ULL
+
+/** Physical address of the 2M huge page. */
+#define HUGE_PADDR	0x40000000ULL
+
+/** Linearly mapped region (excluded from the index). */
+#define LINEAR_START	0xffff888000000000ULL
+#define LINEAR_END	0xffffc87fffffffffULL
+
+/** Number of threads for the parallel build. */
+#define NTHREADS	4
+
+#define PAGE_SHIFT	12
+#define PTE_PRESENT	0x001
+#define PTE_PSE		0x080
+#define PTE_FLAGS	0x063	/* present, writable, accessed, dirty */
+
+static unsigned char *mem;
+static uint64_t memtop;
+static uint64_t root;
+
+static uint64_t
+alloc_table(void)
+{
+	uint64_t ret = memtop;
+
+	if (ret + BUFSZ > MEMSZ) {
+		fprintf(stderr, "Out of simulated memory\n");
+		exit(TEST_ERR);
+	}
+	memtop += BUFSZ;
+	return ret;
+}
+
+static uint64_t *
+entry(uint64_t table, addrxlat_addr_t va, unsigned shift)
+{
+	return (uint64_t *)(mem + table) + ((va >> shift) & 0x1ff);
+}
+
+/* Map @c va to @c pa with a leaf entry at the level given by @c shift. */
+static void
+map_page(addrxlat_addr_t va, uint64_t pa, unsigned leafshift)
+{
+	uint64_t table = root;
+	unsigned shift;
+
+	for (shift = 39; shift > leafshift; shift -= 9) {
+		uint64_t *pte = entry(table, va, shift);
+		if (!(le64toh(*pte) & PTE_PRESENT))
+			*pte = htole64(alloc_table() | PTE_FLAGS);
+		table = le64toh(*pte) & ~(uint64_t)(BUFSZ - 1);
+	}
+	*entry(table, va, leafshift) = htole64(pa | PTE_FLAGS |
+		(leafshift > PAGE_SHIFT ? PTE_PSE : 0));
+}
+
+static unsigned long
+read_caps(const addrxlat_cb_t *cb)
+{
+	return ADDRXLAT_CAPS(ADDRXLAT_MACHPHYSADDR);
+}
+
+static addrxlat_status
+get_page(const addrxlat_cb_t *cb, addrxlat_buffer_t *buf)
+{
+	buf->addr.addr &= ~(addrxlat_addr_t)(BUFSZ - 1);
+	if (buf->addr.as != ADDRXLAT_MACHPHYSADDR || buf->addr.addr >= MEMSZ)
+		return ADDRXLAT_ERR_NODATA;
+
+	buf->ptr = mem + buf->addr.addr;
+	buf->size = BUFSZ;
+	buf->byte_order = ADDRXLAT_LITTLE_ENDIAN;
+	return ADDRXLAT_OK;
+}
+
+static int
+set_range(addrxlat_map_t *map, addrxlat_addr_t first, addrxlat_addr_t last,
+	  addrxlat_sys_meth_t meth)
+{
+	addrxlat_range_t range;
+
+	range.endoff = last - first;
+	range.meth = meth;
+	if (addrxlat_map_set(map, first, &range) != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot set up translation map\n");
+		return TEST_ERR;
+	}
+	return TEST_OK;
+}
+
+static addrxlat_sys_t *
+make_sys(void)
+{
+	addrxlat_sys_t *sys;
+	addrxlat_map_t *map;
+	addrxlat_meth_t meth;
+
+	sys = addrxlat_sys_new();
+	map = addrxlat_map_new();
+	if (!sys || !map) {
+		perror("Cannot allocate translation system");
+		exit(TEST_ERR);
+	}
+
+	meth.kind = ADDRXLAT_PGT;
+	meth.target_as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.pgt.root.as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.pgt.root.addr = root;
+	meth.param.pgt.pte_mask = 0;
+	meth.param.pgt.pf.pte_format = ADDRXLAT_PTE_X86_64;
+	meth.param.pgt.pf.nfields = 5;
+	meth.param.pgt.pf.fieldsz[0] = 12;
+	meth.param.pgt.pf.fieldsz[1] = 9;
+	meth.param.pgt.pf.fieldsz[2] = 9;
+	meth.param.pgt.pf.fieldsz[3] = 9;
+	meth.param.pgt.pf.fieldsz[4] = 9;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_PGT, &meth);
+
+	meth.kind = ADDRXLAT_LINEAR;
+	meth.target_as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.linear.off = -LINEAR_START;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_DIRECT, &meth);
+
+	if (set_range(map, 0, 0x00007fffffffffffULL,
+		      ADDRXLAT_SYS_METH_PGT) ||
+	    set_range(map, 0xffff800000000000ULL, ADDRXLAT_ADDR_MAX,
+		      ADDRXLAT_SYS_METH_PGT) ||
+	    set_range(map, LINEAR_START, LINEAR_END,
+		      ADDRXLAT_SYS_METH_DIRECT))
+		exit(TEST_ERR);
+	addrxlat_sys_set_map(sys, ADDRXLAT_SYS_MAP_KV_PHYS, map);
+	addrxlat_map_decref(map);
+
+	return sys;
+}
+
+static addrxlat_rmap_t *
+build(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys, unsigned nthreads)
+{
+	addrxlat_rmap_t *rmap;
+	addrxlat_status status;
+
+	status = addrxlat_rmap_build(ctx, sys, nthreads, &rmap);
+	if (status != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot build reverse index: %s\n",
+			addrxlat_ctx_get_err(ctx));
+		exit(TEST_FAIL);
+	}
+	return rmap;
+}
+
+static int
+check(const addrxlat_rmap_t *rmap, addrxlat_addr_t paddr,
+      addrxlat_status expstatus, addrxlat_addr_t expvaddr)
+{
+	addrxlat_fulladdr_t faddr;
+	addrxlat_addr_t vaddr;
+	addrxlat_status status;
+
+	faddr.addr = paddr;
+	faddr.as = ADDRXLAT_MACHPHYSADDR;
+	vaddr = 0;
+	status = addrxlat_phys_to_virt(rmap, &faddr, &vaddr);
+	if (status != expstatus ||
+	    (status == ADDRXLAT_OK && vaddr != expvaddr)) {
+		fprintf(stderr, "0x%"ADDRXLAT_PRIxADDR": got %s"
+			" 0x%"ADDRXLAT_PRIxADDR", expected %s"
+			" 0x%"ADDRXLAT_PRIxADDR"\n", paddr,
+			addrxlat_strerror(status), vaddr,
+			addrxlat_strerror(expstatus), expvaddr);
+		return TEST_FAIL;
+	}
+	return TEST_OK;
+}
+
+/** Extents collected by the enumeration callback. */
+struct collect {
+	addrxlat_extent_t *ext;
+	size_t n;
+	size_t alloc;
+	size_t limit;
+};
+
+static addrxlat_status
+collect_extent(void *data, const addrxlat_extent_t *ext)
+{
+	struct collect *coll = data;
+
+	if (coll->n == coll->limit)
+		return ADDRXLAT_ERR_CUSTOM_BASE;
+
+	if (coll->n == coll->alloc) {
+		coll->alloc = coll->alloc ? 2 * coll->alloc : 64;
+		coll->ext = realloc(coll->ext,
+				    coll->alloc * sizeof(*coll->ext));
+		if (!coll->ext) {
+			perror("Cannot allocate extents");
+			exit(TEST_ERR);
+		}
+	}
+	coll->ext[coll->n++] = *ext;
+	return ADDRXLAT_OK;
+}
+
+static addrxlat_status
+enumerate(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+	  addrxlat_addr_t first, addrxlat_addr_t last,
+	  unsigned nthreads, struct collect *coll)
+{
+	const addrxlat_meth_t *meth =
+		addrxlat_sys_get_meth(sys, ADDRXLAT_SYS_METH_PGT);
+
+	return addrxlat_enum_pgt(ctx, sys, meth, first, last, nthreads,
+				 collect_extent, coll);
+}
+
+static int
+test_enum(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys)
+{
+	struct collect coll, pcoll;
+	addrxlat_status status;
+	size_t i;
+	int rc;
+
+	rc = TEST_OK;
+
+	memset(&coll, 0, sizeof coll);
+	coll.limit = ~(size_t)0;
+	status = enumerate(ctx, sys, 0, ADDRXLAT_ADDR_MAX, 1, &coll);
+	if (status != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot enumerate page tables: %s\n",
+			addrxlat_ctx_get_err(ctx));
+		return TEST_FAIL;
+	}
+
+	memset(&pcoll, 0, sizeof pcoll);
+	pcoll.limit = ~(size_t)0;
+	status = enumerate(ctx, sys, 0, ADDRXLAT_ADDR_MAX, NTHREADS, &pcoll);
+	if (status != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot enumerate page tables: %s\n",
+			addrxlat_ctx_get_err(ctx));
+		return TEST_FAIL;
+	}
+
+	/* NPAGES single pages + contiguous + 2x alias + huge + linear */
+	if (coll.n != NPAGES + 5) {
+		fprintf(stderr, "Enumerated %zu extents, expected %d\n",
+			coll.n, NPAGES + 5);
+		rc = TEST_FAIL;
+	}
+	for (i = 1; i < coll.n; ++i)
+		if (coll.ext[i].vaddr <=
+		    coll.ext[i-1].vaddr + coll.ext[i-1].endoff) {
+			fprintf(stderr, "Extent %zu out of order\n", i);
+			rc = TEST_FAIL;
+			break;
+		}
+	if (pcoll.n != coll.n ||
+	    memcmp(coll.ext, pcoll.ext, coll.n * sizeof(*coll.ext))) {
+		fprintf(stderr, "Parallel enumeration differs\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Partial range inside the huge page. */
+	coll.n = 0;
+	status = enumerate(ctx, sys, HUGE_VADDR + 0x1000, HUGE_VADDR + 0x1fff,
+			   NTHREADS, &coll);
+	if (status != ADDRXLAT_OK || coll.n != 1 ||
+	    coll.ext[0].vaddr != HUGE_VADDR + 0x1000 ||
+	    coll.ext[0].paddr.addr != HUGE_PADDR + 0x1000 ||
+	    coll.ext[0].endoff != 0xfff) {
+		fprintf(stderr, "Partial enumeration failed\n");
+		rc = TEST_FAIL;
+	}
+
+	/* Callback errors stop the enumeration. */
+	coll.n = 0;
+	coll.limit = 3;
+	status = enumerate(ctx, sys, 0, ADDRXLAT_ADDR_MAX, NTHREADS, &coll);
+	if (status != ADDRXLAT_ERR_CUSTOM_BASE || coll.n != 3) {
+		fprintf(stderr, "Callback error: got %s after %zu extents\n",
+			addrxlat_strerror(status), coll.n);
+		rc = TEST_FAIL;
+	}
+
+	free(coll.ext);
+	free(pcoll.ext);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	addrxlat_ctx_t *ctx;
+	addrxlat_cb_t *cb;
+	addrxlat_sys_t *sys;
+	addrxlat_rmap_t *rmap, *prmap;
+	const addrxlat_extent_t *ext, *pext;
+	size_t i, n;
+	int rc;
+
+	mem = calloc(1, MEMSZ);
+	if (!mem) {
+		perror("Cannot allocate simulated memory");
+		return TEST_ERR;
+	}
+	root = alloc_table();
+
+	/* Every other page, in reverse physical order. */
+	for (i = 0; i < NPAGES; ++i)
+		map_page(VMALLOC_START + (i << (PAGE_SHIFT + 1)),
+			 (uint64_t)(2 * NPAGES - i) << PAGE_SHIFT,
+			 PAGE_SHIFT);
+	/* Physically contiguous pages at contiguous addresses. */
+	for (i = 0; i < 16; ++i)
+		map_page(VMALLOC_START + 0x10000000 + (i << PAGE_SHIFT),
+			 0x10000000 + (i << PAGE_SHIFT), PAGE_SHIFT);
+	/* The same page at two virtual addresses. */
+	map_page(VMALLOC_START + 0x20001000, 0x20000000, PAGE_SHIFT);
+	map_page(VMALLOC_START + 0x20000000, 0x20000000, PAGE_SHIFT);
+	/* A huge page. */
+	map_page(HUGE_VADDR, HUGE_PADDR, PAGE_SHIFT + 9);
+	/* A page in a linearly mapped region. */
+	map_page(LINEAR_START, 0x30000000, PAGE_SHIFT);
+
+	ctx = addrxlat_ctx_new();
+	if (!ctx) {
+		perror("Cannot allocate addrxlat context");
+		return TEST_ERR;
+	}
+	cb = addrxlat_ctx_add_cb(ctx);
+	if (!cb) {
+		perror("Cannot allocate callback");
+		return TEST_ERR;
+	}
+	cb->get_page = get_page;
+	cb->read_caps = read_caps;
+
+	sys = make_sys();
+	rmap = build(ctx, sys, 1);
+	prmap = build(ctx, sys, NTHREADS);
+
+	rc = TEST_OK;
+	n = addrxlat_rmap_len(rmap);
+	if (addrxlat_rmap_len(prmap) != n) {
+		fprintf(stderr, "Parallel build: %zu extents, expected %zu\n",
+			addrxlat_rmap_len(prmap), n);
+		rc = TEST_FAIL;
+	} else {
+		ext = addrxlat_rmap_extents(rmap);
+		pext = addrxlat_rmap_extents(prmap);
+		if (memcmp(ext, pext, n * sizeof(*ext))) {
+			fprintf(stderr, "Parallel build differs\n");
+			rc = TEST_FAIL;
+		}
+	}
+
+	/* NPAGES single pages + contiguous + alias + huge page */
+	if (n != NPAGES + 3) {
+		fprintf(stderr, "Got %zu extents, expected %d\n",
+			n, NPAGES + 3);
+		rc = TEST_FAIL;
+	}
+
+	for (i = 0; i < NPAGES; ++i)
+		rc |= check(rmap, ((uint64_t)(2 * NPAGES - i) << PAGE_SHIFT)
+			    + 0x123, ADDRXLAT_OK,
+			    VMALLOC_START + (i << (PAGE_SHIFT + 1)) + 0x123);
+	rc |= check(rmap, (uint64_t)NPAGES << PAGE_SHIFT,
+		    ADDRXLAT_ERR_NOTPRESENT, 0);
+	rc |= check(rmap, 0x1000f008, ADDRXLAT_OK,
+		    VMALLOC_START + 0x1000f008);
+	rc |= check(rmap, 0x10010000, ADDRXLAT_ERR_NOTPRESENT, 0);
+	rc |= check(rmap, 0x20000010, ADDRXLAT_OK,
+		    VMALLOC_START + 0x20000010);
+	rc |= check(rmap, HUGE_PADDR, ADDRXLAT_OK, HUGE_VADDR);
+	rc |= check(rmap, HUGE_PADDR + 0x1fffff, ADDRXLAT_OK,
+		    HUGE_VADDR + 0x1fffff);
+	rc |= check(rmap, HUGE_PADDR + 0x200000,
+		    ADDRXLAT_ERR_NOTPRESENT, 0);
+	rc |= check(rmap, 0x30000000, ADDRXLAT_ERR_NOTPRESENT, 0);
+	rc |= check(rmap, 0, ADDRXLAT_ERR_NOTPRESENT, 0);
+
+	rc |= test_enum(ctx, sys);
+
+	addrxlat_rmap_decref(prmap);
+	addrxlat_rmap_decref(rmap);
+	addrxlat_sys_decref(sys);
+	addrxlat_ctx_decref(ctx);
+	free(mem);
+
+	return rc;
+}
@@ -0,0 +1,335 @@
+/* Translation system snapshots.
+   Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libkdumpfile/addrxlat.h>
+
+#include "testutil.h"
+
+#define KEY	0x0123456789abcdefULL
+
+static addrxlat_lookup_elem_t lookup_tbl[] = {
+	{ 0x1000, 0x7000 },
+	{ 0x3000, 0x2000 },
+	{ 0x9000, 0x0000 },
+};
+
+static void
+set_range(addrxlat_map_t *map, addrxlat_addr_t first, addrxlat_addr_t last,
+	  addrxlat_sys_meth_t meth)
+{
+	addrxlat_range_t range;
+
+	range.endoff = last - first;
+	range.meth = meth;
+	if (addrxlat_map_set(map, first, &range) != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot set up map\n");
+		exit(TEST_ERR);
+	}
+}
+
+static addrxlat_sys_t *
+make_sys(void)
+{
+	addrxlat_sys_t *sys;
+	addrxlat_map_t *map;
+	addrxlat_meth_t meth;
+
+	sys = addrxlat_sys_new();
+	map = addrxlat_map_new();
+	if (!sys || !map) {
+		perror("Cannot allocate translation system");
+		exit(TEST_ERR);
+	}
+
+	memset(&meth, 0, sizeof meth);
+	meth.kind = ADDRXLAT_PGT;
+	meth.target_as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.pgt.root.as = ADDRXLAT_KVADDR;
+	meth.param.pgt.root.addr = 0xffffffff81e0a000ULL;
+	meth.param.pgt.pte_mask = 0x8000000000000000ULL;
+	meth.param.pgt.pf.pte_format = ADDRXLAT_PTE_X86_64;
+	meth.param.pgt.pf.nfields = 5;
+	meth.param.pgt.pf.fieldsz[0] = 12;
+	meth.param.pgt.pf.fieldsz[1] = 9;
+	meth.param.pgt.pf.fieldsz[2] = 9;
+	meth.param.pgt.pf.fieldsz[3] = 9;
+	meth.param.pgt.pf.fieldsz[4] = 9;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_PGT, &meth);
+
+	memset(&meth, 0, sizeof meth);
+	meth.kind = ADDRXLAT_LINEAR;
+	meth.target_as = ADDRXLAT_KPHYSADDR;
+	meth.param.linear.off = -0xffff888000000000ULL;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_DIRECT, &meth);
+
+	memset(&meth, 0, sizeof meth);
+	meth.kind = ADDRXLAT_LOOKUP;
+	meth.target_as = ADDRXLAT_KPHYSADDR;
+	meth.param.lookup.endoff = 0xfff;
+	meth.param.lookup.nelem = ARRAY_SIZE(lookup_tbl);
+	meth.param.lookup.tbl = lookup_tbl;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_VMEMMAP, &meth);
+
+	memset(&meth, 0, sizeof meth);
+	meth.kind = ADDRXLAT_MEMARR;
+	meth.target_as = ADDRXLAT_MACHPHYSADDR;
+	meth.param.memarr.base.as = ADDRXLAT_KVADDR;
+	meth.param.memarr.base.addr = 0xffff800000000000ULL;
+	meth.param.memarr.shift = 12;
+	meth.param.memarr.elemsz = 8;
+	meth.param.memarr.valsz = 8;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_KPHYS_MACHPHYS, &meth);
+
+	set_range(map, 0, 0x00007fffffffffffULL, ADDRXLAT_SYS_METH_PGT);
+	set_range(map, 0xffff800000000000ULL, ADDRXLAT_ADDR_MAX,
+		  ADDRXLAT_SYS_METH_PGT);
+	set_range(map, 0xffff888000000000ULL, 0xffffc87fffffffffULL,
+		  ADDRXLAT_SYS_METH_DIRECT);
+	addrxlat_sys_set_map(sys, ADDRXLAT_SYS_MAP_KV_PHYS, map);
+	addrxlat_map_decref(map);
+
+	map = addrxlat_map_new();
+	if (!map) {
+		perror("Cannot allocate map");
+		exit(TEST_ERR);
+	}
+	addrxlat_sys_set_map(sys, ADDRXLAT_SYS_MAP_KPHYS_MACHPHYS, map);
+	addrxlat_map_decref(map);
+
+	return sys;
+}
+
+static int
+meth_equal(const addrxlat_meth_t *a, const addrxlat_meth_t *b)
+{
+	if (a->kind != b->kind || a->target_as != b->target_as)
+		return 0;
+
+	switch (a->kind) {
+	case ADDRXLAT_NOMETH:
+		return 1;
+
+	case ADDRXLAT_LINEAR:
+		return a->param.linear.off == b->param.linear.off;
+
+	case ADDRXLAT_PGT:
+		return !memcmp(&a->param.pgt, &b->param.pgt,
+			       sizeof(a->param.pgt));
+
+	case ADDRXLAT_LOOKUP:
+		return a->param.lookup.endoff == b->param.lookup.endoff &&
+			a->param.lookup.nelem == b->param.lookup.nelem &&
+			!memcmp(a->param.lookup.tbl, b->param.lookup.tbl,
+				a->param.lookup.nelem *
+				sizeof(addrxlat_lookup_elem_t));
+
+	case ADDRXLAT_MEMARR:
+		return !memcmp(&a->param.memarr, &b->param.memarr,
+			       sizeof(a->param.memarr));
+
+	default:
+		return 0;
+	}
+}
+
+static int
+map_equal(const addrxlat_map_t *a, const addrxlat_map_t *b)
+{
+	if (!a || !b)
+		return a == b;
+	return addrxlat_map_len(a) == addrxlat_map_len(b) &&
+		!memcmp(addrxlat_map_ranges(a), addrxlat_map_ranges(b),
+			addrxlat_map_len(a) * sizeof(addrxlat_range_t));
+}
+
+static int
+sys_equal(const addrxlat_sys_t *a, const addrxlat_sys_t *b)
+{
+	unsigned i;
+
+	for (i = 0; i < ADDRXLAT_SYS_METH_NUM; ++i)
+		if (!meth_equal(addrxlat_sys_get_meth(a, i),
+				addrxlat_sys_get_meth(b, i))) {
+			fprintf(stderr, "Method #%u differs\n", i);
+			return 0;
+		}
+
+	for (i = 0; i < ADDRXLAT_SYS_MAP_NUM; ++i)
+		if (!map_equal(addrxlat_sys_get_map(a, i),
+			       addrxlat_sys_get_map(b, i))) {
+			fprintf(stderr, "Map #%u differs\n", i);
+			return 0;
+		}
+
+	return 1;
+}
+
+/* Find a saved map range in a snapshot. */
+static unsigned char *
+find_range(void *buf, size_t size, addrxlat_addr_t endoff,
+	   addrxlat_sys_meth_t meth)
+{
+	unsigned char pattern[12];
+	unsigned char *p;
+	unsigned i;
+
+	for (i = 0; i < 8; ++i)
+		pattern[i] = endoff >> (8 * i);
+	for (i = 0; i < 4; ++i)
+		pattern[8 + i] = (uint32_t)meth >> (8 * i);
+
+	for (p = buf; p + sizeof pattern <= (unsigned char *)buf + size; ++p)
+		if (!memcmp(p, pattern, sizeof pattern))
+			return p;
+	return NULL;
+}
+
+static int
+check_status(addrxlat_ctx_t *ctx, const char *what,
+	     addrxlat_status status, addrxlat_status expect)
+{
+	if (status == expect)
+		return TEST_OK;
+	fprintf(stderr, "%s: got %s (%s), expected %s\n", what,
+		addrxlat_strerror(status), addrxlat_ctx_get_err(ctx),
+		addrxlat_strerror(expect));
+	return TEST_FAIL;
+}
+
+int
+main(int argc, char **argv)
+{
+	addrxlat_ctx_t *ctx;
+	addrxlat_sys_t *sys, *copy;
+	addrxlat_meth_t meth;
+	addrxlat_status status;
+	unsigned char *p;
+	void *buf;
+	size_t size, len;
+	int rc;
+
+	ctx = addrxlat_ctx_new();
+	if (!ctx) {
+		perror("Cannot allocate addrxlat context");
+		return TEST_ERR;
+	}
+
+	sys = make_sys();
+	status = addrxlat_sys_save(ctx, sys, KEY, &buf, &size);
+	if (status != ADDRXLAT_OK) {
+		fprintf(stderr, "Cannot save translation system: %s\n",
+			addrxlat_ctx_get_err(ctx));
+		return TEST_FAIL;
+	}
+
+	rc = TEST_OK;
+
+	/* Round trip. */
+	copy = addrxlat_sys_new();
+	if (!copy) {
+		perror("Cannot allocate translation system");
+		return TEST_ERR;
+	}
+	status = addrxlat_sys_load(ctx, copy, KEY, buf, size);
+	rc |= check_status(ctx, "Load", status, ADDRXLAT_OK);
+	if (status == ADDRXLAT_OK && !sys_equal(sys, copy))
+		rc = TEST_FAIL;
+	addrxlat_sys_decref(copy);
+
+	/* Key mismatch leaves the system untouched. */
+	copy = make_sys();
+	status = addrxlat_sys_load(ctx, copy, KEY + 1, buf, size);
+	rc |= check_status(ctx, "Key mismatch", status, ADDRXLAT_ERR_INVALID);
+	if (!sys_equal(sys, copy))
+		rc = TEST_FAIL;
+	addrxlat_sys_decref(copy);
+
+	/* Truncated snapshots are rejected. */
+	copy = addrxlat_sys_new();
+	if (!copy) {
+		perror("Cannot allocate translation system");
+		return TEST_ERR;
+	}
+	for (len = 0; len < size; ++len) {
+		status = addrxlat_sys_load(ctx, copy, KEY, buf, len);
+		if (status != ADDRXLAT_ERR_INVALID) {
+			fprintf(stderr, "Truncated at %zu: got %s\n",
+				len, addrxlat_strerror(status));
+			rc = TEST_FAIL;
+			break;
+		}
+	}
+	addrxlat_sys_decref(copy);
+
+	/* Maps must cover the whole address space. */
+	copy = addrxlat_sys_new();
+	if (!copy) {
+		perror("Cannot allocate translation system");
+		return TEST_ERR;
+	}
+	p = find_range(buf, size, 0x00007fffffffffffULL,
+		       ADDRXLAT_SYS_METH_PGT);
+	if (!p) {
+		fprintf(stderr, "Cannot find a map range in the snapshot\n");
+		rc = TEST_FAIL;
+	} else {
+		--p[0];		/* leave a hole after the range */
+		status = addrxlat_sys_load(ctx, copy, KEY, buf, size);
+		rc |= check_status(ctx, "Map with a hole", status,
+				   ADDRXLAT_ERR_INVALID);
+		p[0] += 2;	/* overlap the next range */
+		status = addrxlat_sys_load(ctx, copy, KEY, buf, size);
+		rc |= check_status(ctx, "Map too long", status,
+				   ADDRXLAT_ERR_INVALID);
+		--p[0];
+		status = addrxlat_sys_load(ctx, copy, KEY, buf, size);
+		rc |= check_status(ctx, "Restored map", status, ADDRXLAT_OK);
+	}
+	addrxlat_sys_decref(copy);
+	free(buf);
+
+	/* Custom methods cannot be saved. */
+	memset(&meth, 0, sizeof meth);
+	meth.kind = ADDRXLAT_CUSTOM;
+	meth.target_as = ADDRXLAT_KPHYSADDR;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_CUSTOM, &meth);
+	status = addrxlat_sys_save(ctx, sys, KEY, &buf, &size);
+	rc |= check_status(ctx, "Custom method", status,
+			   ADDRXLAT_ERR_NOTIMPL);
+	if (status == ADDRXLAT_OK)
+		free(buf);
+
+	addrxlat_sys_decref(sys);
+	addrxlat_ctx_decref(ctx);
+
+	return rc;
+}
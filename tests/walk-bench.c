@@ -0,0 +1,428 @@
+/* Page table walker benchmark.
+   Copyright (C) 2026 Petr Tesarik <ptesarik@suse.com>
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   libkdumpfile is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include <libkdumpfile/addrxlat.h>
+
+#include "testutil.h"
+
+/** Size of the simulated physical memory. */
+#define MEMSZ		(16 << 20)
+
+/** Size of the buffers returned by the get-page callback. */
+#define BUFSZ		4096
+
+/** Number of mapped pages in each configuration. */
+#define NPAGES		1024
+
+/** Number of translations per pass (mapped pages plus huge pages). */
+#define NADDR		(NPAGES + 2)
+
+/** Default number of benchmark passes. */
+#define DEF_PASSES	16
+
+struct walk_cfg;
+
+typedef uint64_t encode_fn(const struct walk_cfg *cfg, unsigned short lvl,
+			   uint64_t addr, bool leaf);
+
+struct walk_cfg {
+	const char *name;
+	addrxlat_paging_form_t pf;
+	endian_t endian;
+	addrxlat_addr_t va;
+	unsigned short hugelvl;
+	encode_fn *encode;
+	uint64_t none_pte;
+	uint64_t none_table;
+};
+
+static unsigned char *mem;
+static uint64_t memtop;
+
+static uint64_t
+encode_x86_64(const struct walk_cfg *cfg, unsigned short lvl,
+	      uint64_t addr, bool leaf)
+{
+	/* present, writable, accessed, dirty; PSE for huge pages */
+	return addr | 0x63 | (leaf && lvl > 1 ? 0x80 : 0);
+}
+
+static uint64_t
+encode_aarch64(const struct walk_cfg *cfg, unsigned short lvl,
+	       uint64_t addr, bool leaf)
+{
+	/* table/page descriptors are type 3, block descriptors type 1 */
+	return addr | (leaf && lvl > 1 ? 1 : 3);
+}
+
+static uint64_t
+encode_s390x(const struct walk_cfg *cfg, unsigned short lvl,
+	     uint64_t addr, bool leaf)
+{
+	if (lvl == 1)
+		return addr;
+	/* TT = lvl - 2, TL = 3 for region tables; FC for huge pages */
+	return addr | ((uint64_t)(lvl - 2) << 2) |
+		(lvl > 2 ? 3 : 0) | (leaf ? 1 << 10 : 0);
+}
+
+static const struct walk_cfg configs[] = {
+	{ "x86_64-4l",
+	  { ADDRXLAT_PTE_X86_64, 5, { 12, 9, 9, 9, 9 } },
+	  data_le, 0xffffc90000000000, 2, encode_x86_64 },
+	{ "x86_64-5l",
+	  { ADDRXLAT_PTE_X86_64, 6, { 12, 9, 9, 9, 9, 9 } },
+	  data_le, 0xff11000000000000, 3, encode_x86_64 },
+	{ "aarch64-4k",
+	  { ADDRXLAT_PTE_AARCH64, 5, { 12, 9, 9, 9, 9 } },
+	  data_le, 0xffff000010000000, 2, encode_aarch64 },
+	{ "aarch64-64k",
+	  { ADDRXLAT_PTE_AARCH64, 4, { 16, 13, 13, 6 } },
+	  data_le, 0xffff000010000000, 2, encode_aarch64 },
+	{ "s390x-4l",
+	  { ADDRXLAT_PTE_S390X, 5, { 12, 8, 11, 11, 11 } },
+	  data_be, 0x000003ff00000000, 2, encode_s390x,
+	  /* page invalid, region/segment invalid */
+	  0x400, 0x20 },
+};
+
+static addrxlat_addr_t addrs[NADDR];
+
+static uint64_t
+get_entry(const struct walk_cfg *cfg, uint64_t addr)
+{
+	uint64_t val;
+	memcpy(&val, mem + addr, sizeof val);
+	return cfg->endian == data_be ? be64toh(val) : le64toh(val);
+}
+
+static void
+set_entry(const struct walk_cfg *cfg, uint64_t addr, uint64_t val)
+{
+	val = htodump64(cfg->endian, val);
+	memcpy(mem + addr, &val, sizeof val);
+}
+
+static uint64_t
+none_entry(const struct walk_cfg *cfg, unsigned short lvl)
+{
+	return lvl > 1 ? cfg->none_table : cfg->none_pte;
+}
+
+/* Allocate an empty table for entries at level @c lvl. */
+static uint64_t
+alloc_table(const struct walk_cfg *cfg, unsigned short lvl)
+{
+	uint64_t n = 1ULL << cfg->pf.fieldsz[lvl];
+	uint64_t size = n * sizeof(uint64_t);
+	uint64_t ret = (memtop + size - 1) & ~(size - 1);
+	uint64_t i;
+
+	if (ret + size > MEMSZ) {
+		fprintf(stderr, "Out of simulated memory\n");
+		exit(TEST_ERR);
+	}
+	memtop = ret + size;
+	for (i = 0; i < n; ++i)
+		set_entry(cfg, ret + i * sizeof(uint64_t),
+			  none_entry(cfg, lvl));
+	return ret;
+}
+
+static unsigned
+field_shift(const addrxlat_paging_form_t *pf, unsigned short lvl)
+{
+	unsigned shift = 0;
+	while (lvl--)
+		shift += pf->fieldsz[lvl];
+	return shift;
+}
+
+/* Map @c va to @c pa with a leaf entry at level @c leaflvl. */
+static void
+map_addr(const struct walk_cfg *cfg, uint64_t root,
+	 addrxlat_addr_t va, uint64_t pa, unsigned short leaflvl)
+{
+	const addrxlat_paging_form_t *pf = &cfg->pf;
+	uint64_t table = root;
+	unsigned short lvl;
+
+	for (lvl = pf->nfields - 1; lvl > leaflvl; --lvl) {
+		unsigned shift = field_shift(pf, lvl);
+		uint64_t idx = (va >> shift) & ((1ULL << pf->fieldsz[lvl]) - 1);
+		uint64_t ptr = table + idx * sizeof(uint64_t);
+		uint64_t ent = get_entry(cfg, ptr);
+		uint64_t next;
+
+		if (ent != none_entry(cfg, lvl)) {
+			next = ent & ~((1ULL << pf->fieldsz[lvl - 1]) *
+				       sizeof(uint64_t) - 1);
+		} else {
+			next = alloc_table(cfg, lvl - 1);
+			set_entry(cfg, ptr, cfg->encode(cfg, lvl, next, false));
+		}
+		table = next;
+	}
+
+	table += ((va >> field_shift(pf, leaflvl)) &
+		  ((1ULL << pf->fieldsz[leaflvl]) - 1)) * sizeof(uint64_t);
+	set_entry(cfg, table, cfg->encode(cfg, leaflvl, pa, true));
+}
+
+static unsigned long
+read_caps(const addrxlat_cb_t *cb)
+{
+	return ADDRXLAT_CAPS(ADDRXLAT_MACHPHYSADDR);
+}
+
+static addrxlat_status
+get_page(const addrxlat_cb_t *cb, addrxlat_buffer_t *buf)
+{
+	const struct walk_cfg *cfg = cb->priv;
+
+	buf->addr.addr &= ~(addrxlat_addr_t)(BUFSZ - 1);
+	if (buf->addr.as != ADDRXLAT_MACHPHYSADDR || buf->addr.addr >= MEMSZ)
+		return ADDRXLAT_ERR_NODATA;
+
+	buf->ptr = mem + buf->addr.addr;
+	buf->size = BUFSZ;
+	buf->byte_order = cfg->endian == data_be
+		? ADDRXLAT_BIG_ENDIAN
+		: ADDRXLAT_LITTLE_ENDIAN;
+	return ADDRXLAT_OK;
+}
+
+static addrxlat_status
+walk(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+     const addrxlat_meth_t *meth, addrxlat_addr_t addr,
+     addrxlat_fulladdr_t *res)
+{
+	addrxlat_step_t step;
+	addrxlat_status status;
+
+	step.ctx = ctx;
+	step.sys = sys;
+	step.meth = meth;
+	step.base.addr = addr;
+	status = addrxlat_walk(&step);
+	*res = step.base;
+	return status;
+}
+
+static double
+time_walks(addrxlat_ctx_t *ctx, addrxlat_sys_t *sys,
+	   const addrxlat_meth_t *meth, unsigned passes)
+{
+	struct timespec start, end;
+	addrxlat_fulladdr_t res;
+	unsigned pass, i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (pass = 0; pass < passes; ++pass)
+		for (i = 0; i < NADDR; ++i)
+			walk(ctx, sys, meth, addrs[i], &res);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_nsec - start.tv_nsec)) / ((double)passes * NADDR);
+}
+
+static int
+run_cfg(const struct walk_cfg *cfg, unsigned passes)
+{
+	unsigned page_shift = cfg->pf.fieldsz[0];
+	addrxlat_ctx_t *ctx;
+	addrxlat_cb_t *cb;
+	addrxlat_sys_t *sys;
+	addrxlat_meth_t generic;
+	const addrxlat_meth_t *special;
+	addrxlat_fulladdr_t fast, slow;
+	addrxlat_status fstatus, sstatus;
+	char errmsg[256];
+	uint64_t root;
+	double tgeneric, tspecial;
+	unsigned i;
+	int rc;
+
+	memset(mem, 0, MEMSZ);
+	memtop = 0;
+	root = alloc_table(cfg, cfg->pf.nfields - 1);
+
+	for (i = 0; i < NPAGES; ++i) {
+		addrs[i] = cfg->va + ((addrxlat_addr_t)i * 67 << page_shift) +
+			(i * 8 & ((1ULL << page_shift) - 1));
+		map_addr(cfg, root, addrs[i] >> page_shift << page_shift,
+			 (uint64_t)(i * 7919 + 1) << page_shift, 1);
+	}
+
+	/* One huge page and one unmapped address. */
+	i = field_shift(&cfg->pf, cfg->hugelvl);
+	addrs[NPAGES] = cfg->va - (4ULL << i) + 0x1238;
+	map_addr(cfg, root, addrs[NPAGES] >> i << i, 5ULL << i, cfg->hugelvl);
+	addrs[NPAGES + 1] = cfg->va - (8ULL << i);
+
+	ctx = addrxlat_ctx_new();
+	if (!ctx) {
+		perror("Cannot allocate addrxlat context");
+		return TEST_ERR;
+	}
+	cb = addrxlat_ctx_add_cb(ctx);
+	if (!cb) {
+		perror("Cannot allocate callback");
+		addrxlat_ctx_decref(ctx);
+		return TEST_ERR;
+	}
+	cb->priv = (void *)cfg;
+	cb->get_page = get_page;
+	cb->read_caps = read_caps;
+
+	sys = addrxlat_sys_new();
+	if (!sys) {
+		perror("Cannot allocate translation system");
+		addrxlat_ctx_decref(ctx);
+		return TEST_ERR;
+	}
+
+	generic.kind = ADDRXLAT_PGT;
+	generic.target_as = ADDRXLAT_MACHPHYSADDR;
+	generic.param.pgt.root.as = ADDRXLAT_MACHPHYSADDR;
+	generic.param.pgt.root.addr = root;
+	generic.param.pgt.pte_mask = 0;
+	generic.param.pgt.pf = cfg->pf;
+	addrxlat_sys_set_meth(sys, ADDRXLAT_SYS_METH_PGT, &generic);
+	special = addrxlat_sys_get_meth(sys, ADDRXLAT_SYS_METH_PGT);
+
+	rc = TEST_OK;
+	for (i = 0; i < NADDR; ++i) {
+		fstatus = walk(ctx, sys, special, addrs[i], &fast);
+		snprintf(errmsg, sizeof errmsg, "%s",
+			 addrxlat_ctx_get_err(ctx) ?: "");
+		sstatus = walk(ctx, sys, &generic, addrs[i], &slow);
+		if (fstatus != sstatus ||
+		    (sstatus == ADDRXLAT_OK &&
+		     (fast.as != slow.as || fast.addr != slow.addr)) ||
+		    (sstatus != ADDRXLAT_OK &&
+		     strcmp(errmsg, addrxlat_ctx_get_err(ctx) ?: ""))) {
+			fprintf(stderr, "%s: 0x%"ADDRXLAT_PRIxADDR
+				" mismatch: %s:0x%"ADDRXLAT_PRIxADDR
+				" (%d) != %s:0x%"ADDRXLAT_PRIxADDR" (%d)\n",
+				cfg->name, addrs[i],
+				addrxlat_addrspace_name(fast.as), fast.addr,
+				(int) fstatus,
+				addrxlat_addrspace_name(slow.as), slow.addr,
+				(int) sstatus);
+			rc = TEST_FAIL;
+		}
+	}
+	if (sstatus != ADDRXLAT_ERR_NOTPRESENT) {
+		fprintf(stderr, "%s: unmapped address translated\n",
+			cfg->name);
+		rc = TEST_FAIL;
+	}
+
+	if (rc == TEST_OK) {
+		tgeneric = time_walks(ctx, sys, &generic, passes);
+		tspecial = time_walks(ctx, sys, special, passes);
+		printf("%-12s generic: %7.1f ns  specialized: %7.1f ns"
+		       "  (%.2fx)\n", cfg->name, tgeneric, tspecial,
+		       tgeneric / tspecial);
+	}
+
+	addrxlat_sys_decref(sys);
+	addrxlat_ctx_decref(ctx);
+	return rc;
+}
+
+static const struct option opts[] = {
+	{ "help", no_argument, NULL, 'h' },
+	{ "passes", required_argument, NULL, 'n' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [<options>]\n"
+		"\n"
+		"Options:\n"
+		"  -n|--passes num   Number of benchmark passes\n",
+		name);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned long passes = DEF_PASSES;
+	char *endp;
+	unsigned i;
+	int opt;
+	int rc, ret;
+
+	while ((opt = getopt_long(argc, argv, "hn:", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			passes = strtoul(optarg, &endp, 0);
+			if (*endp || !passes) {
+				fprintf(stderr, "Invalid pass count: %s\n",
+					optarg);
+				return TEST_ERR;
+			}
+			break;
+
+		case 'h':
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? TEST_OK : TEST_ERR;
+		}
+	}
+
+	mem = malloc(MEMSZ);
+	if (!mem) {
+		perror("Cannot allocate simulated memory");
+		return TEST_ERR;
+	}
+
+	ret = TEST_OK;
+	for (i = 0; i < ARRAY_SIZE(configs); ++i) {
+		rc = run_cfg(&configs[i], passes);
+		if (rc > ret)
+			ret = rc;
+	}
+
+	free(mem);
+	return ret;
+}